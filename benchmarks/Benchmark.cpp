@@ -0,0 +1,283 @@
+/*
+ * Microbenchmark of the hot paths of the modules. It is used to compare build
+ * variants and to train the profile-guided optimized builds.
+ *
+ * Usage: mesos_command_modules_benchmark [filter regex]
+ *
+ * The results are printed in JSON on stdout, see
+ * scripts/compare_benchmarks.sh to compare two runs. Given the report of a
+ * previous run in BENCHMARK_ALLOCATION_BASELINE, the benchmark exits with an
+ * error if a case allocates more heap blocks per operation than it did there,
+ * plus a margin. See scripts/check_allocations.sh.
+ */
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <new>
+#include <regex>
+#include <string>
+
+#include <mesos/mesos.pb.h>
+
+#include <stout/json.hpp>
+#include <stout/os.hpp>
+#include <stout/stringify.hpp>
+
+#include "AuditLog.hpp"
+#include "CommandIsolator.hpp"
+#include "CommandRunner.hpp"
+#include "DebugLog.hpp"
+#include "Helpers.hpp"
+#include "StatisticsChannel.hpp"
+#include "StatisticsChannelWriter.hpp"
+#include "Tracer.hpp"
+
+using std::string;
+
+using namespace criteo::mesos;
+
+static string g_resourcesPath = "./tests/scripts/";
+
+// Heap blocks allocated by all the threads of the benchmark, the libprocess
+// workers running the continuations included.
+static std::atomic<uint64_t> g_allocations(0);
+
+void* operator new(size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* block = malloc(size == 0 ? 1 : size);
+  if (block == nullptr) throw std::bad_alloc();
+  return block;
+}
+
+void operator delete(void* block) noexcept { free(block); }
+
+const string USAGE_OUTPUT =
+    "{\"timestamp\": 12345, \"cpus_user_time_secs\": 12.5,"
+    " \"cpus_system_time_secs\": 3.25, \"mem_rss_bytes\": 1073741824,"
+    " \"net_snmp_statistics\": {\"tcp_stats\": {\"CurrEstab\": 5}}}";
+
+// Allocations allowed per operation over the baseline: a relative margin for
+// the cases whose count depends on timing, e.g. the polls of the reaper, and
+// an absolute one for the cases allocating nothing.
+const double ALLOCATION_MARGIN = 0.1;
+const double ALLOCATION_SLACK = 1;
+
+class Benchmark {
+ public:
+  explicit Benchmark(const std::regex& filter)
+      : m_filter(filter), m_overBudget(false) {}
+
+  /**
+   * Budget the allocations of every case from a previous report, typically
+   * produced by the build of the base branch.
+   */
+  Try<Nothing> loadBaseline(const string& reportPath) {
+    Try<string> content = os::read(reportPath);
+    if (content.isError()) return Error(content.error());
+    Try<JSON::Object> report = JSON::parse<JSON::Object>(content.get());
+    if (report.isError()) return Error(report.error());
+    Result<JSON::Array> results = report->find<JSON::Array>("benchmarks");
+    if (!results.isSome()) return Error("No benchmarks in " + reportPath);
+
+    for (const JSON::Value& value : results->values) {
+      const JSON::Object& result = value.as<JSON::Object>();
+      Result<JSON::String> name = result.find<JSON::String>("name");
+      Result<JSON::Number> allocations =
+          result.find<JSON::Number>("allocs_per_op");
+      if (name.isSome() && allocations.isSome()) {
+        m_baseline[name->value] = allocations->as<double>();
+      }
+    }
+    return Nothing();
+  }
+
+  /**
+   * Time `iterations` calls to `operation` after a warm-up run and record the
+   * average latency and number of heap allocations. The run fails if the
+   * case allocates more than its budget from the baseline, if any.
+   */
+  void run(const string& name, uint64_t iterations,
+           const std::function<void()>& operation) {
+    if (!selected(name)) return;
+
+    Option<double> allocationBudget;
+    auto baseline = m_baseline.find(name);
+    if (baseline != m_baseline.end()) {
+      allocationBudget =
+          baseline->second * (1 + ALLOCATION_MARGIN) + ALLOCATION_SLACK;
+    }
+
+    operation();
+    uint64_t allocations = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) operation();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double allocationsPerOp =
+        static_cast<double>(g_allocations.load() - allocations) / iterations;
+
+    double nsPerOp =
+        std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::cerr << name << ": " << nsPerOp << " ns/op, " << allocationsPerOp
+              << " allocs/op" << std::endl;
+    if (allocationBudget.isSome() &&
+        allocationsPerOp > allocationBudget.get()) {
+      std::cerr << name << ": exceeds the budget of " << allocationBudget.get()
+                << " allocs/op" << std::endl;
+      m_overBudget = true;
+    }
+
+    JSON::Object result;
+    result.values["name"] = name;
+    result.values["iterations"] = iterations;
+    result.values["ns_per_op"] = nsPerOp;
+    result.values["allocs_per_op"] = allocationsPerOp;
+    m_results.values.push_back(result);
+  }
+
+  inline bool overBudget() const { return m_overBudget; }
+
+  bool selected(const string& name) const {
+    return std::regex_search(name, m_filter);
+  }
+
+  string report() const {
+    JSON::Object report;
+    report.values["benchmarks"] = m_results;
+    return stringify(report);
+  }
+
+ private:
+  std::regex m_filter;
+  std::map<string, double> m_baseline;
+  JSON::Array m_results;
+  bool m_overBudget;
+};
+
+int main(int argc, char** argv) {
+  if (const char* resourcesPath = getenv("BENCHMARK_RESOURCES_PATH"))
+    g_resourcesPath = resourcesPath;
+  Benchmark benchmark(std::regex(argc > 1 ? argv[1] : ""));
+  if (const char* baseline = getenv("BENCHMARK_ALLOCATION_BASELINE")) {
+    Try<Nothing> loaded = benchmark.loadBaseline(baseline);
+    if (loaded.isError()) {
+      std::cerr << "Failed to load the allocation baseline " << baseline
+                << ": " << loaded.error() << std::endl;
+      return 1;
+    }
+  }
+  logging::Metadata metadata{"container_id", "usage"};
+
+  benchmark.run("tracer_record", 1000000, [&]() {
+    tracing::Tracer::instance().record("run", metadata, 1, 10, 20);
+  });
+
+  logging::DebugSampler sampler({{"usage", 0.01}, {"*", 1}}, None(), {});
+  benchmark.run("debug_sampler", 1000000,
+                [&]() { sampler.sample(metadata); });
+
+  char auditPath[] = "/tmp/benchmark_audit_XXXXXX";
+  int auditFd = mkstemp(auditPath);
+  if (auditFd != -1) {
+    close(auditFd);
+    Try<std::shared_ptr<audit::AuditLog>> auditLog =
+        audit::AuditLog::open(auditPath, 4096, "benchmark");
+    if (auditLog.isSome()) {
+      audit::Record record = audit::Record();
+      benchmark.run("audit_append", 1000000,
+                    [&]() { auditLog.get()->append(record); });
+    }
+    unlink(auditPath);
+  }
+
+  benchmark.run("json_to_protobuf", 100000, [&]() {
+    jsonToProtobuf<::mesos::ResourceStatistics>(USAGE_OUTPUT, metadata);
+  });
+
+  string channelPath = "/tmp/benchmark_channel_" + stringify(getpid());
+  Try<std::shared_ptr<statistics::StatisticsChannelWriter>> channelWriter =
+      statistics::StatisticsChannelWriter::create(channelPath);
+  if (channelWriter.isSome()) {
+    Try<JSON::Object> usage = JSON::parse<JSON::Object>(USAGE_OUTPUT);
+    Try<::mesos::ResourceStatistics> published =
+        ::protobuf::parse<::mesos::ResourceStatistics>(usage.get());
+    channelWriter.get()->publish(metadata.taskId,
+                                 published->SerializeAsString());
+
+    statistics::StatisticsChannel channel(channelPath);
+    benchmark.run("statistics_channel_read", 1000000,
+                  [&]() { channel.read(metadata.taskId); });
+    unlink(channelPath.c_str());
+  }
+
+  CommandRunner runner(false, metadata);
+  Command pipeInput(g_resourcesPath + "pipe_input.sh", 10);
+  benchmark.run("runner_run", 200,
+                [&]() { runner.run(pipeInput, "HELLO"); });
+  benchmark.run("runner_run_sync", 200,
+                [&]() { runner.runSync(pipeInput, "HELLO"); });
+
+  string stateDir = "/tmp/benchmark_state_" + stringify(getpid());
+  IsolatorOptions usageOptions;
+  usageOptions.stateDir = stateDir;
+  CommandIsolator isolator("benchmark", None(), None(), None(), None(),
+                           Command(g_resourcesPath + "usage.sh"), false,
+                           RunnerOptions(), usageOptions);
+  ::mesos::ContainerID containerId;
+  containerId.set_value("container_id");
+  isolator.prepare(containerId, ::mesos::slave::ContainerConfig()).await();
+  benchmark.run("isolator_usage", 200,
+                [&]() { isolator.usage(containerId).await(); });
+  isolator.cleanup(containerId).await();
+
+  // Recovery of the contexts saved before an agent restart, depending on the
+  // number of containers.
+  for (size_t containers : {100, 1000, 10000}) {
+    const string suffix = "_" + stringify(containers);
+    if (!benchmark.selected("isolator_recover_serial" + suffix) &&
+        !benchmark.selected("isolator_recover_parallel" + suffix) &&
+        !benchmark.selected("isolator_recover_lazy" + suffix)) {
+      continue;
+    }
+
+    IsolatorOptions options;
+    options.stateDir = stateDir;
+    ::mesos::slave::ContainerConfig containerConfig;
+    containerConfig.set_rootfs("/isolated_fs");
+    containerConfig.set_user("app_user");
+    containerConfig.set_directory("/var/lib/mesos/slaves/sandbox");
+    std::vector<::mesos::slave::ContainerState> states;
+    {
+      CommandIsolator previous("benchmark", None(), None(), None(), None(),
+                               None(), false, RunnerOptions(), options);
+      for (size_t i = 0; i < containers; ++i) {
+        ::mesos::slave::ContainerState state;
+        state.mutable_container_id()->set_value("container_" + stringify(i));
+        previous.prepare(state.container_id(), containerConfig).await();
+        states.push_back(state);
+      }
+    }
+
+    auto recover = [&](const string& name, const IsolatorOptions& options) {
+      CommandIsolator recovering("benchmark", None(), None(), None(), None(),
+                                 None(), false, RunnerOptions(), options);
+      benchmark.run(name + suffix, 5, [&]() {
+        recovering.recover(states, hashset<::mesos::ContainerID>()).await();
+      });
+    };
+    options.recoveryWorkers = 1;
+    recover("isolator_recover_serial", options);
+    options.recoveryWorkers = DEFAULT_RECOVERY_WORKERS;
+    recover("isolator_recover_parallel", options);
+    options.lazyRecovery = true;
+    recover("isolator_recover_lazy", options);
+  }
+  os::rmdir(stateDir);
+
+  std::cout << benchmark.report() << std::endl;
+  return benchmark.overBudget() ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+set(BENCHMARK_BINARY_NAME ${PROJECT_NAME}_benchmark)
+add_executable(${BENCHMARK_BINARY_NAME}
+  ${BENCHMARK_SOURCES}
+)
+
+target_link_directories(
+  ${BENCHMARK_BINARY_NAME}
+
+  PRIVATE ${MESOS_BUILD_DIR}/3rdparty/libprocess/src/
+  PRIVATE ${MESOS_ROOT_DIR}/3rdparty/libprocess/.libs/
+  PRIVATE ${MESOS_BUILD_DIR}/src/
+  )
+
+target_link_libraries(${BENCHMARK_BINARY_NAME}
+  ${PROJECT_NAME}
+  ${PROJECT_NAME}_statistics_writer
+  ${GLOG_LIBRARY}
+  ${PROTOBUF_LIBRARY}
+  ${MESOS-PROTOBUFS_LIBRARY}
+  process
+  pthread
+  )
+
+# The instrumented library needs the profiling runtime in the executable too.
+enable_pgo(${BENCHMARK_BINARY_NAME})
+
+add_custom_target(
+  bench
+  COMMAND ${CMAKE_COMMAND} -E env
+  BENCHMARK_RESOURCES_PATH=${CMAKE_SOURCE_DIR}/tests/scripts/
+  $<TARGET_FILE:${BENCHMARK_BINARY_NAME}>
+  DEPENDS ${BENCHMARK_BINARY_NAME}
+  )
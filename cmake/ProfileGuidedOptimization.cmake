@@ -0,0 +1,52 @@
+# Profile-guided optimization of the library, trained on the benchmark.
+#
+# PGO_MODE=GENERATE instruments the library, running the benchmark then
+# writes the profiles in PGO_PROFILE_DIR. PGO_MODE=USE rebuilds the library
+# optimized with these profiles. Both phases must use the same build
+# directory since GCC looks profiles up by object file path. Clang profiles
+# must be merged into ${PGO_PROFILE_DIR}/default.profdata beforehand, see
+# scripts/pgo_build.sh.
+set(PGO_MODE "OFF" CACHE STRING "Profile-guided optimization phase")
+set_property(CACHE PGO_MODE PROPERTY STRINGS OFF GENERATE USE)
+set(
+  PGO_PROFILE_DIR "${CMAKE_BINARY_DIR}/pgo-profiles"
+  CACHE PATH "Directory of the PGO profiles"
+  )
+
+if(PGO_MODE STREQUAL "GENERATE")
+  if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    set(PGO_FLAGS -fprofile-generate=${PGO_PROFILE_DIR})
+  else()
+    # The commands are run from several libprocess threads.
+    set(
+      PGO_FLAGS -fprofile-generate=${PGO_PROFILE_DIR} -fprofile-update=atomic
+      )
+  endif()
+elseif(PGO_MODE STREQUAL "USE")
+  if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    set(PGO_PROFILE ${PGO_PROFILE_DIR}/default.profdata)
+    set(PGO_FLAGS -fprofile-use=${PGO_PROFILE} -Wno-profile-instr-unprofiled)
+  else()
+    set(PGO_PROFILE ${PGO_PROFILE_DIR})
+    set(
+      PGO_FLAGS -fprofile-use=${PGO_PROFILE} -fprofile-correction
+      -Wno-missing-profile
+      )
+  endif()
+  if(NOT EXISTS ${PGO_PROFILE})
+    message(FATAL_ERROR "PGO_MODE=USE requires the profiles in ${PGO_PROFILE}")
+  endif()
+elseif(NOT PGO_MODE STREQUAL "OFF")
+  message(FATAL_ERROR "PGO_MODE must be OFF, GENERATE or USE")
+endif()
+
+if(NOT PGO_MODE STREQUAL "OFF")
+  message(STATUS "PGO ${PGO_MODE} with profiles in ${PGO_PROFILE_DIR}")
+endif()
+
+function(enable_pgo TARGET)
+  if(PGO_FLAGS)
+    target_compile_options(${TARGET} PRIVATE ${PGO_FLAGS})
+    target_link_options(${TARGET} PRIVATE ${PGO_FLAGS})
+  endif()
+endfunction()
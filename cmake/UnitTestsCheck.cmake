@@ -1,9 +1,23 @@
 set(TEST_SOURCES
+  ${CMAKE_SOURCE_DIR}/tests/AuditLogTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/CircuitBreakerTest.cpp
   ${CMAKE_SOURCE_DIR}/tests/CommandHookTest.cpp
   ${CMAKE_SOURCE_DIR}/tests/CommandIsolatorTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/CommandPlacementTest.cpp
   ${CMAKE_SOURCE_DIR}/tests/CommandRunnerTest.cpp
   ${CMAKE_SOURCE_DIR}/tests/ConfigurationParserTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/ContainerContextTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/DebugLogTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/ExecutableCacheTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/ExecutionQueueTest.cpp
   ${CMAKE_SOURCE_DIR}/tests/ModulesFactoryTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/StatisticsChannelTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/StatisticsFileSourceTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/TemporaryFilePoolTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/TestSocketServer.cpp
+  ${CMAKE_SOURCE_DIR}/tests/TracerTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/UnixSocketBackendTest.cpp
+  ${CMAKE_SOURCE_DIR}/tests/WatchSchedulerTest.cpp
   ${CMAKE_SOURCE_DIR}/tests/gtest_helpers.cpp
   ${CMAKE_SOURCE_DIR}/tests/main.cpp
 )
@@ -39,6 +53,7 @@ endif()
 
 target_link_libraries(${TEST_BINARY_NAME}
   ${PROJECT_NAME}
+  ${PROJECT_NAME}_statistics_writer
   ${GLOG_LIBRARY}
   ${GTEST_LIBRARY}
   ${PROTOBUF_LIBRARY}
@@ -0,0 +1,44 @@
+#! /bin/sh
+
+# Check that the benchmark of a build does not allocate more than the one of a
+# base revision, master by default. The base revision is built in a temporary
+# worktree and its report is given to the benchmark of the build as the
+# allocation baseline.
+
+usage() {
+  cat <<EOF
+usage: ${0##*/} build directory [base revision]
+EOF
+}
+
+if [ "$#" -lt "1" ] || [ "$#" -gt "2" ]; then
+  usage
+  exit 1
+fi
+
+set -e -x
+
+SOURCE_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD_DIR="$(cd "$1" && pwd)"
+BASE_DIR="$(mktemp -d)"
+
+cleanup() {
+  git -C "$SOURCE_DIR" worktree remove --force "$BASE_DIR/source" || true
+  rm -rf "$BASE_DIR"
+}
+trap cleanup EXIT
+
+git -C "$SOURCE_DIR" worktree add --detach "$BASE_DIR/source" "${2:-master}"
+# A base revision without the benchmark has no allocations to compare to.
+if [ ! -f "$BASE_DIR/source/benchmarks/Benchmark.cpp" ]; then
+  echo "The base revision has no benchmark, the allocations are not checked."
+  exit 0
+fi
+cmake -S "$BASE_DIR/source" -B "$BASE_DIR/build"
+cmake --build "$BASE_DIR/build" -j "$(nproc)" \
+  --target mesos_command_modules_benchmark
+
+export BENCHMARK_RESOURCES_PATH="$SOURCE_DIR/tests/scripts/"
+"$BASE_DIR/build/mesos_command_modules_benchmark" > "$BASE_DIR/base.json"
+BENCHMARK_ALLOCATION_BASELINE="$BASE_DIR/base.json" \
+  "$BUILD_DIR/mesos_command_modules_benchmark" > /dev/null
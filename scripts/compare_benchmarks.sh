@@ -0,0 +1,37 @@
+#! /bin/sh
+
+# Compare two benchmark reports produced by mesos_command_modules_benchmark,
+# e.g. the reports of a RelWithDebInfo and a PGO build. A negative change is
+# an improvement.
+
+usage() {
+  cat <<EOF
+usage: ${0##*/} baseline.json candidate.json
+EOF
+}
+
+if [ "$#" -ne "2" ]; then
+  usage
+  exit 1
+fi
+
+set -e
+
+jq -r -n --slurpfile baseline "$1" --slurpfile candidate "$2" '
+  def round1: . * 10 | round / 10;
+  ($baseline[0].benchmarks | map({(.name): .ns_per_op}) | add) as $base |
+  ($baseline[0].benchmarks | map({(.name): .allocs_per_op}) | add)
+    as $baseAllocs |
+  ["benchmark", "baseline_ns", "candidate_ns", "change", "baseline_allocs",
+   "candidate_allocs"],
+  ($candidate[0].benchmarks[] |
+    [.name,
+     (if $base[.name] then $base[.name] | round1 else "-" end),
+     (.ns_per_op | round1),
+     (if $base[.name] then
+        ((.ns_per_op - $base[.name]) * 100 / $base[.name] | round1
+         | tostring) + "%"
+      else "-" end),
+     (if $baseAllocs[.name] then $baseAllocs[.name] | round1 else "-" end),
+     (if .allocs_per_op then .allocs_per_op | round1 else "-" end)])
+  | @tsv'
@@ -0,0 +1,39 @@
+#! /bin/sh
+
+# Build the modules with profile-guided optimization trained on the
+# benchmark. The optimized library ends up in the given build directory.
+
+usage() {
+  cat <<EOF
+usage: ${0##*/} [build directory]
+EOF
+}
+
+if [ "$#" -gt "1" ]; then
+  usage
+  exit 1
+fi
+
+set -e -x
+
+SOURCE_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD_DIR="$(mkdir -p "${1:-build-pgo}" && cd "${1:-build-pgo}" && pwd)"
+PROFILE_DIR="$BUILD_DIR/pgo-profiles"
+
+rm -rf "$PROFILE_DIR"
+
+# Both phases share the build directory, GCC looks profiles up by object path.
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DCMAKE_BUILD_TYPE=Release \
+  -DPGO_MODE=GENERATE -DPGO_PROFILE_DIR="$PROFILE_DIR"
+cmake --build "$BUILD_DIR" -j "$(nproc)"
+BENCHMARK_RESOURCES_PATH="$SOURCE_DIR/tests/scripts/" \
+  "$BUILD_DIR/mesos_command_modules_benchmark" > /dev/null
+
+# Clang writes raw profiles which must be merged first.
+if ls "$PROFILE_DIR"/*.profraw > /dev/null 2>&1; then
+  llvm-profdata merge -output="$PROFILE_DIR/default.profdata" \
+    "$PROFILE_DIR"/*.profraw
+fi
+
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR" -DPGO_MODE=USE
+cmake --build "$BUILD_DIR" -j "$(nproc)"
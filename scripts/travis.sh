@@ -19,3 +19,12 @@ fi
 
 make -j "$(nproc)"
 TEST_RESOURCES_PATH=../tests/scripts/ make check
+
+# Pull requests are checked against the branch they target, pushes against
+# the previous commit.
+if [ -n "$TRAVIS" ] && [ "$TRAVIS_PULL_REQUEST" != "false" ]; then
+  git fetch origin "$TRAVIS_BRANCH"
+  ../scripts/check_allocations.sh . FETCH_HEAD
+else
+  ../scripts/check_allocations.sh . HEAD^
+fi
@@ -0,0 +1,148 @@
+#include "AuditLog.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <new>
+
+#include <stout/error.hpp>
+
+namespace criteo {
+namespace mesos {
+namespace audit {
+
+using std::string;
+
+uint64_t hash(const string& value) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : value) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/*
+ * Lock the whole audit file. Open file description locks are used so that two
+ * modules of the same agent conflict like two processes do.
+ */
+static int lockFile(int fd, short type, bool wait) {
+  struct flock lock = {};
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  return fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &lock);
+}
+
+Try<std::shared_ptr<AuditLog>> AuditLog::open(const string& path,
+                                              uint64_t capacity,
+                                              const string& module) {
+  if (capacity == 0) return Error("Audit log capacity must be positive");
+
+  size_t length = sizeof(Header) + capacity * sizeof(Record);
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd == -1) return ErrnoError("Failed to open audit file '" + path + "'");
+
+  // Every log mapping the file holds a shared lock on it until it is
+  // destroyed. The file is only resized under an exclusive lock, i.e., when no
+  // other log maps it, otherwise their mappings would end past the end of the
+  // file. Waiting for the shared lock only waits for an initialization.
+  bool exclusive = lockFile(fd, F_WRLCK, false) == 0;
+  if (!exclusive && ((errno != EAGAIN && errno != EACCES) ||
+                     lockFile(fd, F_RDLCK, true) == -1)) {
+    ErrnoError error("Failed to lock audit file '" + path + "'");
+    ::close(fd);
+    return error;
+  }
+
+  // Reuse the history of a previous run if the layout did not change.
+  bool compatible = false;
+  struct stat status;
+  if (fstat(fd, &status) == 0 &&
+      static_cast<size_t>(status.st_size) == length) {
+    Header header;
+    compatible = pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+                 header.magic == AUDIT_MAGIC &&
+                 header.version == AUDIT_VERSION &&
+                 header.recordSize == sizeof(Record) &&
+                 header.capacity == capacity;
+  }
+
+  if (!compatible && !exclusive) {
+    ::close(fd);
+    return Error("Audit file '" + path +
+                 "' is in use with another layout, modules sharing it must "
+                 "set the same capacity");
+  }
+
+  if (!compatible &&
+      (ftruncate(fd, 0) == -1 || ftruncate(fd, length) == -1)) {
+    ErrnoError error("Failed to resize audit file '" + path + "'");
+    ::close(fd);
+    return error;
+  }
+
+  void* mapping =
+      mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    ErrnoError error("Failed to map audit file '" + path + "'");
+    ::close(fd);
+    return error;
+  }
+
+  if (!compatible) {
+    Header* header = new (mapping) Header();
+    header->magic = AUDIT_MAGIC;
+    header->version = AUDIT_VERSION;
+    header->recordSize = sizeof(Record);
+    header->capacity = capacity;
+    header->next.store(0);
+  }
+
+  // The conversion is atomic, no other log can resize the file in between.
+  if (exclusive && lockFile(fd, F_RDLCK, false) == -1) {
+    ErrnoError error("Failed to lock audit file '" + path + "'");
+    munmap(mapping, length);
+    ::close(fd);
+    return error;
+  }
+
+  return std::shared_ptr<AuditLog>(
+      new AuditLog(fd, mapping, length, capacity, module));
+}
+
+AuditLog::AuditLog(int fd, void* mapping, size_t length, uint64_t capacity,
+                   const string& module)
+    : m_fd(fd),
+      m_mapping(mapping),
+      m_length(length),
+      m_capacity(capacity),
+      m_header(static_cast<Header*>(mapping)),
+      m_records(reinterpret_cast<Record*>(static_cast<char*>(mapping) +
+                                          sizeof(Header))),
+      m_module(module) {}
+
+AuditLog::~AuditLog() {
+  munmap(m_mapping, m_length);
+  ::close(m_fd);
+}
+
+void AuditLog::append(Record record) {
+  uint64_t index = m_header->next.fetch_add(1, std::memory_order_relaxed);
+  Record* slot = &m_records[index % m_capacity];
+
+  copyString(record.module, m_module);
+
+  // The sequence is reset while the record is written so that readers can
+  // detect a torn record.
+  __atomic_store_n(&slot->sequence, 0, __ATOMIC_RELAXED);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(reinterpret_cast<char*>(slot) + sizeof(slot->sequence),
+         reinterpret_cast<const char*>(&record) + sizeof(record.sequence),
+         sizeof(Record) - sizeof(record.sequence));
+  __atomic_store_n(&slot->sequence, index + 1, __ATOMIC_RELEASE);
+}
+
+}  // namespace audit
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,171 @@
+#ifndef __AUDIT_LOG_HPP__
+#define __AUDIT_LOG_HPP__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <stout/try.hpp>
+
+namespace criteo {
+namespace mesos {
+namespace audit {
+
+// Number of records kept in the ring if the user does not override it in
+// configuration.
+const uint64_t DEFAULT_AUDIT_CAPACITY = 65536;
+
+const uint32_t AUDIT_MAGIC = 0x54445541;  // "AUDT"
+const uint32_t AUDIT_VERSION = 1;
+
+// Flags of a record.
+const uint32_t AUDIT_FLAG_TIMED_OUT = 1 << 0;
+const uint32_t AUDIT_FLAG_FAILED = 1 << 1;
+const uint32_t AUDIT_FLAG_HAS_RUSAGE = 1 << 2;
+
+/*
+ * On-disk layout of the audit file: a header followed by `capacity` records.
+ * The layout is shared with the reader tool, any change must bump
+ * AUDIT_VERSION.
+ */
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t recordSize;
+  uint32_t reserved;
+  uint64_t capacity;
+  // Number of records ever appended, the next record goes to
+  // `next % capacity`.
+  std::atomic<uint64_t> next;
+  uint8_t padding[32];
+};
+
+struct Record {
+  // Position of the record in the history starting at 1. It is written last
+  // so that a record being written has a sequence of 0.
+  uint64_t sequence;
+  // Microseconds since epoch when the command was started.
+  uint64_t timestamp;
+  uint64_t durationMicros;
+  // FNV-1a hash of the container (or executor) id.
+  uint64_t containerHash;
+  char module[32];
+  char event[32];
+  // Exit code of the command, -1 if it did not exit normally.
+  int32_t exitCode;
+  // Signal which terminated the command, 0 if none.
+  int32_t signal;
+  uint32_t flags;
+  uint32_t reserved;
+  uint64_t inputSize;
+  uint64_t outputSize;
+  // Resource usage of the child, valid with AUDIT_FLAG_HAS_RUSAGE.
+  uint64_t userTimeMicros;
+  uint64_t systemTimeMicros;
+  uint64_t maxRssKilobytes;
+  uint64_t minorFaults;
+  uint64_t majorFaults;
+  uint8_t padding[24];
+};
+
+static_assert(sizeof(Header) == 64, "Audit header layout changed");
+static_assert(sizeof(Record) == 192, "Audit record layout changed");
+
+/**
+ * @return The FNV-1a hash of a string.
+ */
+uint64_t hash(const std::string& value);
+
+/**
+ * Copy a string into a fixed-size field of a record, truncating it if needed.
+ */
+template <size_t N>
+inline void copyString(char (&field)[N], const std::string& value) {
+  size_t length = std::min(value.size(), N - 1);
+  memcpy(field, value.data(), length);
+  field[length] = '\0';
+}
+
+/**
+ * Read a consistent copy of the record at a given position of the history.
+ *
+ * @param header The header of the mapped ring file.
+ * @param records The records of the mapped ring file.
+ * @param index The position of the record, starting at 0.
+ * @param record The copy of the record.
+ * @return false if the record has been overwritten or is being written.
+ */
+inline bool readRecord(const Header& header, const Record* records,
+                       uint64_t index, Record& record) {
+  const Record& slot = records[index % header.capacity];
+  uint64_t before = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+  memcpy(&record, &slot, sizeof(Record));
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t after = __atomic_load_n(&slot.sequence, __ATOMIC_RELAXED);
+  return before == index + 1 && after == before;
+}
+
+/**
+ * @brief The AuditLog appends one fixed-size record per command invocation to a
+ * memory-mapped ring file. Appending is lock-free and never performs any I/O
+ * syscall, the kernel writes the pages back in the background.
+ */
+class AuditLog {
+ public:
+  /**
+   * Open or create the ring file. An existing file with a compatible layout is
+   * reused so that the history survives agent restarts. A file opened by
+   * another log with a different layout is left untouched and an error is
+   * returned.
+   *
+   * @param path The path of the ring file.
+   * @param capacity The number of records of the ring.
+   * @param module The name of the module written in every record.
+   */
+  static Try<std::shared_ptr<AuditLog>> open(const std::string& path,
+                                             uint64_t capacity,
+                                             const std::string& module);
+
+  ~AuditLog();
+
+  /**
+   * Append a record. The sequence and module fields are filled by the log.
+   */
+  void append(Record record);
+
+  /**
+   * @return The number of records ever appended.
+   */
+  inline uint64_t size() const { return m_header->next.load(); }
+
+  inline uint64_t capacity() const { return m_capacity; }
+
+  inline bool read(uint64_t index, Record& record) const {
+    return readRecord(*m_header, m_records, index, record);
+  }
+
+ private:
+  AuditLog(int fd, void* mapping, size_t length, uint64_t capacity,
+           const std::string& module);
+
+  // Kept open to hold the shared lock on the file.
+  int m_fd;
+  void* m_mapping;
+  size_t m_length;
+  // Copied from the header, the log never trusts the shared mapping for the
+  // bounds of its writes.
+  uint64_t m_capacity;
+  Header* m_header;
+  Record* m_records;
+  std::string m_module;
+};
+
+}  // namespace audit
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __AUDIT_LOG_HPP__
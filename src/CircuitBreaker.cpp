@@ -0,0 +1,127 @@
+#include "CircuitBreaker.hpp"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace criteo {
+namespace mesos {
+
+using std::string;
+using std::chrono::steady_clock;
+
+const uint8_t OUTCOME_FAILED = 1 << 0;
+const uint8_t OUTCOME_SLOW = 1 << 1;
+
+CircuitBreaker::CircuitBreaker(const string& name,
+                               const CircuitBreakerOptions& options)
+    : m_name(name),
+      m_options(options),
+      m_state(CLOSED),
+      m_generation(0),
+      m_outcomes(std::max<size_t>(options.window, 1), 0),
+      m_next(0),
+      m_recorded(0),
+      m_failures(0),
+      m_slowCalls(0),
+      m_trials(0) {}
+
+Option<uint64_t> CircuitBreaker::tryAcquire() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state == CLOSED) return m_generation;
+
+  if (m_state == OPEN) {
+    if (steady_clock::now() < m_openUntil) return None();
+    m_state = HALF_OPEN;
+    ++m_generation;
+    m_trials = 0;
+  }
+  if (m_trials >= m_options.halfOpenTrials) return None();
+  ++m_trials;
+  return m_generation;
+}
+
+void CircuitBreaker::record(uint64_t generation, bool failed, bool slow) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // The call was allowed before the last change of state, e.g. before the
+  // breaker opened, the command has been judged since.
+  if (generation != m_generation) return;
+
+  switch (m_state) {
+    case OPEN:
+      return;
+    case HALF_OPEN:
+      if (m_trials > 0) --m_trials;
+      if (failed || slow) {
+        LOG(WARNING) << "Command \"" << m_name << "\" is still failing";
+        open(steady_clock::now());
+      } else {
+        close();
+      }
+      return;
+    case CLOSED:
+      break;
+  }
+
+  uint8_t& outcome = m_outcomes[m_next];
+  if (m_recorded == m_outcomes.size()) {
+    if (outcome & OUTCOME_FAILED) --m_failures;
+    if (outcome & OUTCOME_SLOW) --m_slowCalls;
+  } else {
+    ++m_recorded;
+  }
+  outcome = (failed ? OUTCOME_FAILED : 0) | (slow ? OUTCOME_SLOW : 0);
+  if (failed) ++m_failures;
+  if (slow) ++m_slowCalls;
+  m_next = (m_next + 1) % m_outcomes.size();
+
+  if (m_recorded * 2 < m_outcomes.size()) return;
+  if (m_failures >= m_options.failureRate * m_recorded ||
+      m_slowCalls >= m_options.slowCallRate * m_recorded) {
+    LOG(WARNING) << "Command \"" << m_name << "\" is not run for "
+                 << m_options.cooldown << ": " << m_failures << " of its last "
+                 << m_recorded << " calls failed and " << m_slowCalls
+                 << " were slow";
+    open(steady_clock::now());
+  }
+}
+
+CircuitBreaker::State CircuitBreaker::state() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_state;
+}
+
+void CircuitBreaker::open(steady_clock::time_point now) {
+  m_state = OPEN;
+  ++m_generation;
+  m_openUntil = now + std::chrono::nanoseconds(m_options.cooldown.ns());
+}
+
+void CircuitBreaker::close() {
+  LOG(INFO) << "Command \"" << m_name << "\" recovered";
+  m_state = CLOSED;
+  ++m_generation;
+  std::fill(m_outcomes.begin(), m_outcomes.end(), 0);
+  m_next = 0;
+  m_recorded = 0;
+  m_failures = 0;
+  m_slowCalls = 0;
+}
+
+CircuitBreakers::CircuitBreakers(const CircuitBreakerOptions& options)
+    : m_options(options) {}
+
+std::shared_ptr<CircuitBreaker> CircuitBreakers::get(const string& executable,
+                                                     const string& event) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::shared_ptr<CircuitBreaker>& breaker =
+      m_breakers[std::make_pair(executable, event)];
+  if (!breaker) {
+    breaker = std::make_shared<CircuitBreaker>(
+        executable + " (" + event + ")", m_options);
+  }
+  return breaker;
+}
+
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,139 @@
+#ifndef __CIRCUIT_BREAKER_HPP__
+#define __CIRCUIT_BREAKER_HPP__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stout/duration.hpp>
+#include <stout/option.hpp>
+
+namespace criteo {
+namespace mesos {
+
+// Settings of the circuit breakers if the user does not override them in
+// configuration.
+const size_t DEFAULT_CIRCUIT_BREAKER_WINDOW = 20;
+const double DEFAULT_CIRCUIT_BREAKER_FAILURE_RATE = 0.5;
+const double DEFAULT_CIRCUIT_BREAKER_SLOW_CALL_RATE = 0.8;
+const Duration DEFAULT_CIRCUIT_BREAKER_COOLDOWN = Seconds(30);
+
+/**
+ * @brief The settings of the circuit breakers of a module.
+ */
+struct CircuitBreakerOptions {
+  CircuitBreakerOptions()
+      : window(DEFAULT_CIRCUIT_BREAKER_WINDOW),
+        failureRate(DEFAULT_CIRCUIT_BREAKER_FAILURE_RATE),
+        slowCallRate(DEFAULT_CIRCUIT_BREAKER_SLOW_CALL_RATE),
+        slowCallRatio(0.5),
+        cooldown(DEFAULT_CIRCUIT_BREAKER_COOLDOWN),
+        halfOpenTrials(1) {}
+
+  // Number of most recent calls the rates are computed on. The breaker does
+  // not open before half of the window is filled.
+  size_t window;
+  // Rate of failed calls opening the breaker: the calls which timed out, were
+  // killed by a signal or could not be run, not the ones exiting with a
+  // non-zero code.
+  double failureRate;
+  // Rate of slow calls opening the breaker.
+  double slowCallRate;
+  // Part of its timeout after which a call is considered slow.
+  double slowCallRatio;
+  // Time during which the calls are rejected once the breaker opened.
+  Duration cooldown;
+  // Number of calls let through at once to probe the command after the
+  // cooldown.
+  size_t halfOpenTrials;
+};
+
+/**
+ * @brief The CircuitBreaker stops running a command which keeps failing or
+ * is too slow. Once the failure or slow call rate of its recent calls crosses
+ * a threshold, the calls are rejected without running the command for a
+ * cooldown window. A few trial calls are then let through: the breaker closes
+ * if they succeed and opens again otherwise. It is thread-safe.
+ */
+class CircuitBreaker {
+ public:
+  enum State { CLOSED, OPEN, HALF_OPEN };
+
+  CircuitBreaker(const std::string& name, const CircuitBreakerOptions& options);
+
+  /**
+   * @return None if the call must be rejected, otherwise the generation of
+   *   the breaker its outcome must be recorded with.
+   */
+  Option<uint64_t> tryAcquire();
+
+  /**
+   * Record the outcome of a call allowed by tryAcquire. The outcome is
+   * ignored if the breaker changed state since the call was allowed, e.g. a
+   * call started before the breaker opened does not decide of a trial.
+   *
+   * @param generation The generation returned by tryAcquire.
+   * @param failed Whether the call timed out, was killed by a signal or could
+   *   not be run.
+   * @param slow Whether the call took longer than expected.
+   */
+  void record(uint64_t generation, bool failed, bool slow);
+
+  State state() const;
+
+  inline const CircuitBreakerOptions& options() const { return m_options; }
+
+ private:
+  void open(std::chrono::steady_clock::time_point now);
+  void close();
+
+  const std::string m_name;
+  const CircuitBreakerOptions m_options;
+
+  mutable std::mutex m_mutex;
+  State m_state;
+  // Incremented on every change of state.
+  uint64_t m_generation;
+  // Outcomes of the recent calls, as flags, in a ring.
+  std::vector<uint8_t> m_outcomes;
+  size_t m_next;
+  size_t m_recorded;
+  size_t m_failures;
+  size_t m_slowCalls;
+  std::chrono::steady_clock::time_point m_openUntil;
+  size_t m_trials;
+};
+
+/**
+ * @brief The circuit breakers of the executables of a module, one per
+ * executable and event so that an executable failing on one event keeps
+ * being run on the others.
+ */
+class CircuitBreakers {
+ public:
+  explicit CircuitBreakers(const CircuitBreakerOptions& options);
+
+  /**
+   * @return The breaker of an executable on an event, created on first use.
+   */
+  std::shared_ptr<CircuitBreaker> get(const std::string& executable,
+                                      const std::string& event);
+
+ private:
+  const CircuitBreakerOptions m_options;
+  std::mutex m_mutex;
+  std::map<std::pair<std::string, std::string>,
+           std::shared_ptr<CircuitBreaker>>
+      m_breakers;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __CIRCUIT_BREAKER_HPP__
@@ -2,6 +2,10 @@
 #define COMMAND_HPP
 
 #include <string>
+#include <vector>
+
+#include <stout/option.hpp>
+#include <stout/strings.hpp>
 
 namespace criteo {
 namespace mesos {
@@ -14,13 +18,20 @@ const float DEFAULT_COMMAND_FREQUENCE = 30;
 /**
  * @brief The Command class represents a command, i.e., a command to be run and
  * a timeout before the command is terminated.
+ *
+ * A command can list several executables separated by commas, they are run
+ * concurrently and their outputs are merged.
  */
 class Command {
  public:
   Command(const std::string& command)
-      : m_cmd(command), m_timeout(DEFAULT_COMMAND_TIMEOUT) {}
+      : m_cmd(command),
+        m_timeout(DEFAULT_COMMAND_TIMEOUT),
+        m_executables(splitExecutables(command)) {}
   Command(const std::string& command, unsigned long timeout)
-      : m_cmd(command), m_timeout(timeout) {}
+      : m_cmd(command),
+        m_timeout(timeout),
+        m_executables(splitExecutables(command)) {}
 
   bool operator==(const Command& that) const {
     return m_cmd == that.m_cmd && m_timeout == that.m_timeout;
@@ -29,11 +40,40 @@ class Command {
   inline const std::string& command() const { return m_cmd; }
   inline unsigned long timeout() const { return m_timeout; }
 
+  /**
+   * @return The executables of the command in their configured order.
+   */
+  inline const std::vector<std::string>& executables() const {
+    return m_executables;
+  }
+
+  /**
+   * @return One command per executable sharing the timeout of this one.
+   */
+  std::vector<Command> split() const {
+    std::vector<Command> commands;
+    commands.reserve(m_executables.size());
+    for (const std::string& executable : m_executables) {
+      commands.push_back(Command(executable, m_timeout));
+    }
+    return commands;
+  }
+
   void setTimeout(const unsigned long timeout) { m_timeout = timeout; }
 
  private:
+  static std::vector<std::string> splitExecutables(const std::string& command) {
+    std::vector<std::string> executables;
+    for (const std::string& token : strings::tokenize(command, ",")) {
+      std::string executable = strings::trim(token);
+      if (!executable.empty()) executables.push_back(executable);
+    }
+    return executables;
+  }
+
   std::string m_cmd;
   unsigned long m_timeout;
+  std::vector<std::string> m_executables;
 };
 
 class RecurrentCommand : public Command {
@@ -45,15 +85,47 @@ class RecurrentCommand : public Command {
       : Command(command, timeout), m_frequence(frequence) {}
 
   bool operator==(const RecurrentCommand& that) const {
-    return Command::operator==(that) && m_frequence == that.m_frequence;
+    return Command::operator==(that) && m_frequence == that.m_frequence &&
+           minFrequence() == that.minFrequence() &&
+           maxFrequence() == that.maxFrequence();
   }
 
   inline float frequence() const { return m_frequence; }
 
+  /**
+   * The bounds of the interval between two runs when the command reports how
+   * close the container is to its limits. They default to the frequence, i.e.,
+   * the interval does not adapt.
+   */
+  inline float minFrequence() const {
+    return m_minFrequence.getOrElse(m_frequence);
+  }
+  inline float maxFrequence() const {
+    return m_maxFrequence.getOrElse(m_frequence);
+  }
+
   void setFrequence(const float frequence) { m_frequence = frequence; }
+  void setMinFrequence(const float frequence) { m_minFrequence = frequence; }
+  void setMaxFrequence(const float frequence) { m_maxFrequence = frequence; }
 
  private:
   float m_frequence;
+  Option<float> m_minFrequence;
+  Option<float> m_maxFrequence;
+};
+
+/**
+ * @brief The CommandSet struct groups the commands handling the events of an
+ * isolator. An isolator can host several command sets sharing the context of
+ * the same containers.
+ */
+struct CommandSet {
+  std::string name;
+  Option<Command> prepareCommand;
+  Option<Command> isolateCommand;
+  Option<RecurrentCommand> watchCommand;
+  Option<Command> cleanupCommand;
+  Option<Command> usageCommand;
 };
 
 }  // namespace mesos
@@ -1,89 +1,245 @@
 #include "CommandHook.hpp"
 #include "CommandRunner.hpp"
+#include "ExecutionQueue.hpp"
 #include "Helpers.hpp"
 #include "Logger.hpp"
 
+#include <glog/logging.h>
+
+#include <stout/numify.hpp>
+
 namespace criteo {
 namespace mesos {
 
 using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+
+typedef std::pair<Option<::mesos::Labels>, Option<::mesos::Environment>>
+    LaunchDecoration;
+
+static string executorKey(const ::mesos::ExecutorInfo& executorInfo) {
+  return executorInfo.framework_id().value() + "/" +
+         executorInfo.executor_id().value();
+}
+
+/*
+ * Record the weight of a framework in the execution queues if its
+ * FrameworkInfo sets one.
+ */
+static void recordFrameworkWeight(const ::mesos::FrameworkInfo& frameworkInfo) {
+  for (const ::mesos::Label& label : frameworkInfo.labels().labels()) {
+    if (label.key() != FRAMEWORK_WEIGHT_LABEL) continue;
+    Try<double> weight = numify<double>(label.value());
+    if (weight.isError() || weight.get() <= 0) {
+      LOG(WARNING) << "Ignoring the invalid weight \"" << label.value()
+                   << "\" of framework " << frameworkInfo.id().value();
+      return;
+    }
+    ExecutionQueue::setFrameworkWeight(frameworkInfo.id().value(),
+                                       weight.get());
+  }
+}
+
+/*
+ * Parse a member of the outputs of the launch decorator and merge it into
+ * one message.
+ */
+template <class Proto>
+static Try<Option<Proto>> mergeMember(const vector<JSON::Object>& outputs,
+                                      const string& name) {
+  Option<Proto> merged;
+  for (const JSON::Object& output : outputs) {
+    auto member = output.values.find(name);
+    if (member == output.values.end()) continue;
+    if (!member->second.is<JSON::Object>()) {
+      return Error("Malformed Protobuf. JSON object is expected for \"" +
+                   name + "\".");
+    }
+    Try<Proto> proto =
+        ::protobuf::parse<Proto>(member->second.as<JSON::Object>());
+    if (proto.isError()) {
+      return Error("Error while converting JSON to protobuf. " +
+                   proto.error());
+    }
+    if (merged.isNone()) {
+      merged = std::move(proto.get());
+    } else {
+      merged->MergeFrom(proto.get());
+    }
+  }
+  return merged;
+}
 
 CommandHook::CommandHook(const Option<Command>& runTaskLabelCommand,
                          const Option<Command>& executorEnvironmentCommand,
                          const Option<Command>& removeExecutorCommand,
-                         bool isDebugMode)
+                         bool isDebugMode, const RunnerOptions& runnerOptions,
+                         const Option<Command>& launchDecoratorCommand,
+                         const Duration& launchDecorationTtl)
     : m_runTaskLabelCommand(runTaskLabelCommand),
       m_executorEnvironmentCommand(executorEnvironmentCommand),
       m_removeExecutorCommand(removeExecutorCommand),
-      m_isDebugMode(isDebugMode) {}
+      m_isDebugMode(isDebugMode),
+      m_runnerOptions(runnerOptions),
+      m_launchDecoratorCommand(launchDecoratorCommand),
+      m_launchDecorationTtl(
+          std::chrono::nanoseconds(launchDecorationTtl.ns())) {}
+
+Try<LaunchDecoration> CommandHook::runLaunchDecorator(
+    const JSON::Object& inputsJson, const logging::Metadata& metadata) {
+  Try<vector<string>> outputs =
+      CommandRunner(m_isDebugMode, metadata, m_runnerOptions)
+          .runAll(m_launchDecoratorCommand.get(), stringify(inputsJson));
+  if (outputs.isError()) {
+    return Error(outputs.error());
+  }
+
+  vector<JSON::Object> objects;
+  for (const string& output : outputs.get()) {
+    if (output.empty()) continue;
+    Try<JSON::Object> object = JSON::parse<JSON::Object>(output);
+    if (object.isError()) {
+      return Error("Malformed JSON. " + object.error());
+    }
+    objects.push_back(object.get());
+  }
+
+  Try<Option<::mesos::Labels>> labels =
+      mergeMember<::mesos::Labels>(objects, "labels");
+  if (labels.isError()) return Error(labels.error());
+  Try<Option<::mesos::Environment>> environment =
+      mergeMember<::mesos::Environment>(objects, "environment");
+  if (environment.isError()) return Error(environment.error());
+  return LaunchDecoration(labels.get(), environment.get());
+}
 
 Result<::mesos::Labels> CommandHook::slaveRunTaskLabelDecorator(
     const ::mesos::TaskInfo& taskInfo,
     const ::mesos::ExecutorInfo& executorInfo,
     const ::mesos::FrameworkInfo& frameworkInfo,
     const ::mesos::SlaveInfo& slaveInfo) {
-  if (m_runTaskLabelCommand.isNone()) {
+  recordFrameworkWeight(frameworkInfo);
+  if (m_runTaskLabelCommand.isNone() && m_launchDecoratorCommand.isNone()) {
     return None();
   }
 
   logging::Metadata metadata = {executorInfo.executor_id().value(),
-                                "slaveRunTaskLabelDecorator"};
+                                "slaveRunTaskLabelDecorator",
+                                frameworkInfo.id().value()};
+  metadata.invocation = tracing::Tracer::instance().nextInvocation();
 
   JSON::Object inputsJson;
   inputsJson.values["task_info"] = JSON::protobuf(taskInfo);
   inputsJson.values["executor_info"] = JSON::protobuf(executorInfo);
   inputsJson.values["framework_info"] = JSON::protobuf(frameworkInfo);
   inputsJson.values["slave_info"] = JSON::protobuf(slaveInfo);
-  Try<string> output =
-      CommandRunner(m_isDebugMode, metadata)
-          .run(m_runTaskLabelCommand.get(), stringify(inputsJson));
 
-  if (output.isError()) {
-    return Error(output.error());
+  if (m_launchDecoratorCommand.isSome()) {
+    Try<LaunchDecoration> decoration = runLaunchDecorator(inputsJson, metadata);
+    if (decoration.isError()) {
+      return Error(decoration.error());
+    }
+
+    // The environment hook of the executor follows, it is answered from
+    // memory instead of running the command again.
+    steady_clock::time_point now = steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_pendingEnvironmentsMutex);
+    for (auto it = m_pendingEnvironments.begin();
+         it != m_pendingEnvironments.end();) {
+      if (it->second.expiry <= now) {
+        it = m_pendingEnvironments.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    m_pendingEnvironments[executorKey(executorInfo)] =
+        PendingEnvironment{decoration->second, now + m_launchDecorationTtl};
+    return decoration->first;
   }
 
-  return jsonToProtobuf<::mesos::Labels>(output.get());
+  Try<vector<string>> outputs =
+      CommandRunner(m_isDebugMode, metadata, m_runnerOptions)
+          .runAll(m_runTaskLabelCommand.get(), stringify(inputsJson));
+
+  if (outputs.isError()) {
+    return Error(outputs.error());
+  }
+
+  return mergeOutputs<::mesos::Labels>(outputs.get(), metadata);
 }
 
 Result<::mesos::Environment> CommandHook::slaveExecutorEnvironmentDecorator(
     const ::mesos::ExecutorInfo& executorInfo) {
-  if (m_executorEnvironmentCommand.isNone()) {
+  if (m_executorEnvironmentCommand.isNone() &&
+      m_launchDecoratorCommand.isNone()) {
     return None();
   }
 
   logging::Metadata metadata = {executorInfo.executor_id().value(),
-                                "slaveExecutorEnvironmentDecorator"};
+                                "slaveExecutorEnvironmentDecorator",
+                                executorInfo.framework_id().value()};
+  metadata.invocation = tracing::Tracer::instance().nextInvocation();
 
   JSON::Object inputsJson;
   inputsJson.values["executor_info"] = JSON::protobuf(executorInfo);
-  Try<string> output =
-      CommandRunner(m_isDebugMode, metadata)
-          .run(m_executorEnvironmentCommand.get(), stringify(inputsJson));
 
-  if (output.isError()) {
-    return Error(output.error());
+  if (m_launchDecoratorCommand.isSome()) {
+    {
+      std::lock_guard<std::mutex> lock(m_pendingEnvironmentsMutex);
+      auto pending = m_pendingEnvironments.find(executorKey(executorInfo));
+      if (pending != m_pendingEnvironments.end()) {
+        PendingEnvironment environment = pending->second;
+        m_pendingEnvironments.erase(pending);
+        if (environment.expiry > steady_clock::now()) {
+          return environment.environment;
+        }
+      }
+    }
+
+    // The labels hook did not run for this executor or too long ago, the
+    // command gets the inputs of the environment hook only.
+    Try<LaunchDecoration> decoration = runLaunchDecorator(inputsJson, metadata);
+    if (decoration.isError()) {
+      return Error(decoration.error());
+    }
+    return decoration->second;
+  }
+  Try<vector<string>> outputs =
+      CommandRunner(m_isDebugMode, metadata, m_runnerOptions)
+          .runAll(m_executorEnvironmentCommand.get(), stringify(inputsJson));
+
+  if (outputs.isError()) {
+    return Error(outputs.error());
   }
 
-  return jsonToProtobuf<::mesos::Environment>(output.get());
+  return mergeOutputs<::mesos::Environment>(outputs.get(), metadata);
 }
 
 Try<Nothing> CommandHook::slaveRemoveExecutorHook(
     const ::mesos::FrameworkInfo& frameworkInfo,
     const ::mesos::ExecutorInfo& executorInfo) {
+  if (m_launchDecoratorCommand.isSome()) {
+    std::lock_guard<std::mutex> lock(m_pendingEnvironmentsMutex);
+    m_pendingEnvironments.erase(executorKey(executorInfo));
+  }
+
   if (m_removeExecutorCommand.isNone()) return Nothing();
 
   logging::Metadata metadata = {executorInfo.executor_id().value(),
-                                "slaveExecutorEnvironmentDecorator"};
+                                "slaveRemoveExecutorHook",
+                                frameworkInfo.id().value()};
+  metadata.invocation = tracing::Tracer::instance().nextInvocation();
 
   JSON::Object inputsJson;
   inputsJson.values["framework_info"] = JSON::protobuf(frameworkInfo);
   inputsJson.values["executor_info"] = JSON::protobuf(executorInfo);
-  Try<string> output =
-      CommandRunner(m_isDebugMode, metadata)
-          .run(m_removeExecutorCommand.get(), stringify(inputsJson));
+  Try<vector<string>> outputs =
+      CommandRunner(m_isDebugMode, metadata, m_runnerOptions)
+          .runAll(m_removeExecutorCommand.get(), stringify(inputsJson));
 
-  if (output.isError()) {
-    return Error(output.error());
+  if (outputs.isError()) {
+    return Error(outputs.error());
   }
 
   return Nothing();
@@ -1,18 +1,31 @@
 #ifndef __COMMAND_HOOK_HPP__
 #define __COMMAND_HOOK_HPP__
 
+#include <chrono>
+#include <mutex>
 #include <string>
+#include <utility>
 
 #include <Command.hpp>
+#include <Logger.hpp>
+#include <RunnerOptions.hpp>
 
 #include <mesos/hook.hpp>
 #include <mesos/module/hook.hpp>
 
+#include <stout/duration.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/json.hpp>
 #include <stout/option.hpp>
 
 namespace criteo {
 namespace mesos {
 
+// Time during which the environment computed by the launch decorator waits
+// for the environment hook of its executor, if the user does not override it
+// in configuration.
+const Duration DEFAULT_LAUNCH_DECORATION_TTL = Seconds(60);
+
 /**
  * Hook calling external commands to handle hook events.
  *
@@ -35,11 +48,21 @@ class CommandHook : public ::mesos::Hook {
    *   slaveRemoveExecutorHook if provided.
    * @param isDebugMode If true, logs inputs and outputs of the commands,
    *   otherwise logs nothing
+   * @param runnerOptions The settings applied to every command run.
+   * @param launchDecoratorCommand The command computing both the labels and
+   *   the environment of an executor in slaveRunTaskLabelDecorator, used
+   *   instead of the two commands above if provided.
+   * @param launchDecorationTtl The time during which the environment
+   *   computed by the launch decorator is kept for
+   *   slaveExecutorEnvironmentDecorator.
    */
-  explicit CommandHook(const Option<Command> &runTaskLabelCommand,
-                       const Option<Command> &executorEnvironmentCommand,
-                       const Option<Command> &removeExecutorCommand,
-                       bool isDebugMode = false);
+  explicit CommandHook(
+      const Option<Command> &runTaskLabelCommand,
+      const Option<Command> &executorEnvironmentCommand,
+      const Option<Command> &removeExecutorCommand, bool isDebugMode = false,
+      const RunnerOptions &runnerOptions = RunnerOptions(),
+      const Option<Command> &launchDecoratorCommand = None(),
+      const Duration &launchDecorationTtl = DEFAULT_LAUNCH_DECORATION_TTL);
 
   virtual ~CommandHook() {}
 
@@ -98,11 +121,41 @@ class CommandHook : public ::mesos::Hook {
     return m_removeExecutorCommand;
   }
 
+  inline const Option<Command> &launchDecoratorCommand() const {
+    return m_launchDecoratorCommand;
+  }
+
  private:
+  /*
+   * Environment computed by the launch decorator, waiting for the
+   * environment hook of its executor.
+   */
+  struct PendingEnvironment {
+    Option<::mesos::Environment> environment;
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  /*
+   * Run the launch decorator command with the inputs available to a hook.
+   *
+   * @return The labels and the environment of the executor, each of them
+   *   being None if the command did not output it.
+   */
+  Try<std::pair<Option<::mesos::Labels>, Option<::mesos::Environment>>>
+  runLaunchDecorator(const JSON::Object &inputsJson,
+                     const logging::Metadata &metadata);
+
   Option<Command> m_runTaskLabelCommand;
   Option<Command> m_executorEnvironmentCommand;
   Option<Command> m_removeExecutorCommand;
   bool m_isDebugMode;
+  RunnerOptions m_runnerOptions;
+
+  Option<Command> m_launchDecoratorCommand;
+  std::chrono::steady_clock::duration m_launchDecorationTtl;
+  // Pending environments by framework and executor id.
+  std::mutex m_pendingEnvironmentsMutex;
+  hashmap<std::string, PendingEnvironment> m_pendingEnvironments;
 };
 }  // namespace mesos
 }  // namespace criteo
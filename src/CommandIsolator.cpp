@@ -1,14 +1,28 @@
 #include "CommandIsolator.hpp"
 #include "CommandRunner.hpp"
+#include "ContainerContext.hpp"
 #include "Helpers.hpp"
 #include "Logger.hpp"
+#include "Probes.hpp"
+#include "StatisticsChannel.hpp"
+#include "StatisticsFileSource.hpp"
+#include "WatchScheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <thread>
 
 #include <glog/logging.h>
-#include <process/after.hpp>
+#include <process/collect.hpp>
+#include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/dispatch.hpp>
-#include <process/loop.hpp>
+#include <process/future.hpp>
 #include <process/process.hpp>
 #include <process/time.hpp>
+#include <stout/lambda.hpp>
 #include <stout/os/mkdir.hpp>
 #include <stout/os/rm.hpp>
 
@@ -17,6 +31,7 @@ namespace mesos {
 
 using process::Clock;
 using std::string;
+using std::vector;
 
 using ::mesos::ContainerID;
 using ::mesos::slave::ContainerConfig;
@@ -24,24 +39,34 @@ using ::mesos::slave::ContainerLaunchInfo;
 using ::mesos::slave::ContainerLimitation;
 using ::mesos::slave::ContainerState;
 
-using process::Break;
-using process::Continue;
-using process::ControlFlow;
 using process::Failure;
 using process::Future;
-using process::loop;
-using process::after;
+using process::Promise;
 
-const string COMMAND_ISOLATOR_STATE_DIR = "/var/run/mesos/isolators/command";
+Duration frequenceToDuration(float frequence) {
+  return Milliseconds(static_cast<int64_t>(frequence * 1000));
+}
+
+/*
+ * A watch output made of a single "pressure" field between 0 and 1 reports
+ * how close the container is to its limits instead of a limitation.
+ *
+ * @return The pressure, None if the output is something else.
+ */
+Option<double> extractPressure(const JSON::Object& output) {
+  if (output.values.size() != 1) return None();
+
+  Result<JSON::Number> pressure = output.at<JSON::Number>("pressure");
+  if (!pressure.isSome()) return None();
+  return pressure->as<double>();
+}
 
 class CommandIsolatorProcess : public process::Process<CommandIsolatorProcess> {
  public:
   CommandIsolatorProcess(const string& name,
-                         const Option<Command>& prepareCommand,
-                         const Option<Command>& isolateCommand,
-                         const Option<RecurrentCommand>& watchCommand,
-                         const Option<Command>& cleanupCommand,
-                         const Option<Command>& usageCommand, bool isDebugMode);
+                         const vector<CommandSet>& commandSets,
+                         bool isDebugMode, const RunnerOptions& runnerOptions,
+                         const IsolatorOptions& isolatorOptions);
 
   virtual process::Future<Option<ContainerLaunchInfo>> prepare(
       const ContainerID& containerId, const ContainerConfig& containerConfig);
@@ -62,20 +87,26 @@ class CommandIsolatorProcess : public process::Process<CommandIsolatorProcess> {
   virtual process::Future<::mesos::ResourceStatistics> usage(
       const ContainerID& containerId);
 
+  inline const vector<CommandSet>& commandSets() const {
+    return m_commandSets;
+  }
   inline const Option<Command>& prepareCommand() const {
-    return m_prepareCommand;
+    return m_commandSets.front().prepareCommand;
   }
   inline const Option<Command>& isolateCommand() const {
-    return m_isolateCommand;
+    return m_commandSets.front().isolateCommand;
   }
   inline const Option<Command>& cleanupCommand() const {
-    return m_cleanupCommand;
+    return m_commandSets.front().cleanupCommand;
   }
 
   inline bool hasContainerContext(const ContainerID& containerId) {
-    return m_infos.contains(containerId);
+    return m_infos.contains(containerId) || m_unrecovered.contains(containerId);
   }
 
+ protected:
+  virtual void initialize();
+
  private:
   inline static ::mesos::ResourceStatistics emptyStats(
       double timestamp = Clock::now().secs()) {
@@ -88,34 +119,183 @@ class CommandIsolatorProcess : public process::Process<CommandIsolatorProcess> {
                                     const ContainerConfig& containerConfig);
   Try<ContainerConfig> restoreContainerContext(const ContainerID& containerId);
   Try<Nothing> cleanContainerContext(const ContainerID& containerId);
+  // Build the input of a command from the members of `input` and the config
+  // of the container.
+  static string withContainerConfig(const JSON::Object& input,
+                                    const ContainerContext& context);
+  // Parse the context of a container left unrecovered by a lazy recovery.
+  // @return false if the isolator has no context for the container.
+  bool loadContainerContext(const ContainerID& containerId);
+
+  // Stop the watch checks of a container and discard its limitation.
+  void stopWatch(const ContainerID& containerId);
+
+  // Run the usage command of a container. The statistics are empty if the
+  // command fails.
+  process::Future<::mesos::ResourceStatistics> collectUsage(
+      const ContainerID& containerId);
+
+  // Start a round of the background refresh of the usage snapshots of all
+  // the containers, the next round is delayed until this one completes.
+  void refreshUsage();
+  // Run the usage commands of the round within the concurrency budget.
+  void refreshNextUsage();
+  void usageRefreshed(const ContainerID& containerId,
+                      const Future<::mesos::ResourceStatistics>& statistics);
+
+  // Run the cleanup commands of the orphan containers within the concurrency
+  // budget, then remove their context.
+  void cleanupNextOrphans();
+  void orphanCleaned(const ContainerID& containerId,
+                     const Future<vector<Try<string>>>& outputs);
+  void orphanCleanupDone(const ContainerID& containerId,
+                         const Future<Nothing>& result);
+
+  // @return true if any command set has a command for the event.
+  bool hasCommand(Option<Command> CommandSet::*event) const;
+
+  // Run the command of an event in every command set concurrently.
+  // @return The outputs of all the executables, in the order of the command
+  //   sets.
+  Future<vector<Try<string>>> runCommands(Option<Command> CommandSet::*event,
+                                          const logging::Metadata& metadata,
+                                          const string& input);
+
+  // Build the logging metadata of a call for a given container.
+  logging::Metadata callMetadata(const ContainerID& containerId,
+                                 const string& method);
 
   string m_name;
-  Option<Command> m_prepareCommand;
-  Option<Command> m_isolateCommand;
-  Option<RecurrentCommand> m_watchCommand;
-  Option<Command> m_cleanupCommand;
-  Option<Command> m_usageCommand;
+  // Never empty, the first set holds the commands configured without prefix.
+  vector<CommandSet> m_commandSets;
   bool m_isDebugMode;
-  hashmap<ContainerID, ContainerConfig> m_infos;
+  RunnerOptions m_runnerOptions;
+  string m_stateDir;
+  size_t m_recoveryWorkers;
+  bool m_lazyRecovery;
+  // The configs are shared with the commands they are passed to, their
+  // members repeated between containers are interned.
+  ContainerContextInterner m_contexts;
+  hashmap<ContainerID, std::shared_ptr<const ContainerContext>> m_infos;
+  // Containers recovered lazily whose context has not been parsed yet.
+  hashset<ContainerID> m_unrecovered;
+
+  // Runs the watch checks of all the containers, shared with the discard
+  // callbacks of the watch futures.
+  std::shared_ptr<WatchScheduler> m_watchScheduler;
+  hashmap<ContainerID, std::shared_ptr<Promise<ContainerLimitation>>>
+      m_watches;
+
+  // Statistics published by an external collector, read in this order before
+  // running any usage command.
+  std::unique_ptr<statistics::StatisticsChannel> m_usageChannel;
+  std::unique_ptr<StatisticsFileSource> m_usageFileSource;
+
+  // Latest statistics of the containers when usage() is served from memory.
+  Option<Duration> m_usageRefreshInterval;
+  size_t m_usageRefreshConcurrency;
+  hashmap<ContainerID, ::mesos::ResourceStatistics> m_usageSnapshots;
+  std::deque<ContainerID> m_usageRefreshQueue;
+  size_t m_usageRefreshInFlight;
+
+  // Orphan containers reported at recovery whose cleanup is pending, each
+  // with the promise of its cleanup so that the cleanup requested by Mesos
+  // waits for it instead of running the command again.
+  size_t m_orphanCleanupConcurrency;
+  std::deque<ContainerID> m_orphanCleanupQueue;
+  size_t m_orphanCleanupInFlight;
+  hashmap<ContainerID, std::shared_ptr<Promise<Nothing>>> m_orphanCleanups;
 };
 
 CommandIsolatorProcess::CommandIsolatorProcess(
-    const string& name, const Option<Command>& prepareCommand,
-    const Option<Command>& isolateCommand,
-    const Option<RecurrentCommand>& watchCommand,
-    const Option<Command>& cleanupCommand, const Option<Command>& usageCommand,
-    bool isDebugMode)
+    const string& name, const vector<CommandSet>& commandSets,
+    bool isDebugMode, const RunnerOptions& runnerOptions,
+    const IsolatorOptions& isolatorOptions)
     : m_name(name),
-      m_prepareCommand(prepareCommand),
-      m_isolateCommand(isolateCommand),
-      m_watchCommand(watchCommand),
-      m_cleanupCommand(cleanupCommand),
-      m_usageCommand(usageCommand),
-      m_isDebugMode(isDebugMode) {}
+      m_commandSets(commandSets),
+      m_isDebugMode(isDebugMode),
+      m_runnerOptions(runnerOptions),
+      m_stateDir(isolatorOptions.stateDir),
+      m_recoveryWorkers(std::max<size_t>(isolatorOptions.recoveryWorkers, 1)),
+      m_lazyRecovery(isolatorOptions.lazyRecovery),
+      m_usageRefreshInterval(isolatorOptions.usageRefreshInterval),
+      m_usageRefreshConcurrency(
+          std::max<size_t>(isolatorOptions.usageRefreshConcurrency, 1)),
+      m_usageRefreshInFlight(0),
+      m_orphanCleanupConcurrency(
+          std::max<size_t>(isolatorOptions.orphanCleanupConcurrency, 1)),
+      m_orphanCleanupInFlight(0) {
+  if (m_commandSets.empty()) m_commandSets.push_back(CommandSet{name});
+
+  bool hasWatchCommand = false;
+  for (const CommandSet& commandSet : m_commandSets) {
+    hasWatchCommand |= commandSet.watchCommand.isSome();
+  }
+  if (hasWatchCommand) {
+    m_watchScheduler =
+        std::make_shared<WatchScheduler>(isolatorOptions.watchWorkers);
+  }
+  if (isolatorOptions.usageChannel.isSome()) {
+    m_usageChannel.reset(
+        new statistics::StatisticsChannel(isolatorOptions.usageChannel.get(),
+                                          isolatorOptions.usageChannelMaxAge));
+  }
+  if (isolatorOptions.usageSourceDir.isSome()) {
+    m_usageFileSource.reset(
+        new StatisticsFileSource(isolatorOptions.usageSourceDir.get()));
+  }
+}
+
+void CommandIsolatorProcess::initialize() {
+  if (hasCommand(&CommandSet::usageCommand) &&
+      m_usageRefreshInterval.isSome()) {
+    refreshUsage();
+  }
+}
+
+bool CommandIsolatorProcess::hasCommand(
+    Option<Command> CommandSet::*event) const {
+  for (const CommandSet& commandSet : m_commandSets) {
+    if ((commandSet.*event).isSome()) return true;
+  }
+  return false;
+}
+
+Future<vector<Try<string>>> CommandIsolatorProcess::runCommands(
+    Option<Command> CommandSet::*event, const logging::Metadata& metadata,
+    const string& input) {
+  vector<Future<vector<Try<string>>>> outputs;
+  for (const CommandSet& commandSet : m_commandSets) {
+    const Option<Command>& command = commandSet.*event;
+    if (command.isNone()) continue;
+    outputs.push_back(CommandRunner(m_isDebugMode, metadata, m_runnerOptions)
+                          .asyncRunAll(command.get(), input));
+  }
+  if (outputs.size() == 1) return outputs.front();
+
+  return process::collect(outputs).then(
+      [](const vector<vector<Try<string>>>& outputs) {
+        vector<Try<string>> all;
+        for (const vector<Try<string>>& setOutputs : outputs) {
+          all.insert(all.end(), setOutputs.begin(), setOutputs.end());
+        }
+        return all;
+      });
+}
+
+logging::Metadata CommandIsolatorProcess::callMetadata(
+    const ContainerID& containerId, const string& method) {
+  logging::Metadata metadata = {containerId.value(), method};
+  metadata.invocation = tracing::Tracer::instance().nextInvocation();
+  if (loadContainerContext(containerId)) {
+    metadata.frameworkId = m_infos[containerId]->frameworkId();
+  }
+  return metadata;
+}
 
 Try<Nothing> CommandIsolatorProcess::saveContainerContext(
     const ContainerID& containerId, const ContainerConfig& containerConfig) {
-  const string& context_dir = path::join(COMMAND_ISOLATOR_STATE_DIR, m_name);
+  const string& context_dir = path::join(m_stateDir, m_name);
   Result<Nothing> create_context_dir = os::mkdir(context_dir, true);
   if (create_context_dir.isError()) {
     return Error("Failed to create context directory for isolator " + m_name +
@@ -134,14 +314,16 @@ Try<Nothing> CommandIsolatorProcess::saveContainerContext(
 
 Try<ContainerConfig> CommandIsolatorProcess::restoreContainerContext(
     const ContainerID& containerId) {
+  logging::Metadata metadata = {containerId.value(), "recover"};
+  metadata.invocation = tracing::Tracer::instance().nextInvocation();
   const string& context_file_path =
-      path::join(COMMAND_ISOLATOR_STATE_DIR, m_name, stringify(containerId));
+      path::join(m_stateDir, m_name, stringify(containerId));
   Result<string> context_json = os::read(context_file_path);
   if (context_json.isError()) {
     return Error("Failed reading context file: " + context_json.error());
   }
   Result<ContainerConfig> containerConfig =
-      jsonToProtobuf<ContainerConfig>(context_json.get());
+      jsonToProtobuf<ContainerConfig>(context_json.get(), metadata);
   if (containerConfig.isError()) {
     return Error("Unable to deserialize ContainerConfig: " +
                  containerConfig.error());
@@ -151,76 +333,109 @@ Try<ContainerConfig> CommandIsolatorProcess::restoreContainerContext(
 
 Try<Nothing> CommandIsolatorProcess::cleanContainerContext(
     const ContainerID& containerId) {
+  stopWatch(containerId);
+  m_usageSnapshots.erase(containerId);
+  if (m_usageFileSource) m_usageFileSource->forget(containerId.value());
   m_infos.erase(containerId);
+  m_unrecovered.erase(containerId);
   const string& context_file_path =
-      path::join(COMMAND_ISOLATOR_STATE_DIR, m_name, stringify(containerId));
+      path::join(m_stateDir, m_name, stringify(containerId));
   return os::rm(context_file_path);
 }
 
+string CommandIsolatorProcess::withContainerConfig(
+    const JSON::Object& input, const ContainerContext& context) {
+  // The members of an object are sorted so the config goes first.
+  string members = stringify(input);
+  return "{\"container_config\":" + context.json() + "," + members.substr(1);
+}
+
+bool CommandIsolatorProcess::loadContainerContext(
+    const ContainerID& containerId) {
+  if (m_infos.contains(containerId)) return true;
+  if (!m_unrecovered.contains(containerId)) return false;
+
+  m_unrecovered.erase(containerId);
+  Try<ContainerConfig> containerConfig = restoreContainerContext(containerId);
+  if (containerConfig.isError()) {
+    LOG(ERROR) << "Can't restore context for " << stringify(containerId)
+               << ": " << containerConfig.error();
+    return false;
+  }
+  m_infos.put(containerId, m_contexts.intern(containerConfig.get()));
+  return true;
+}
+
 process::Future<Option<ContainerLaunchInfo>> CommandIsolatorProcess::prepare(
     const ContainerID& containerId, const ContainerConfig& containerConfig) {
-  if (m_infos.contains(containerId)) {
+  if (loadContainerContext(containerId)) {
     return Failure("mesos-command-module already initialized for container");
   } else {
-    m_infos.put(containerId, containerConfig);
+    m_infos.put(containerId, m_contexts.intern(containerConfig));
   }
   saveContainerContext(containerId, containerConfig);
-  if (m_prepareCommand.isNone()) {
+  if (!hasCommand(&CommandSet::prepareCommand)) {
     return None();
   }
 
-  logging::Metadata metadata = {containerId.value(), "prepare"};
+  logging::Metadata metadata = callMetadata(containerId, "prepare");
 
   JSON::Object inputsJson;
   inputsJson.values["container_id"] = JSON::protobuf(containerId);
   inputsJson.values["container_config"] = JSON::protobuf(containerConfig);
 
-  Try<string> output = CommandRunner(m_isDebugMode, metadata)
-                           .run(m_prepareCommand.get(), stringify(inputsJson));
+  Try<vector<string>> outputs = CommandRunner::awaitAll(runCommands(
+      &CommandSet::prepareCommand, metadata, stringify(inputsJson)));
 
-  if (output.isError()) {
-    return Failure(output.error());
+  if (outputs.isError()) {
+    return Failure(outputs.error());
   }
 
-  if (output->empty()) {
-    return None();
+  // An executable with nothing to change in the launch of the container
+  // outputs nothing.
+  vector<string> launchInfos;
+  for (const string& output : outputs.get()) {
+    if (!output.empty()) launchInfos.push_back(output);
   }
 
   Result<ContainerLaunchInfo> containerLaunchInfo =
-      jsonToProtobuf<ContainerLaunchInfo>(output.get());
+      mergeOutputs<ContainerLaunchInfo>(launchInfos, metadata);
 
   if (containerLaunchInfo.isError()) {
     return Failure("Unable to deserialize ContainerLaunchInfo: " +
                    containerLaunchInfo.error());
   }
+  if (containerLaunchInfo.isNone()) {
+    return None();
+  }
   return containerLaunchInfo.get();
 }
 
 process::Future<Nothing> CommandIsolatorProcess::isolate(
     const ContainerID& containerId, pid_t pid) {
-  if (m_isolateCommand.isNone()) {
+  if (!hasCommand(&CommandSet::isolateCommand)) {
     return Nothing();
   }
-  logging::Metadata metadata = {containerId.value(), "isolate"};
+  logging::Metadata metadata = callMetadata(containerId, "isolate");
 
   JSON::Object inputsJson;
   inputsJson.values["container_id"] = JSON::protobuf(containerId);
   inputsJson.values["pid"] = pid;
 
-  if (m_infos.contains(containerId)) {
-    inputsJson.values["container_config"] =
-        JSON::protobuf(m_infos[containerId]);
-
+  string input;
+  if (loadContainerContext(containerId)) {
+    input = withContainerConfig(inputsJson, *m_infos[containerId]);
   } else {
     LOG(WARNING)
         << "Missing container info during isolation of container with pid"
         << pid;
+    input = stringify(inputsJson);
   }
 
-  Try<string> output = CommandRunner(m_isDebugMode, metadata)
-                           .run(m_isolateCommand.get(), stringify(inputsJson));
-  if (output.isError()) {
-    return Failure(output.error());
+  Try<vector<string>> outputs = CommandRunner::awaitAll(
+      runCommands(&CommandSet::isolateCommand, metadata, input));
+  if (outputs.isError()) {
+    return Failure(outputs.error());
   }
   return Nothing();
 }
@@ -228,138 +443,306 @@ process::Future<Nothing> CommandIsolatorProcess::isolate(
 process::Future<Nothing> CommandIsolatorProcess::recover(
     const std::vector<ContainerState>& states,
     const hashset<ContainerID>& orphans) {
-  for (const ContainerState& state : states) {
-    const ContainerID& containerId = state.container_id();
-    LOG(INFO) << "Trying to restore context for " << stringify(containerId);
-    Result<ContainerConfig> containerConfig =
-        restoreContainerContext(containerId);
-    if (containerConfig.isError()) {
-      LOG(ERROR) << "Can't restore context for " << stringify(containerId)
-                 << ": " << containerConfig.error();
-      continue;
+  // The orphans are cleaned up in the background once recovery returns so
+  // that they do not delay the agent.
+  if (!orphans.empty()) {
+    LOG(INFO) << "Cleaning up " << orphans.size() << " orphan containers";
+    for (const ContainerID& containerId : orphans) {
+      if (m_orphanCleanups.contains(containerId)) continue;
+      m_orphanCleanupQueue.push_back(containerId);
+      m_orphanCleanups.put(containerId, std::make_shared<Promise<Nothing>>());
     }
-    m_infos.put(containerId, containerConfig.get());
-    LOG(INFO) << "Successfully restored context for " << stringify(containerId);
+    dispatch(self(), &CommandIsolatorProcess::cleanupNextOrphans);
   }
+
+  if (m_lazyRecovery) {
+    for (const ContainerState& state : states) {
+      if (!m_infos.contains(state.container_id())) {
+        m_unrecovered.insert(state.container_id());
+      }
+    }
+    LOG(INFO) << "Indexed " << states.size()
+              << " containers, their context is restored on first use";
+    return Nothing();
+  }
+
+  // The context files are independent so they are read and parsed by a few
+  // threads, the process only interns the results once they all complete.
+  vector<Option<ContainerContext::Members>> containerConfigs(states.size());
+  std::atomic<size_t> next(0);
+  auto restore = [&]() {
+    for (size_t i = next++; i < states.size(); i = next++) {
+      const ContainerID& containerId = states[i].container_id();
+      Try<ContainerConfig> containerConfig =
+          restoreContainerContext(containerId);
+      if (containerConfig.isError()) {
+        LOG(ERROR) << "Can't restore context for " << stringify(containerId)
+                   << ": " << containerConfig.error();
+        continue;
+      }
+      containerConfigs[i] = ContainerContext::serialize(containerConfig.get());
+    }
+  };
+
+  vector<std::thread> workers;
+  size_t workerCount = std::min(m_recoveryWorkers, states.size());
+  for (size_t i = 1; i < workerCount; ++i) workers.emplace_back(restore);
+  restore();
+  for (std::thread& worker : workers) worker.join();
+
+  size_t restored = 0;
+  for (size_t i = 0; i < states.size(); ++i) {
+    if (containerConfigs[i].isNone()) continue;
+    m_infos.put(states[i].container_id(),
+                m_contexts.intern(std::move(containerConfigs[i].get())));
+    ++restored;
+  }
+  LOG(INFO) << "Successfully restored context for " << restored << " of "
+            << states.size() << " containers";
   return Nothing();
 }
 
 process::Future<ContainerLimitation> CommandIsolatorProcess::watch(
     const ContainerID& containerId) {
-  if (m_watchCommand.isNone()) {
+  if (!m_watchScheduler) {
     return process::Future<ContainerLimitation>();
   }
 
-  logging::Metadata metadata = {containerId.value(), "watch"};
+  logging::Metadata metadata = callMetadata(containerId, "watch");
 
-  JSON::Object inputsJson;
-  inputsJson.values["container_id"] = JSON::protobuf(containerId);
-  if (m_infos.contains(containerId)) {
-    inputsJson.values["container_config"] =
-        JSON::protobuf(m_infos[containerId]);
-  } else {
+  if (!loadContainerContext(containerId)) {
     return Failure(
         "mesos-command-module is not initialized for current container");
   }
 
-  std::string inputStringified = stringify(inputsJson);
-  RecurrentCommand command = m_watchCommand.get();
+  if (m_watches.contains(containerId)) {
+    return m_watches[containerId]->future();
+  }
+
+  JSON::Object inputsJson;
+  inputsJson.values["container_id"] = JSON::protobuf(containerId);
+  // The checks of all the executables share the input.
+  auto input = std::make_shared<const string>(
+      withContainerConfig(inputsJson, *m_infos[containerId]));
   bool isDebugMode = m_isDebugMode;
+  RunnerOptions runnerOptions = m_runnerOptions;
+
+  auto promise = std::make_shared<Promise<ContainerLimitation>>();
+  m_watches[containerId] = promise;
+
+  // Every executable of the watch commands gets its own check and adaptive
+  // interval, the first limitation reported completes the watch. The checks
+  // run on the threads of the scheduler, they must not touch the state of the
+  // process. The runs of a check never overlap so its adaptive interval needs
+  // no lock.
+  for (const CommandSet& commandSet : m_commandSets) {
+    if (commandSet.watchCommand.isNone()) continue;
+
+    const RecurrentCommand& command = commandSet.watchCommand.get();
+    Duration interval = frequenceToDuration(command.frequence());
+    for (const Command& executable : command.split()) {
+      auto adaptiveInterval = std::make_shared<AdaptiveInterval>(
+          interval, frequenceToDuration(command.minFrequence()),
+          frequenceToDuration(command.maxFrequence()));
+
+      m_watchScheduler->schedule(
+          containerId.value(), interval,
+          [isDebugMode, metadata, input, executable, runnerOptions,
+           adaptiveInterval, promise]() -> Option<Duration> {
+            if (!promise->future().isPending() ||
+                promise->future().hasDiscard()) {
+              return None();
+            }
+
+            // Every check is an invocation of its own in the traces.
+            logging::Metadata checkMetadata = metadata;
+            checkMetadata.invocation =
+                tracing::Tracer::instance().nextInvocation();
+            Try<string> output =
+                CommandRunner(isDebugMode, checkMetadata, runnerOptions)
+                    .runSync(executable, *input);
+            if (output.isError()) {
+              LOG(WARNING) << "Unable to parse output: " << output.error();
+              return adaptiveInterval->current();
+            }
+            if (output->empty()) return adaptiveInterval->next(None());
+
+            // The output is parsed once, whether it reports a pressure or a
+            // limitation.
+            PROBE_PARSE_START(checkMetadata, output->size());
+            Try<JSON::Value> json = parseOutput(output.get(), checkMetadata);
+            if (json.isError()) {
+              PROBE_PARSE_END(checkMetadata, false);
+              LOG(WARNING) << "Unable to deserialize ContainerLimitation: "
+                           << json.error();
+              return adaptiveInterval->current();
+            }
+
+            Option<double> pressure =
+                extractPressure(json->as<JSON::Object>());
+            if (pressure.isSome()) {
+              PROBE_PARSE_END(checkMetadata, true);
+              return adaptiveInterval->next(pressure);
+            }
+
+            Result<ContainerLimitation> containerLimitation =
+                toProtobuf<ContainerLimitation>(json.get(), checkMetadata);
+            PROBE_PARSE_END(checkMetadata, containerLimitation.isSome());
+            if (containerLimitation.isError()) {
+              LOG(WARNING) << "Unable to deserialize ContainerLimitation: "
+                           << containerLimitation.error();
+              return adaptiveInterval->current();
+            }
+
+            promise->set(containerLimitation.get());
+            return None();
+          });
+    }
+  }
 
-  process::UPID proc = spawn(new process::ProcessBase());
-
-  Future<ContainerLimitation> future = loop(
-      proc,
-      [isDebugMode, metadata, inputStringified, command]() {
-        Try<string> output = CommandRunner(isDebugMode, metadata)
-                                 .runWithoutTimeout(command, inputStringified);
-        return output;
-      },
-      [command, this, containerId](
-          Try<string> output) -> Future<ControlFlow<ContainerLimitation>> {
-        try {
-          if (!m_infos.contains(containerId)) {
-            LOG(WARNING) << "Terminating watch loop for containerId: "
-                         << containerId;
-            // Returning a discarded future stops the loop
-            Future<ControlFlow<ContainerLimitation>> ret;
-            ret.discard();
-            return ret;
-          }
-          if (output.isError())
-            throw std::runtime_error("Unable to parse output: " +
-                                     output.error());
-
-          if (output->empty()) throw should_continue_exception();
-
-          Result<ContainerLimitation> containerLimitation =
-              jsonToProtobuf<ContainerLimitation>(output.get());
-
-          if (containerLimitation.isError())
-            throw std::runtime_error(
-                "Unable to deserialize ContainerLimitation: " +
-                containerLimitation.error());
-
-          return Break(containerLimitation.get());
-        } catch (const std::runtime_error& e) {
-          if (e.what()) LOG(WARNING) << e.what();
-        } catch (const should_continue_exception& e) {
-        }
-        return after(Seconds(command.frequence()))
-            .then([]() -> process::ControlFlow<ContainerLimitation> {
-              return process::Continue();
-            });
-      });
+  promise->future().onDiscard(
+      defer(self(), &CommandIsolatorProcess::stopWatch, containerId));
+  return promise->future();
+}
 
-  future.onAny([proc]() {
-    LOG(WARNING) << "Terminating watch loop";
-    terminate(proc);
-    LOG(WARNING) << "Watch loop Terminated";
-  });
+void CommandIsolatorProcess::stopWatch(const ContainerID& containerId) {
+  if (!m_watches.contains(containerId)) return;
 
-  return future;
+  LOG(INFO) << "Terminating watch checks of container " << containerId;
+  m_watchScheduler->unschedule(containerId.value());
+  m_watches[containerId]->discard();
+  m_watches.erase(containerId);
 }
 
 process::Future<::mesos::ResourceStatistics> CommandIsolatorProcess::usage(
     const ContainerID& containerId) {
-  double now = Clock::now().secs();
+  if (m_usageChannel) {
+    Result<::mesos::ResourceStatistics> published =
+        m_usageChannel->read(containerId.value());
+    if (published.isSome()) return published.get();
+    if (published.isError()) {
+      LOG(WARNING) << "Unable to read statistics of container " << containerId
+                   << " from channel: " << published.error();
+    }
+  }
 
-  if (m_usageCommand.isNone()) return emptyStats(now);
+  if (m_usageFileSource) {
+    Result<::mesos::ResourceStatistics> published = m_usageFileSource->read(
+        containerId.value(), callMetadata(containerId, "usage"));
+    if (published.isSome()) return published.get();
+    if (published.isError()) {
+      LOG(WARNING) << "Unable to read published statistics of container "
+                   << containerId << ": " << published.error();
+    }
+  }
 
-  logging::Metadata metadata = {containerId.value(), "usage"};
+  if (!hasCommand(&CommandSet::usageCommand)) return emptyStats();
 
-  JSON::Object inputsJson;
-  inputsJson.values["container_id"] = JSON::protobuf(containerId);
-  if (m_infos.contains(containerId)) {
-    inputsJson.values["container_config"] =
-        JSON::protobuf(m_infos[containerId]);
-  } else {
+  if (m_usageRefreshInterval.isNone()) return collectUsage(containerId);
+
+  if (!loadContainerContext(containerId)) {
     return Failure(
         "mesos-command-module is not initialized for current container");
   }
+  // Until the refresher has collected the statistics of a new container, it
+  // reports no usage rather than waiting for the command.
+  if (!m_usageSnapshots.contains(containerId)) return emptyStats();
+  return m_usageSnapshots[containerId];
+}
 
-  return CommandRunner(m_isDebugMode, metadata)
-      .asyncRun(m_usageCommand.get(), stringify(inputsJson))
-      .then([now = now](Try<string> output)
-                ->Future<::mesos::ResourceStatistics> {
-                  if (output.isError()) {
-                    LOG(WARNING) << "Unable to parse output: "
-                                 << output.error();
-                    return emptyStats(now);
-                  }
-                  if (output->empty()) {
-                    LOG(WARNING) << "Output is empty";
-                    return emptyStats(now);
-                  }
-                  Result<::mesos::ResourceStatistics> resourceStatistics =
-                      jsonToProtobuf<::mesos::ResourceStatistics>(output.get());
+void CommandIsolatorProcess::refreshUsage() {
+  for (const ContainerID& containerId : m_infos.keys()) {
+    m_usageRefreshQueue.push_back(containerId);
+  }
+  for (const ContainerID& containerId : m_unrecovered) {
+    m_usageRefreshQueue.push_back(containerId);
+  }
+  if (m_usageRefreshQueue.empty()) {
+    delay(m_usageRefreshInterval.get(), self(),
+          &CommandIsolatorProcess::refreshUsage);
+    return;
+  }
+  refreshNextUsage();
+}
+
+void CommandIsolatorProcess::refreshNextUsage() {
+  while (!m_usageRefreshQueue.empty() &&
+         m_usageRefreshInFlight < m_usageRefreshConcurrency) {
+    ContainerID containerId = m_usageRefreshQueue.front();
+    m_usageRefreshQueue.pop_front();
+    // The container may have been cleaned up since the round started.
+    if (!loadContainerContext(containerId)) continue;
+
+    ++m_usageRefreshInFlight;
+    collectUsage(containerId)
+        .onAny(defer(self(), &CommandIsolatorProcess::usageRefreshed,
+                     containerId, lambda::_1));
+  }
 
-                  if (resourceStatistics.isError()) {
-                    LOG(WARNING) << "Unable to deserialize ResourceStatistics: "
-                                 << resourceStatistics.error();
-                    return emptyStats(now);
+  if (m_usageRefreshQueue.empty() && m_usageRefreshInFlight == 0) {
+    delay(m_usageRefreshInterval.get(), self(),
+          &CommandIsolatorProcess::refreshUsage);
+  }
+}
+
+void CommandIsolatorProcess::usageRefreshed(
+    const ContainerID& containerId,
+    const Future<::mesos::ResourceStatistics>& statistics) {
+  --m_usageRefreshInFlight;
+  if (statistics.isReady() && m_infos.contains(containerId)) {
+    m_usageSnapshots[containerId] = statistics.get();
+  }
+  refreshNextUsage();
+}
+
+process::Future<::mesos::ResourceStatistics>
+CommandIsolatorProcess::collectUsage(const ContainerID& containerId) {
+  double now = Clock::now().secs();
+
+  logging::Metadata metadata = callMetadata(containerId, "usage");
+
+  if (!loadContainerContext(containerId)) {
+    return Failure(
+        "mesos-command-module is not initialized for current container");
+  }
+  JSON::Object inputsJson;
+  inputsJson.values["container_id"] = JSON::protobuf(containerId);
+
+  return runCommands(&CommandSet::usageCommand, metadata,
+                     withContainerConfig(inputsJson, *m_infos[containerId]))
+      .then([ now = now, metadata ](const vector<Try<string>>& outputs)
+                ->Future<::mesos::ResourceStatistics> {
+                  // The statistics of the executables which failed are
+                  // missing from the merge rather than failing all of them.
+                  Option<::mesos::ResourceStatistics> merged;
+                  for (const Try<string>& output : outputs) {
+                    if (output.isError()) {
+                      LOG(WARNING) << "Unable to parse output: "
+                                   << output.error();
+                      continue;
+                    }
+                    if (output->empty()) {
+                      LOG(WARNING) << "Output is empty";
+                      continue;
+                    }
+                    Result<::mesos::ResourceStatistics> resourceStatistics =
+                        jsonToProtobuf<::mesos::ResourceStatistics>(
+                            output.get(), metadata);
+
+                    if (resourceStatistics.isError()) {
+                      LOG(WARNING)
+                          << "Unable to deserialize ResourceStatistics: "
+                          << resourceStatistics.error();
+                      continue;
+                    }
+                    if (merged.isNone()) {
+                      merged = std::move(resourceStatistics.get());
+                    } else {
+                      merged->MergeFrom(resourceStatistics.get());
+                    }
                   }
-                  return resourceStatistics.get();
+                  if (merged.isNone()) return emptyStats(now);
+                  return merged.get();
                 })
       .recover([now = now](const Future<::mesos::ResourceStatistics>& result)
                    ->Future<::mesos::ResourceStatistics> {
@@ -368,27 +751,88 @@ process::Future<::mesos::ResourceStatistics> CommandIsolatorProcess::usage(
                    });
 }
 
+void CommandIsolatorProcess::cleanupNextOrphans() {
+  while (!m_orphanCleanupQueue.empty() &&
+         m_orphanCleanupInFlight < m_orphanCleanupConcurrency) {
+    ContainerID containerId = m_orphanCleanupQueue.front();
+    m_orphanCleanupQueue.pop_front();
+    // Mesos destroys the orphans so their context is of no use anymore, even
+    // if it cannot be restored.
+    Try<ContainerConfig> containerConfig = restoreContainerContext(containerId);
+    if (containerConfig.isError() ||
+        !hasCommand(&CommandSet::cleanupCommand)) {
+      cleanContainerContext(containerId);
+      orphanCleanupDone(containerId, Nothing());
+      continue;
+    }
+
+    logging::Metadata metadata = {
+        containerId.value(), "cleanup",
+        containerConfig->executor_info().framework_id().value()};
+    metadata.invocation = tracing::Tracer::instance().nextInvocation();
+
+    JSON::Object inputsJson;
+    inputsJson.values["container_id"] = JSON::protobuf(containerId);
+    inputsJson.values["container_config"] =
+        JSON::protobuf(containerConfig.get());
+
+    ++m_orphanCleanupInFlight;
+    runCommands(&CommandSet::cleanupCommand, metadata, stringify(inputsJson))
+        .onAny(defer(self(), &CommandIsolatorProcess::orphanCleaned,
+                     containerId, lambda::_1));
+  }
+}
+
+void CommandIsolatorProcess::orphanCleaned(
+    const ContainerID& containerId,
+    const Future<vector<Try<string>>>& outputs) {
+  --m_orphanCleanupInFlight;
+  cleanContainerContext(containerId);
+  Try<vector<string>> result = CommandRunner::awaitAll(outputs);
+  if (result.isError()) {
+    LOG(WARNING) << "Failed to clean up orphan container " << containerId
+                 << ": " << result.error();
+    orphanCleanupDone(containerId, Failure(result.error()));
+  } else {
+    orphanCleanupDone(containerId, Nothing());
+  }
+  cleanupNextOrphans();
+}
+
+void CommandIsolatorProcess::orphanCleanupDone(const ContainerID& containerId,
+                                               const Future<Nothing>& result) {
+  Option<std::shared_ptr<Promise<Nothing>>> cleanup =
+      m_orphanCleanups.get(containerId);
+  if (cleanup.isNone()) return;
+  m_orphanCleanups.erase(containerId);
+  cleanup.get()->associate(result);
+}
+
 process::Future<Nothing> CommandIsolatorProcess::cleanup(
     const ContainerID& containerId) {
-  if (m_cleanupCommand.isNone()) {
+  // Mesos cleans up the orphans once it destroyed them, the cleanup started
+  // in the background at recovery is then awaited.
+  if (m_orphanCleanups.contains(containerId)) {
+    return m_orphanCleanups[containerId]->future();
+  }
+
+  if (!hasCommand(&CommandSet::cleanupCommand)) {
     cleanContainerContext(containerId);
     return Nothing();
   }
 
-  logging::Metadata metadata = {containerId.value(), "cleanup"};
+  logging::Metadata metadata = callMetadata(containerId, "cleanup");
 
   JSON::Object inputsJson;
   inputsJson.values["container_id"] = JSON::protobuf(containerId);
-  if (m_infos.contains(containerId)) {
-    inputsJson.values["container_config"] =
-        JSON::protobuf(m_infos[containerId]);
-    Try<string> output =
-        CommandRunner(m_isDebugMode, metadata)
-            .run(m_cleanupCommand.get(), stringify(inputsJson));
+  if (loadContainerContext(containerId)) {
+    Try<vector<string>> outputs = CommandRunner::awaitAll(runCommands(
+        &CommandSet::cleanupCommand, metadata,
+        withContainerConfig(inputsJson, *m_infos[containerId])));
 
     cleanContainerContext(containerId);
-    if (output.isError()) {
-      return Failure(output.error());
+    if (outputs.isError()) {
+      return Failure(outputs.error());
     }
   } else {
     LOG(WARNING) << "Missing container info during cleanup of "
@@ -398,16 +842,50 @@ process::Future<Nothing> CommandIsolatorProcess::cleanup(
   return Nothing();
 }
 
+#ifdef CRITEO_MESOS_USDT
+// Fire the isolator event probes around a dispatch to the isolator process.
+// The exit probe fires when the returned future completes so that it also
+// covers the asynchronous commands.
+template <typename F>
+static auto probeEvent(const string& taskId, const char* method, F event)
+    -> decltype(event()) {
+  logging::Metadata metadata = {taskId, method};
+  PROBE_ISOLATOR_EVENT_ENTRY(metadata);
+  auto future = event();
+  future.onAny([metadata](const decltype(future)& result) {
+    PROBE_ISOLATOR_EVENT_EXIT(metadata, result.isReady());
+  });
+  return future;
+}
+#else
+template <typename F>
+static inline auto probeEvent(const string&, const char*, F event)
+    -> decltype(event()) {
+  return event();
+}
+#endif
+
 CommandIsolator::CommandIsolator(const string& name,
                                  const Option<Command>& prepareCommand,
                                  const Option<Command>& isolateCommand,
                                  const Option<RecurrentCommand>& watchCommand,
                                  const Option<Command>& cleanupCommand,
                                  const Option<Command>& usageCommand,
-                                 bool isDebugMode)
-    : m_process(new CommandIsolatorProcess(name, prepareCommand, isolateCommand,
-                                           watchCommand, cleanupCommand,
-                                           usageCommand, isDebugMode)) {
+                                 bool isDebugMode,
+                                 const RunnerOptions& runnerOptions,
+                                 const IsolatorOptions& isolatorOptions)
+    : CommandIsolator(name,
+                      {CommandSet{name, prepareCommand, isolateCommand,
+                                  watchCommand, cleanupCommand, usageCommand}},
+                      isDebugMode, runnerOptions, isolatorOptions) {}
+
+CommandIsolator::CommandIsolator(const string& name,
+                                 const vector<CommandSet>& commandSets,
+                                 bool isDebugMode,
+                                 const RunnerOptions& runnerOptions,
+                                 const IsolatorOptions& isolatorOptions)
+    : m_process(new CommandIsolatorProcess(name, commandSets, isDebugMode,
+                                           runnerOptions, isolatorOptions)) {
   spawn(m_process);
 }
 
@@ -421,41 +899,59 @@ CommandIsolator::~CommandIsolator() {
 
 process::Future<Option<ContainerLaunchInfo>> CommandIsolator::prepare(
     const ContainerID& containerId, const ContainerConfig& containerConfig) {
-  return dispatch(m_process, &CommandIsolatorProcess::prepare, containerId,
-                  containerConfig);
+  return probeEvent(containerId.value(), "prepare", [&]() {
+    return dispatch(m_process, &CommandIsolatorProcess::prepare, containerId,
+                    containerConfig);
+  });
 }
 
 process::Future<Nothing> CommandIsolator::isolate(
     const ContainerID& containerId, const pid_t pid) {
-  return dispatch(m_process, &CommandIsolatorProcess::isolate, containerId,
-                  pid);
+  return probeEvent(containerId.value(), "isolate", [&]() {
+    return dispatch(m_process, &CommandIsolatorProcess::isolate, containerId,
+                    pid);
+  });
 }
 
 process::Future<Nothing> CommandIsolator::recover(
     const std::vector<ContainerState>& states,
     const hashset<ContainerID>& orphans) {
-  return dispatch(m_process, &CommandIsolatorProcess::recover, states, orphans);
+  return probeEvent("", "recover", [&]() {
+    return dispatch(m_process, &CommandIsolatorProcess::recover, states,
+                    orphans);
+  });
 }
 
 process::Future<ContainerLimitation> CommandIsolator::watch(
     const ContainerID& containerId) {
-  return dispatch(m_process, &CommandIsolatorProcess::watch, containerId);
+  return probeEvent(containerId.value(), "watch", [&]() {
+    return dispatch(m_process, &CommandIsolatorProcess::watch, containerId);
+  });
 }
 
 process::Future<Nothing> CommandIsolator::cleanup(
     const ContainerID& containerId) {
-  return dispatch(m_process, &CommandIsolatorProcess::cleanup, containerId);
+  return probeEvent(containerId.value(), "cleanup", [&]() {
+    return dispatch(m_process, &CommandIsolatorProcess::cleanup, containerId);
+  });
 }
 
 process::Future<::mesos::ResourceStatistics> CommandIsolator::usage(
     const ContainerID& containerId) {
-  return dispatch(m_process, &CommandIsolatorProcess::usage, containerId);
+  return probeEvent(containerId.value(), "usage", [&]() {
+    return dispatch(m_process, &CommandIsolatorProcess::usage, containerId);
+  });
 }
 
 bool CommandIsolator::hasContainerContext(const ContainerID& containerId) {
   return m_process->hasContainerContext(containerId);
 }
 
+const vector<CommandSet>& CommandIsolator::commandSets() const {
+  CHECK_NOTNULL(m_process);
+  return m_process->commandSets();
+}
+
 const Option<Command>& CommandIsolator::prepareCommand() const {
   CHECK_NOTNULL(m_process);
   return m_process->prepareCommand();
@@ -2,8 +2,11 @@
 #define __COMMAND_ISOLATOR_HPP__
 
 #include <string>
+#include <vector>
 
 #include "Command.hpp"
+#include "IsolatorOptions.hpp"
+#include "RunnerOptions.hpp"
 
 #include <mesos/module/isolator.hpp>
 #include <mesos/slave/isolator.hpp>
@@ -13,8 +16,6 @@
 namespace criteo {
 namespace mesos {
 
-class should_continue_exception : public std::exception {};
-
 // Forward declaration
 class CommandIsolatorProcess;
 
@@ -45,6 +46,8 @@ class CommandIsolator : public ::mesos::slave::Isolator {
    *   for a given container. This command will be frequently called
    * @param isDebugMode If true, logs inputs and outputs of the commands,
    *   otherwise logs nothing
+   * @param runnerOptions The settings applied to every command run.
+   * @param isolatorOptions The settings of the isolator itself.
    */
   explicit CommandIsolator(const std::string& name,
                            const Option<Command>& prepareCommand,
@@ -52,7 +55,31 @@ class CommandIsolator : public ::mesos::slave::Isolator {
                            const Option<RecurrentCommand>& watchCommand,
                            const Option<Command>& cleanupCommand,
                            const Option<Command>& usageCommand,
-                           bool isDebugMode = false);
+                           bool isDebugMode = false,
+                           const RunnerOptions& runnerOptions =
+                               RunnerOptions(),
+                           const IsolatorOptions& isolatorOptions =
+                               IsolatorOptions());
+
+  /*
+   * Constructor of an isolator hosting several command sets. The sets share
+   * the context of the containers and the commands of an event run
+   * concurrently in all the sets, their outputs are merged in the order of
+   * the sets.
+   *
+   * @param name The name of the module.
+   * @param commandSets The command sets, the first one is the default set
+   *   the getters of the commands refer to.
+   * @param isDebugMode If true, logs inputs and outputs of the commands,
+   *   otherwise logs nothing
+   * @param runnerOptions The settings applied to every command run.
+   * @param isolatorOptions The settings of the isolator itself.
+   */
+  CommandIsolator(const std::string& name,
+                  const std::vector<CommandSet>& commandSets,
+                  bool isDebugMode = false,
+                  const RunnerOptions& runnerOptions = RunnerOptions(),
+                  const IsolatorOptions& isolatorOptions = IsolatorOptions());
 
   /**
    * Destructor
@@ -115,17 +142,22 @@ class CommandIsolator : public ::mesos::slave::Isolator {
       const ::mesos::ContainerID& containerId);
 
   /**
-   * Get prepare command.
+   * Get the command sets of the isolator, the default one first.
+   */
+  const std::vector<CommandSet>& commandSets() const;
+
+  /**
+   * Get prepare command of the default command set.
    */
   const Option<Command>& prepareCommand() const;
 
   /**
-   * Get cleanup command.
+   * Get isolate command of the default command set.
    */
   const Option<Command>& isolateCommand() const;
 
   /**
-   * Get cleanup command.
+   * Get cleanup command of the default command set.
    */
   const Option<Command>& cleanupCommand() const;
 
@@ -0,0 +1,265 @@
+#include "CommandPlacement.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/numify.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#ifndef SYS_clone3
+#define SYS_clone3 435
+#endif
+#ifndef CLONE_INTO_CGROUP
+#define CLONE_INTO_CGROUP 0x200000000ULL
+#endif
+
+namespace criteo {
+namespace mesos {
+
+using std::string;
+using std::vector;
+
+// Period of the CPU quota of the cgroup, the default one of the kernel.
+static const uint64_t CPU_PERIOD_MICROS = 100000;
+
+static const int IOPRIO_WHO_PROCESS = 1;
+static const int IOPRIO_CLASS_SHIFT = 13;
+
+/*
+ * The arguments of clone3, as of Linux 5.7.
+ */
+struct CloneArgs {
+  uint64_t flags;
+  uint64_t pidfd;
+  uint64_t childTid;
+  uint64_t parentTid;
+  uint64_t exitSignal;
+  uint64_t stack;
+  uint64_t stackSize;
+  uint64_t tls;
+  uint64_t setTid;
+  uint64_t setTidSize;
+  uint64_t cgroup;
+};
+
+// Cleared the first time the kernel refuses clone3, the commands are then
+// forked and move themselves into their cgroup.
+static std::atomic<bool> s_cloneIntoCgroup(true);
+
+static Try<cpu_set_t> parseCpuset(const string& cpuset) {
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  for (const string& range : strings::tokenize(cpuset, ",")) {
+    vector<string> bounds = strings::split(strings::trim(range), "-");
+    Try<int> first = numify<int>(bounds[0]);
+    Try<int> last = bounds.size() == 2 ? numify<int>(bounds[1]) : first;
+    if (bounds.size() > 2 || first.isError() || last.isError() ||
+        first.get() < 0 || last.get() < first.get() ||
+        last.get() >= CPU_SETSIZE) {
+      return Error("Invalid CPU set \"" + cpuset + "\"");
+    }
+    for (int cpu = first.get(); cpu <= last.get(); ++cpu) CPU_SET(cpu, &cpus);
+  }
+  if (CPU_COUNT(&cpus) == 0) return Error("Empty CPU set");
+  return cpus;
+}
+
+static Try<int> parseIonice(const string& ionice) {
+  vector<string> tokens = strings::split(ionice, ":");
+  int ioClass;
+  if (tokens[0] == "realtime") {
+    ioClass = 1;
+  } else if (tokens[0] == "best-effort") {
+    ioClass = 2;
+  } else if (tokens[0] == "idle") {
+    ioClass = 3;
+  } else {
+    return Error("Unknown I/O scheduling class \"" + tokens[0] + "\"");
+  }
+
+  int level = 0;
+  if (tokens.size() > 2) return Error("Invalid ionice \"" + ionice + "\"");
+  if (tokens.size() == 2) {
+    Try<int> parsed = numify<int>(tokens[1]);
+    if (parsed.isError() || parsed.get() < 0 || parsed.get() > 7) {
+      return Error("Invalid I/O priority level \"" + tokens[1] + "\"");
+    }
+    level = parsed.get();
+  }
+  return (ioClass << IOPRIO_CLASS_SHIFT) | level;
+}
+
+static Try<Nothing> writeControl(const string& cgroup, const string& control,
+                                 const string& value) {
+  Try<Nothing> written = os::write(path::join(cgroup, control), value);
+  if (written.isError()) {
+    return Error("Failed to set " + control + " of cgroup " + cgroup + ": " +
+                 written.error());
+  }
+  return Nothing();
+}
+
+/*
+ * Create the cgroup and set its CPU limits, in the files of cgroup v2 or
+ * those of the cpu controller of cgroup v1.
+ *
+ * @return Whether the cgroup belongs to the cgroup v2 hierarchy.
+ */
+static Try<bool> configureCgroup(const string& cgroup,
+                                 const PlacementOptions& options) {
+  Try<Nothing> created = os::mkdir(cgroup);
+  if (created.isError()) {
+    return Error("Failed to create cgroup " + cgroup + ": " + created.error());
+  }
+  if (!os::exists(path::join(cgroup, "cgroup.procs"))) {
+    return Error(cgroup + " is not a cgroup");
+  }
+
+  bool unified = os::exists(path::join(cgroup, "cgroup.controllers"));
+  if (options.cpuWeight.isSome()) {
+    uint64_t weight = options.cpuWeight.get();
+    if (weight < 1 || weight > 10000) {
+      return Error("Invalid CPU weight " + stringify(weight));
+    }
+    Try<Nothing> written =
+        unified ? writeControl(cgroup, "cpu.weight", stringify(weight))
+                : writeControl(cgroup, "cpu.shares",
+                               stringify(std::max<uint64_t>(
+                                   weight * 1024 / 100, 2)));
+    if (written.isError()) return Error(written.error());
+  }
+
+  if (options.cpuQuota.isSome()) {
+    if (options.cpuQuota.get() <= 0) {
+      return Error("Invalid CPU quota " + stringify(options.cpuQuota.get()));
+    }
+    uint64_t quota =
+        static_cast<uint64_t>(options.cpuQuota.get() * CPU_PERIOD_MICROS);
+    Try<Nothing> written = Nothing();
+    if (unified) {
+      written = writeControl(cgroup, "cpu.max",
+                             stringify(quota) + " " +
+                                 stringify(CPU_PERIOD_MICROS));
+    } else {
+      written = writeControl(cgroup, "cpu.cfs_period_us",
+                             stringify(CPU_PERIOD_MICROS));
+      if (written.isSome()) {
+        written = writeControl(cgroup, "cpu.cfs_quota_us", stringify(quota));
+      }
+    }
+    if (written.isError()) return Error(written.error());
+  }
+  return unified;
+}
+
+Try<std::shared_ptr<CommandPlacement>> CommandPlacement::create(
+    const PlacementOptions& options) {
+  std::shared_ptr<CommandPlacement> placement(new CommandPlacement());
+
+  if (options.cpuset.isSome()) {
+    Try<cpu_set_t> cpus = parseCpuset(options.cpuset.get());
+    if (cpus.isError()) return Error(cpus.error());
+    placement->m_cpuset = cpus.get();
+  }
+
+  if (options.nice.isSome()) {
+    if (options.nice.get() < -20 || options.nice.get() > 19) {
+      return Error("Invalid nice value " + stringify(options.nice.get()));
+    }
+    placement->m_nice = options.nice.get();
+  }
+
+  if (options.ionice.isSome()) {
+    Try<int> ioprio = parseIonice(options.ionice.get());
+    if (ioprio.isError()) return Error(ioprio.error());
+    placement->m_ioprio = ioprio.get();
+  }
+
+  if (options.cgroup.isSome()) {
+    const string& cgroup = options.cgroup.get();
+    Try<bool> unified = configureCgroup(cgroup, options);
+    if (unified.isError()) return Error(unified.error());
+
+    placement->m_cgroupProcsFd = ::open(
+        path::join(cgroup, "cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+    if (placement->m_cgroupProcsFd == -1) {
+      return ErrnoError("Failed to open the processes of cgroup " + cgroup);
+    }
+    // Only cgroup v2 supports cloning into a cgroup.
+    if (unified.get()) {
+      placement->m_cgroupFd =
+          ::open(cgroup.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (placement->m_cgroupFd == -1) {
+        return ErrnoError("Failed to open cgroup " + cgroup);
+      }
+    }
+  }
+  return placement;
+}
+
+CommandPlacement::CommandPlacement() : m_cgroupFd(-1), m_cgroupProcsFd(-1) {}
+
+CommandPlacement::~CommandPlacement() {
+  if (m_cgroupFd != -1) ::close(m_cgroupFd);
+  if (m_cgroupProcsFd != -1) ::close(m_cgroupProcsFd);
+}
+
+pid_t CommandPlacement::fork() const {
+  if (m_cgroupFd != -1 && s_cloneIntoCgroup.load()) {
+    CloneArgs args = {};
+    args.flags = CLONE_INTO_CGROUP;
+    args.exitSignal = SIGCHLD;
+    args.cgroup = static_cast<uint64_t>(m_cgroupFd);
+    long pid = syscall(SYS_clone3, &args, sizeof(args));
+    if (pid == 0) {
+      applyToSelf(true);
+      return 0;
+    }
+    if (pid > 0) return static_cast<pid_t>(pid);
+    if (errno != ENOSYS && errno != E2BIG && errno != EINVAL) return -1;
+
+    if (s_cloneIntoCgroup.exchange(false)) {
+      LOG(WARNING) << "The kernel cannot clone into a cgroup, the commands "
+                   << "now move into their cgroup after the fork";
+    }
+  }
+
+  pid_t pid = ::fork();
+  if (pid == 0) applyToSelf(false);
+  return pid;
+}
+
+void CommandPlacement::applyToSelf(bool inCgroup) const {
+  // Only async-signal-safe calls are allowed here, and the errors cannot be
+  // reported: the command runs unplaced rather than not at all.
+  if (!inCgroup && m_cgroupProcsFd != -1) {
+    ssize_t written = ::write(m_cgroupProcsFd, "0", 1);
+    (void)written;
+  }
+  if (m_cpuset.isSome()) {
+    sched_setaffinity(0, sizeof(cpu_set_t), &m_cpuset.get());
+  }
+  if (m_nice.isSome()) setpriority(PRIO_PROCESS, 0, m_nice.get());
+#ifdef SYS_ioprio_set
+  if (m_ioprio.isSome()) {
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, m_ioprio.get());
+  }
+#endif
+}
+
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,84 @@
+#ifndef __COMMAND_PLACEMENT_HPP__
+#define __COMMAND_PLACEMENT_HPP__
+
+#include <sched.h>
+#include <sys/types.h>
+
+#include <memory>
+#include <string>
+
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+namespace criteo {
+namespace mesos {
+
+/**
+ * @brief The settings of the cgroup and CPUs the commands of a module run on.
+ */
+struct PlacementOptions {
+  // Directory of the cgroup the commands are spawned into, created if
+  // missing. Both cgroup v2 and a cgroup v1 hierarchy holding the cpu
+  // controller are supported.
+  Option<std::string> cgroup;
+  // CPUs the commands run on, as a list like `0-3,8`.
+  Option<std::string> cpuset;
+  // Relative CPU weight of the cgroup, from 1 to 10000, 100 being the
+  // default weight of a cgroup v2.
+  Option<uint64_t> cpuWeight;
+  // Number of CPUs the whole cgroup can use at most, e.g. 0.5.
+  Option<double> cpuQuota;
+  // Nice value of the commands, from -20 to 19.
+  Option<int> nice;
+  // I/O scheduling class and level of the commands, like `idle` or
+  // `best-effort:7`.
+  Option<std::string> ionice;
+};
+
+/**
+ * @brief The CommandPlacement spawns the commands of a module into their
+ * cgroup, on their CPUs and with their priorities. The cgroup is configured
+ * once when the module is created.
+ *
+ * On Linux 5.7 and later with cgroup v2, the commands are cloned straight
+ * into the cgroup. Otherwise, the child moves itself into it before exec.
+ */
+class CommandPlacement {
+ public:
+  /**
+   * Configure the cgroup and parse the settings of the commands.
+   */
+  static Try<std::shared_ptr<CommandPlacement>> create(
+      const PlacementOptions& options);
+
+  ~CommandPlacement();
+
+  CommandPlacement(const CommandPlacement&) = delete;
+  CommandPlacement& operator=(const CommandPlacement&) = delete;
+
+  /**
+   * Fork the calling process into the placement. Like fork, it returns 0 in
+   * the child, which only makes async-signal-safe calls, and -1 with errno
+   * set on error.
+   */
+  pid_t fork() const;
+
+ private:
+  CommandPlacement();
+
+  // Apply the settings to the calling process, in the child.
+  void applyToSelf(bool inCgroup) const;
+
+  // Descriptor of the directory of the cgroup, -1 if there is none.
+  int m_cgroupFd;
+  // Descriptor of the cgroup.procs file of the cgroup, -1 if there is none.
+  int m_cgroupProcsFd;
+  Option<cpu_set_t> m_cpuset;
+  Option<int> m_nice;
+  Option<int> m_ioprio;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __COMMAND_PLACEMENT_HPP__
@@ -1,17 +1,28 @@
 #include "CommandRunner.hpp"
+#include "AuditLog.hpp"
+#include "DebugLog.hpp"
+#include "Probes.hpp"
 #include "RunningContext.hpp"
+#include "Tracer.hpp"
+#include "UnixSocketBackend.hpp"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <thread>
@@ -19,19 +30,24 @@
 #include <glog/logging.h>
 
 #include <stout/duration.hpp>
+#include <stout/lambda.hpp>
 #include <stout/nothing.hpp>
 #include <stout/os.hpp>
-#include <stout/proc.hpp>
 #include <stout/try.hpp>
 
-#include <process/after.hpp>
 #include <process/collect.hpp>
+#include <process/io.hpp>
 #include <process/process.hpp>
+#include <process/reap.hpp>
 #include <process/subprocess.hpp>
 
 #define READ 0
 #define WRITE 1
 
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
 namespace criteo {
 namespace mesos {
 
@@ -41,124 +57,639 @@ using std::vector;
 using namespace std::chrono;
 using namespace process;
 
-inline static bool processStillRunning(pid_t pid) {
-  return proc::status(pid).isSome();
+// Time given to a command to exit after SIGTERM before it is killed.
+static const Duration KILL_GRACE_PERIOD = Seconds(1);
+
+/*
+ * @return The limit of the size of the files written by a command,
+ * RLIM_INFINITY if none is configured.
+ */
+static rlim_t fileSizeRlimit(const Option<size_t>& limit) {
+  return limit.isSome() ? static_cast<rlim_t>(limit.get()) : RLIM_INFINITY;
 }
 
 /*
- * Fork the process to run command and kill the child if it does not
- * finish before the timeout deadline.
+ * Apply the file size limit in the child, with async-signal-safe calls only.
+ * The hard limit is left untouched for the commands which write large files
+ * on purpose, they can raise it.
+ */
+static void limitFileSize(rlim_t limit) {
+  struct rlimit fileSize;
+  if (limit == RLIM_INFINITY || getrlimit(RLIMIT_FSIZE, &fileSize) == -1) {
+    return;
+  }
+  fileSize.rlim_cur = std::min(limit, fileSize.rlim_max);
+  setrlimit(RLIMIT_FSIZE, &fileSize);
+}
+
+/*
+ * What is known about how a command terminated, used to fill the audit record
+ * of the invocation.
+ */
+struct CommandOutcome {
+  CommandOutcome() : timedOut(false) {}
+
+  // The wait status of the command if it has been reaped.
+  Option<int> status;
+  bool timedOut;
+  // The resource usage of the command if it has been reaped by the runner,
+  // i.e. on the synchronous path: libprocess reaps the asynchronous commands
+  // without it.
+  Option<struct rusage> usage;
+};
+
+/*
+ * State of an asynchronous invocation shared by the continuations of its
+ * future. They capture a pointer to it rather than copies of the context,
+ * the metadata and the strings of the call, which would be copied again
+ * every time the continuations are.
+ */
+struct AsyncInvocation {
+  AsyncInvocation(bool debug, const logging::Metadata& loggingMetadata,
+                  const Command& command, const string& input, uint64_t id,
+                  uint64_t start, const RunnerOptions& options)
+      : context(debug, loggingMetadata, command, input, id,
+                options.tempFilePool, options.maxOutputSize),
+        loggingMetadata(loggingMetadata),
+        executable(command.command()),
+        auditLog(options.auditLog),
+        placement(options.placement),
+        fileSizeLimit(fileSizeRlimit(options.fileSizeLimit)),
+        id(id),
+        start(start),
+        spawned(0),
+        inputSize(input.size()) {}
+
+  const RunningContext context;
+  const logging::Metadata loggingMetadata;
+  const string executable;
+  const std::shared_ptr<audit::AuditLog> auditLog;
+  const std::shared_ptr<const CommandPlacement> placement;
+  const rlim_t fileSizeLimit;
+  const uint64_t id;
+  const uint64_t start;
+  uint64_t spawned;
+  const size_t inputSize;
+  CommandOutcome outcome;
+};
+
+inline static uint64_t toMicros(const struct timeval& time) {
+  return static_cast<uint64_t>(time.tv_sec) * 1000000 + time.tv_usec;
+}
+
+/*
+ * Append the record of an invocation to the audit log of the module, if any.
+ */
+static void auditInvocation(const std::shared_ptr<audit::AuditLog>& auditLog,
+                            const logging::Metadata& loggingMetadata,
+                            uint64_t start, const CommandOutcome& outcome,
+                            size_t inputSize, size_t outputSize, bool failed) {
+  if (!auditLog) return;
+
+  audit::Record record = audit::Record();
+  record.timestamp = start;
+  record.durationMicros = tracing::nowMicros() - start;
+  record.containerHash = audit::hash(loggingMetadata.taskId);
+  audit::copyString(record.event, loggingMetadata.method);
+  record.exitCode = -1;
+  if (outcome.status.isSome()) {
+    int status = outcome.status.get();
+    if (WIFEXITED(status)) record.exitCode = WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) record.signal = WTERMSIG(status);
+  }
+  if (outcome.usage.isSome()) {
+    const struct rusage& usage = outcome.usage.get();
+    record.flags |= audit::AUDIT_FLAG_HAS_RUSAGE;
+    record.userTimeMicros = toMicros(usage.ru_utime);
+    record.systemTimeMicros = toMicros(usage.ru_stime);
+    record.maxRssKilobytes = usage.ru_maxrss;
+    record.minorFaults = usage.ru_minflt;
+    record.majorFaults = usage.ru_majflt;
+  }
+  if (outcome.timedOut) record.flags |= audit::AUDIT_FLAG_TIMED_OUT;
+  if (failed) record.flags |= audit::AUDIT_FLAG_FAILED;
+  record.inputSize = inputSize;
+  record.outputSize = outputSize;
+  auditLog->append(record);
+}
+
+/*
+ * Turn the wait status of a command into an error if it did not succeed.
+ */
+static Try<bool> checkStatus(const string& executable,
+                             const Option<int>& status,
+                             const logging::Metadata& loggingMetadata) {
+  if (status.isNone()) {
+    string errorMessage =
+        "Error getting status for external command \"" + executable + "\"";
+    TASK_LOG(ERROR, loggingMetadata) << errorMessage;
+    return Error(errorMessage);
+  } else if (status.get() != 0) {
+    if (WIFSIGNALED(status.get()) && WTERMSIG(status.get()) == SIGXFSZ) {
+      TASK_LOG(ERROR, loggingMetadata)
+          << "Failed to successfully run the command \"" << executable
+          << "\", it wrote more than the file size limit";
+      return Error("Command \"" + executable +
+                   "\" exceeded the file size limit.");
+    }
+    if (WIFSIGNALED(status.get()) && WTERMSIG(status.get()) != 0) {
+      int signalCode = WTERMSIG(status.get());
+      TASK_LOG(ERROR, loggingMetadata)
+          << "Failed to successfully run the command \"" << executable
+          << "\", it exited with signal " << signalCode;
+      return Error("Command \"" + executable + "\" exited via signal " +
+                   std::to_string(signalCode) + ".");
+    }
+    int exitCode = WEXITSTATUS(status.get());
+    string error(os::strerror(exitCode));
+    TASK_LOG(ERROR, loggingMetadata)
+        << "Failed to successfully run the command \"" << executable
+        << "\", it failed with status " << exitCode << " (" << error << ")";
+    return Error("Command \"" + executable + "\" exited with return code " +
+                 std::to_string(exitCode) + ".");
+  }
+  return true;
+}
+
+/*
+ * Open a descriptor becoming readable when a child exits, or return -1 if
+ * the kernel does not support it (Linux < 5.3).
+ */
+static int openPidfd(pid_t pid) {
+  return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+}
+
+/*
+ * Signal the process group of a command, i.e. the command and all the
+ * processes it spawned which did not leave its group.
+ */
+static void signalGroup(pid_t pid, int signal,
+                        const logging::Metadata& loggingMetadata) {
+  if (killpg(pid, signal) == -1 && errno != ESRCH) {
+    TASK_LOG(ERROR, loggingMetadata) << "Failed to send signal " << signal
+                                     << " to process group " << pid << ": "
+                                     << os::strerror(errno);
+  }
+}
+
+/*
+ * Wait for a child to terminate until a deadline. The exit is detected as
+ * soon as it happens through the pidfd of the child if there is one,
+ * otherwise the child is polled with an exponential backoff bounded to a few
+ * milliseconds so that short commands are detected quickly without spinning
+ * on long ones.
  *
- * TODO(clems4ever): split this method so that it becomes easier to read.
+ * @return true if the child has been reaped, false on deadline.
+ */
+static bool reapChild(pid_t pid, int pidfd, steady_clock::time_point deadline,
+                      CommandOutcome& outcome) {
+  microseconds backoff(100);
+  while (true) {
+    int status;
+    struct rusage usage;
+    pid_t result = wait4(pid, &status, WNOHANG, &usage);
+    if (result == pid) {
+      outcome.status = status;
+      outcome.usage = usage;
+      return true;
+    }
+    if (result == -1 && errno != EINTR) return true;
+
+    steady_clock::time_point now = steady_clock::now();
+    if (now >= deadline) return false;
+    if (pidfd != -1) {
+      struct pollfd exit = {pidfd, POLLIN, 0};
+      milliseconds timeout = std::min<milliseconds>(
+          duration_cast<milliseconds>(deadline - now) + milliseconds(1),
+          milliseconds(std::numeric_limits<int>::max()));
+      poll(&exit, 1, static_cast<int>(timeout.count()));
+      continue;
+    }
+    std::this_thread::sleep_for(
+        std::min<steady_clock::duration>(backoff, deadline - now));
+    backoff = std::min<microseconds>(backoff * 2, milliseconds(10));
+  }
+}
+
+/*
+ * Fork and exec a command on the calling thread, without libprocess, and kill
+ * its process group if it does not finish before the timeout deadline. The
+ * child is reaped by the runner so its resource usage is known.
  *
- * @param executable Absolute path to the executed of the command to execute in
- * the child process.
+ * @param executable The command to execute in the child process.
+ * @param program The file to execute for the command, its in-memory copy if
+ * it has been preloaded.
  * @param timeout The timeout deadline in seconds before killing the
  * child process.
+ * @param placement The cgroup and CPUs of the child, if any.
+ * @param fileSizeLimit The maximum size of the files written by the child.
+ * @param invocation The identifier of the invocation in the traces.
+ * @param outcome Filled with how the command terminated.
  */
-Future<Try<bool>> runCommandWithTimeout(
-    const std::string& executable, const std::vector<std::string>& args,
-    unsigned long timeoutInSeconds, const logging::Metadata& loggingMetadata) {
+static Try<bool> runCommandSync(const std::string& executable,
+                                const std::string& program,
+                                const std::vector<std::string>& args,
+                                unsigned long timeoutInSeconds,
+                                const CommandPlacement* placement,
+                                rlim_t fileSizeLimit,
+                                const logging::Metadata& loggingMetadata,
+                                uint64_t invocation, CommandOutcome& outcome) {
   vector<string> commandLine = {executable, args[0], args[1], args[2]};
+  vector<char*> argv;
+  for (const string& arg : commandLine) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  int input = ::open(args[0].c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (input == -1) {
+    return ErrnoError("Error opening the input of external command \"" +
+                      executable + "\"");
+  }
 
-  Try<Subprocess> command =
-      subprocess(executable, commandLine, Subprocess::PATH(args[0]));
+  tracing::ScopedSpan spawnSpan("spawn", loggingMetadata, invocation);
+  pid_t pid = placement ? placement->fork() : fork();
+  if (pid == 0) {
+    // Only async-signal-safe calls are allowed in the child of a threaded
+    // process. The child leads its own process group so that the whole tree
+    // can be killed on timeout.
+    setsid();
+    limitFileSize(fileSizeLimit);
+    dup2(input, STDIN_FILENO);
+    execvp(program.c_str(), argv.data());
+    _exit(127);
+  }
+  int forkErrno = errno;
+  ::close(input);
+  spawnSpan.finish();
 
-  if (command.isError()) {
+  if (pid == -1) {
     string errorMessage = "Error launching external command \"" + executable +
-                          "\": " + command.error();
+                          "\": " + os::strerror(forkErrno);
     TASK_LOG(ERROR, loggingMetadata) << errorMessage;
     return Error(errorMessage);
   }
-  Subprocess process = command.get();
-  return process.status()
-      .then([=](Option<int> status) -> Future<Try<bool>> {
-        if (status.isNone()) {
-          string errorMessage = "Error getting status for external command \"" +
-                                executable + "\"";
-          TASK_LOG(ERROR, loggingMetadata) << errorMessage;
-          return Error(errorMessage);
-        } else if (status.get() != 0) {
-          if (WIFSIGNALED(status.get()) && WTERMSIG(status.get()) != 0) {
-            int signalCode = WTERMSIG(status.get());
-            TASK_LOG(ERROR, loggingMetadata)
-                << "Failed to successfully run the command \"" << executable
-                << "\", it exited with signal " << signalCode;
-            return Error("Command \"" + executable + "\" exited via signal " +
-                         std::to_string(signalCode) + ".");
-          }
-          int exitCode = WEXITSTATUS(status.get());
-          string error(os::strerror(exitCode));
-          TASK_LOG(ERROR, loggingMetadata)
-              << "Failed to successfully run the command \"" << executable
-              << "\", it failed with status " << exitCode << " (" << error
-              << ")";
-          return Error("Command \"" + executable +
-                       "\" exited with return code " +
-                       std::to_string(exitCode) + ".");
+  PROBE_COMMAND_SPAWN(loggingMetadata, executable, pid);
+  uint64_t spawned = tracing::nowMicros();
+  int pidfd = openPidfd(pid);
+
+  steady_clock::time_point deadline =
+      steady_clock::now() + seconds(timeoutInSeconds);
+  if (!reapChild(pid, pidfd, deadline, outcome)) {
+    outcome.timedOut = true;
+    PROBE_COMMAND_TIMEOUT(loggingMetadata, executable, pid);
+    TASK_LOG(WARNING, loggingMetadata)
+        << "External command took too long to exit. "
+        << "Sending SIGTERM to " << pid << "...";
+    PROBE_COMMAND_SIGTERM(loggingMetadata, pid);
+    signalGroup(pid, SIGTERM, loggingMetadata);
+    steady_clock::time_point graceDeadline =
+        steady_clock::now() + nanoseconds(KILL_GRACE_PERIOD.ns());
+    bool reaped = reapChild(pid, pidfd, graceDeadline, outcome);
+    if (!reaped) {
+      TASK_LOG(WARNING, loggingMetadata)
+          << "External command is still running. Sending SIGKILL...";
+    }
+    // The group is killed even if the command exited on SIGTERM, its
+    // children may ignore it.
+    PROBE_COMMAND_SIGKILL(loggingMetadata, pid);
+    signalGroup(pid, SIGKILL, loggingMetadata);
+    // A child stuck in an uninterruptible sleep is never reaped, the call
+    // fails anyway after the grace period rather than holding the thread, and
+    // the reaper of libprocess collects the child if it ever exits.
+    if (!reaped &&
+        !reapChild(pid, pidfd,
+                   steady_clock::now() + nanoseconds(KILL_GRACE_PERIOD.ns()),
+                   outcome)) {
+      TASK_LOG(ERROR, loggingMetadata)
+          << "External command has not been reaped after SIGKILL, giving up "
+          << "waiting for it";
+      process::reap(pid);
+    }
+    if (pidfd != -1) ::close(pidfd);
+    tracing::Tracer::instance().record("run", loggingMetadata, invocation,
+                                       spawned, tracing::nowMicros());
+    return Error("Command \"" + executable + "\" took too long to execute.");
+  }
+  if (pidfd != -1) ::close(pidfd);
+
+  tracing::Tracer::instance().record("run", loggingMetadata, invocation,
+                                     spawned, tracing::nowMicros());
+  PROBE_COMMAND_EXIT(loggingMetadata, executable,
+                     outcome.status.isSome() ? outcome.status.get() : -1);
+  return checkStatus(executable, outcome.status, loggingMetadata);
+}
+
+/*
+ * @return A future ready as soon as a child exits. Its pidfd is watched if
+ * the kernel supports it, otherwise the future waits for the reaper of
+ * libprocess, which polls the children.
+ */
+static Future<Nothing> exited(const Subprocess& process) {
+  int pidfd = openPidfd(process.pid());
+  if (pidfd == -1) {
+    return process.status().then([]() { return Nothing(); });
+  }
+
+  fcntl(pidfd, F_SETFL, fcntl(pidfd, F_GETFL) | O_NONBLOCK);
+  return io::poll(pidfd, io::READ)
+      .then([]() { return Nothing(); })
+      .onAny([pidfd]() { ::close(pidfd); });
+}
+
+/*
+ * Fork the process to run command and kill its process group if it does not
+ * finish before the timeout deadline.
+ *
+ * @param program The file to execute for the command, its in-memory copy if
+ * it has been preloaded.
+ * @param timeout The timeout deadline in seconds before killing the
+ * child process.
+ * @param call The invocation, its outcome is filled with how the command
+ * terminated.
+ */
+Future<Try<bool>> runCommandWithTimeout(
+    const std::string& program, unsigned long timeoutInSeconds,
+    const std::shared_ptr<AsyncInvocation>& call) {
+  const vector<string>& args = call->context.get_args();
+  vector<string> commandLine = {call->executable, args[0], args[1], args[2]};
+
+  tracing::ScopedSpan spawnSpan("spawn", call->loggingMetadata, call->id);
+  const CommandPlacement* placement = call->placement.get();
+  rlim_t fileSizeLimit = call->fileSizeLimit;
+  // The child is forked into its cgroup, if any, and cannot write files
+  // larger than the file size limit, if any.
+  lambda::function<pid_t(const lambda::function<int()>&)> clone =
+      [placement, fileSizeLimit](const lambda::function<int()>& child) {
+        pid_t pid = placement ? placement->fork() : ::fork();
+        if (pid == 0) {
+          limitFileSize(fileSizeLimit);
+          ::_exit(child());
         }
-        return true;
+        return pid;
+      };
+  // The child leads its own process group so that the whole tree can be
+  // killed on timeout.
+  Try<Subprocess> command = subprocess(
+      program, commandLine, Subprocess::PATH(args[0]),
+      Subprocess::FD(STDOUT_FILENO), Subprocess::FD(STDERR_FILENO), nullptr,
+      None(), clone, {}, {Subprocess::ChildHook::SETSID()});
+  spawnSpan.finish();
+
+  if (command.isError()) {
+    string errorMessage = "Error launching external command \"" +
+                          call->executable + "\": " + command.error();
+    TASK_LOG(ERROR, call->loggingMetadata) << errorMessage;
+    return Error(errorMessage);
+  }
+  Subprocess process = command.get();
+  PROBE_COMMAND_SPAWN(call->loggingMetadata, call->executable, process.pid());
+  call->spawned = tracing::nowMicros();
+  Future<Option<int>> reaped = process.status();
+  return reaped
+      .then([call](const Option<int>& status) -> Future<Try<bool>> {
+        // The child has been reaped by libprocess at this point, the span
+        // therefore includes the latency of the reaper.
+        tracing::Tracer::instance().record("run", call->loggingMetadata,
+                                           call->id, call->spawned,
+                                           tracing::nowMicros());
+        PROBE_COMMAND_EXIT(call->loggingMetadata, call->executable,
+                           status.isSome() ? status.get() : -1);
+        return checkStatus(call->executable, status, call->loggingMetadata);
       })
       .after(
           Seconds(timeoutInSeconds),
-          [=](Future<Try<bool>> future) -> Future<Try<bool>> {
+          [call, process](const Future<Try<bool>>&) -> Future<Try<bool>> {
+            const logging::Metadata& loggingMetadata = call->loggingMetadata;
+            PROBE_COMMAND_TIMEOUT(loggingMetadata, call->executable,
+                                  process.pid());
+            call->outcome.timedOut = true;
             TASK_LOG(WARNING, loggingMetadata)
                 << "External command took too long to exit. "
                 << "Sending SIGTERM to " << process.pid() << "...";
-            Try<std::list<os::ProcessTree>> kill =
-                os::killtree(process.pid(), SIGTERM);
-            if (kill.isError()) {
-              TASK_LOG(ERROR, loggingMetadata) << "Failed to send SIGTERM: "
-                                               << kill.error();
-            }
-            return after(Seconds(1)).then([=]() -> Future<Try<bool>> {
-              if (processStillRunning(process.pid())) {
-                TASK_LOG(WARNING, loggingMetadata)
-                    << "External command is still running. Sending SIGKILL...";
-                Try<std::list<os::ProcessTree>> kill =
-                    os::killtree(process.pid(), SIGKILL);
-                if (kill.isError()) {
-                  TASK_LOG(ERROR, loggingMetadata)
-                      << "Failed to kill the command: " << kill.error();
-                  return Failure(
-                      "Command \"" + executable +
-                      "\" took too long to execute and SIGKILL failed.");
-                }
-              }
-              return Failure("Command \"" + executable +
-                             "\" took too long to execute.");
-            });
-          });
+            PROBE_COMMAND_SIGTERM(loggingMetadata, process.pid());
+            signalGroup(process.pid(), SIGTERM, loggingMetadata);
+            return exited(process)
+                .after(KILL_GRACE_PERIOD,
+                       [call](const Future<Nothing>&) -> Future<Nothing> {
+                         TASK_LOG(WARNING, call->loggingMetadata)
+                             << "External command is still running. "
+                             << "Sending SIGKILL...";
+                         return Nothing();
+                       })
+                .then([call, process, reaped]() {
+                  // The group is killed even if the command exited on
+                  // SIGTERM, its children may ignore it.
+                  PROBE_COMMAND_SIGKILL(call->loggingMetadata, process.pid());
+                  signalGroup(process.pid(), SIGKILL, call->loggingMetadata);
+                  // A child stuck in an uninterruptible sleep is never
+                  // reaped, the call fails anyway after the grace period and
+                  // its status is left unknown. The status is not waited for
+                  // directly so that the timeout does not discard it.
+                  auto killed = std::make_shared<Promise<Nothing>>();
+                  reaped.onAny([killed]() { killed->set(Nothing()); });
+                  return killed->future().after(
+                      KILL_GRACE_PERIOD,
+                      [call](const Future<Nothing>&) -> Future<Nothing> {
+                        TASK_LOG(ERROR, call->loggingMetadata)
+                            << "External command has not been reaped after "
+                            << "SIGKILL, giving up waiting for it";
+                        return Nothing();
+                      });
+                })
+                .then([call]() -> Future<Try<bool>> {
+                  return Failure("Command \"" + call->executable +
+                                 "\" took too long to execute.");
+                });
+          })
+      .onAny([call, reaped]() {
+        // Filled here if the command has been reaped whatever the path taken,
+        // rather than by the continuation of the status which still runs
+        // after a timeout, concurrently with the readers of the outcome.
+        if (reaped.isReady()) call->outcome.status = reaped.get();
+      });
+}
+
+/*
+ * Trace, log and audit an invocation served by the daemon of a `unix://`
+ * command.
+ */
+static void recordDaemonCall(const logging::Metadata& loggingMetadata,
+                             const std::shared_ptr<audit::AuditLog>& auditLog,
+                             uint64_t invocation, uint64_t start,
+                             size_t inputSize, const Try<string>& output) {
+  tracing::Tracer::instance().record("rpc", loggingMetadata, invocation, start,
+                                     tracing::nowMicros());
+  if (output.isError()) TASK_LOG(ERROR, loggingMetadata) << output.error();
+  auditInvocation(auditLog, loggingMetadata, start, CommandOutcome(),
+                  inputSize, output.isSome() ? output->size() : 0,
+                  output.isError());
 }
 
 CommandRunner::CommandRunner(bool debug,
-                             const logging::Metadata& loggingMetadata)
-    : m_debug(debug), m_loggingMetadata(loggingMetadata) {}
+                             const logging::Metadata& loggingMetadata,
+                             const RunnerOptions& options)
+    : m_debug(debug), m_loggingMetadata(loggingMetadata), m_options(options) {}
+
+const string& CommandRunner::program(const Command& command) const {
+  return m_options.executables ? m_options.executables->path(command.command())
+                               : command.command();
+}
+
+bool CommandRunner::sampleDebug() const {
+  if (!m_debug) return false;
+  return !m_options.debugSampler ||
+         m_options.debugSampler->sample(m_loggingMetadata);
+}
+
+uint64_t CommandRunner::invocationId() const {
+  if (m_loggingMetadata.invocation != 0) return m_loggingMetadata.invocation;
+  return tracing::Tracer::instance().nextInvocation();
+}
+
+std::shared_ptr<CircuitBreaker> CommandRunner::circuitBreaker(
+    const Command& command) const {
+  if (!m_options.circuitBreakers) return nullptr;
+  return m_options.circuitBreakers->get(command.command(),
+                                        m_loggingMetadata.method);
+}
+
+/*
+ * The error of a call rejected by the circuit breaker of its command. It is
+ * not logged, the breaker logs when it opens and closes.
+ */
+static Error rejectedCall(const Command& command) {
+  return Error("Command \"" + command.command() +
+               "\" is not run while it keeps failing");
+}
+
+/*
+ * Whether a call is slow enough to count against the circuit breaker of its
+ * command.
+ */
+static bool isSlowCall(const CircuitBreaker& breaker,
+                       unsigned long timeoutInSeconds, uint64_t start) {
+  double elapsedSecs = (tracing::nowMicros() - start) / 1e6;
+  return elapsedSecs > breaker.options().slowCallRatio * timeoutInSeconds;
+}
+
+/*
+ * Whether a call counts as failed for the circuit breaker of its command. A
+ * command exiting with a non-zero code is up and answering, e.g. a hook
+ * refusing a task, only timeouts, signals and failures to spawn the command
+ * or to read its output are.
+ */
+static bool isBreakerFailure(bool failed, const CommandOutcome& outcome) {
+  if (!failed) return false;
+  if (outcome.timedOut || outcome.status.isNone()) return true;
+  int status = outcome.status.get();
+  return !WIFEXITED(status) || WEXITSTATUS(status) == 0;
+}
+
+ExecutionQueue::Priority CommandRunner::priority() const {
+  return ExecutionQueue::priorityOf(m_loggingMetadata.method);
+}
 
 Future<Try<string>> CommandRunner::asyncRun(const Command& command,
                                             const std::string& input) {
+  std::shared_ptr<ExecutionQueue> queue = m_options.executionQueue;
+  if (!queue) return asyncRunWithBreaker(command, input);
+
+  Future<Nothing> slot =
+      queue->acquire(priority(), m_loggingMetadata.frameworkId);
+  Future<Try<string>> output;
+  if (slot.isReady()) {
+    output = asyncRunWithBreaker(command, input);
+  } else {
+    // The runner is usually a temporary, the waiting call keeps a copy.
+    CommandRunner runner = *this;
+    output = slot.then([runner, command, input](const Nothing&) mutable {
+      return runner.asyncRunWithBreaker(command, input);
+    });
+  }
+  // The slot is also released when the breaker rejects the call.
+  return output.onAny(
+      [queue](const Future<Try<string>>&) { queue->release(); });
+}
+
+Future<Try<string>> CommandRunner::asyncRunWithBreaker(
+    const Command& command, const std::string& input) {
+  std::shared_ptr<CircuitBreaker> breaker = circuitBreaker(command);
+  if (!breaker) return asyncRunCommand(command, input, nullptr);
+  Option<uint64_t> acquired = breaker->tryAcquire();
+  if (acquired.isNone()) return rejectedCall(command);
+
+  uint64_t generation = acquired.get();
+  uint64_t start = tracing::nowMicros();
+  auto outcome = std::make_shared<CommandOutcome>();
+  return asyncRunCommand(command, input, outcome)
+      .onAny([breaker, generation, timeout = command.timeout(), start,
+              outcome](const Future<Try<string>>& output) {
+        bool failed = !output.isReady() || output->isError();
+        breaker->record(generation, isBreakerFailure(failed, *outcome),
+                        isSlowCall(*breaker, timeout, start));
+      });
+}
+
+Future<Try<string>> CommandRunner::asyncRunCommand(
+    const Command& command, const std::string& input,
+    const std::shared_ptr<CommandOutcome>& outcome) {
+  uint64_t invocation = invocationId();
+  uint64_t start = tracing::nowMicros();
+
+  if (UnixSocketBackend::handles(command.command())) {
+    auto promise = std::make_shared<Promise<Try<string>>>();
+    UnixSocketBackend::get(command.command())
+        ->send(m_loggingMetadata.method, input, Seconds(command.timeout()),
+               [ =, loggingMetadata = m_loggingMetadata,
+                 auditLog = m_options.auditLog, inputSize = input.size() ](
+                   const Try<string>& output) {
+                 recordDaemonCall(loggingMetadata, auditLog, invocation,
+                                  start, inputSize, output);
+                 promise->set(output);
+               });
+    return promise->future();
+  }
+
+  bool debug = sampleDebug();
   try {
-    RunningContext rc{m_debug, m_loggingMetadata, command, input};
+    tracing::ScopedSpan contextSpan("create_context", m_loggingMetadata,
+                                    invocation);
+    auto call = std::make_shared<AsyncInvocation>(
+        debug, m_loggingMetadata, command, input, invocation, start, m_options);
+    contextSpan.finish();
 
-    return runCommandWithTimeout(command.command(), rc.get_args(),
-                                 command.timeout(), m_loggingMetadata)
-        .then([=](Try<bool> status) -> Future<Try<string>> {
+    return runCommandWithTimeout(program(command), command.timeout(), call)
+        .then([call](const Try<bool>& status) -> Future<Try<string>> {
+          tracing::ScopedSpan readSpan("read_output", call->loggingMetadata,
+                                       call->id);
           if (status.isError()) {
-            Try<string> stderr = rc.readError();
+            Try<string> stderr = call->context.readError();
             if (stderr.isError() || stderr.get().empty())
               return Error(status.error());
             return Error(status.error() + " Cause: " + stderr.get());
           }
-          return rc.readOutput();
+          return call->context.readOutput();
         })
-        .onAny([ =, loggingMetadata =
-                        m_loggingMetadata ](Future<Try<string>> output)
-                   ->Future<Try<string>> {
-                     rc.deleteContext();
-                     return output;
-                   });
+        .onAny([call, outcome](const Future<Try<string>>& output) {
+          // Runs before the callbacks the caller adds to the output.
+          if (outcome) *outcome = call->outcome;
+          tracing::ScopedSpan deleteSpan("delete_context",
+                                         call->loggingMetadata, call->id);
+          // A command killed on timeout may have left children writing in
+          // its files.
+          call->context.deleteContext(!call->outcome.timedOut);
+          deleteSpan.finish();
+          tracing::Tracer::instance().record("command", call->loggingMetadata,
+                                             call->id, call->start,
+                                             tracing::nowMicros());
+          bool succeeded = output.isReady() && output->isSome();
+          auditInvocation(call->auditLog, call->loggingMetadata, call->start,
+                          call->outcome, call->inputSize,
+                          succeeded ? output->get().size() : 0, !succeeded);
+        });
   } catch (const std::runtime_error& e) {
-    if (m_debug) {
+    if (debug) {
       return Error("[DEBUG] " + string(e.what()) + ". Input was \"" + input +
                    "\"");
     }
@@ -166,39 +697,101 @@ Future<Try<string>> CommandRunner::asyncRun(const Command& command,
   }
 }
 
-Try<string> CommandRunner::runWithoutTimeout(const Command& command,
-                                             const std::string& input) {
-  RunningContext rc{m_debug, m_loggingMetadata, command, input};
+Try<string> CommandRunner::runSync(const Command& command,
+                                   const std::string& input) {
+  const std::shared_ptr<ExecutionQueue>& queue = m_options.executionQueue;
+  if (queue) queue->acquireSync(priority(), m_loggingMetadata.frameworkId);
 
-  std::stringstream cmdline;
-  cmdline << command.command() << " ";
-  for (auto i : rc.get_args()) cmdline << i << " ";
+  // The breaker is only asked once the call can run, so that a trial call
+  // does not hold its token while waiting in the queue.
+  std::shared_ptr<CircuitBreaker> breaker = circuitBreaker(command);
+  uint64_t generation = 0;
+  if (breaker) {
+    Option<uint64_t> acquired = breaker->tryAcquire();
+    if (acquired.isNone()) {
+      if (queue) queue->release();
+      return rejectedCall(command);
+    }
+    generation = acquired.get();
+  }
 
-  auto start = std::chrono::system_clock::now();
-  int ret = system(cmdline.str().c_str());
-  if (ret < 0) {
-    string errorMessage = "Error launching external command \"" +
-                          command.command() + "\": " + strerror(errno);
-    TASK_LOG(ERROR, m_loggingMetadata) << errorMessage;
-    return Error(errorMessage);
+  uint64_t start = tracing::nowMicros();
+  CommandOutcome outcome;
+  Try<string> output = runSyncCommand(command, input, outcome);
+  if (breaker) {
+    breaker->record(generation, isBreakerFailure(output.isError(), outcome),
+                    isSlowCall(*breaker, command.timeout(), start));
   }
-  if (ret) {
-    Try<string> stderr = rc.readError();
-    std::string errMsg =
-        "Command exited with exit code: " + std::to_string(WEXITSTATUS(ret));
-    if (stderr.isError() || stderr.get().empty()) return Error(errMsg);
-    return Error(errMsg + " Cause: " + stderr.get());
+
+  if (queue) queue->release();
+  return output;
+}
+
+Try<string> CommandRunner::runSyncCommand(const Command& command,
+                                          const std::string& input,
+                                          CommandOutcome& outcome) {
+  uint64_t invocation = invocationId();
+  uint64_t start = tracing::nowMicros();
+
+  if (UnixSocketBackend::handles(command.command())) {
+    Try<string> output =
+        UnixSocketBackend::get(command.command())
+            ->call(m_loggingMetadata.method, input, Seconds(command.timeout()));
+    recordDaemonCall(m_loggingMetadata, m_options.auditLog, invocation, start,
+                     input.size(), output);
+    return output;
   }
-  auto end = std::chrono::system_clock::now();
 
-  if (m_debug) {
-    std::chrono::duration<double> elapsed_seconds = end - start;
-    LOG(WARNING) << "Finished Executing : " << cmdline.str().c_str() << " in "
-                 << elapsed_seconds.count() << " seconds";
+  tracing::ScopedSpan commandSpan("command", m_loggingMetadata, invocation);
+  bool debug = sampleDebug();
+
+  try {
+    tracing::ScopedSpan contextSpan("create_context", m_loggingMetadata,
+                                    invocation);
+    RunningContext rc(debug, m_loggingMetadata, command, input, invocation,
+                      m_options.tempFilePool, m_options.maxOutputSize);
+    contextSpan.finish();
+
+    Try<bool> status =
+        runCommandSync(command.command(), program(command), rc.get_args(),
+                       command.timeout(), m_options.placement.get(),
+                       fileSizeRlimit(m_options.fileSizeLimit),
+                       m_loggingMetadata, invocation, outcome);
+
+    if (debug) {
+      TASK_DEBUG(m_loggingMetadata)
+          << "Finished executing \"" << command.command() << "\" in "
+          << (tracing::nowMicros() - start) / 1000 << " ms";
+    }
+
+    tracing::ScopedSpan readSpan("read_output", m_loggingMetadata, invocation);
+    Try<string> output = rc.readOutput();
+    if (status.isError()) {
+      Try<string> stderr = rc.readError();
+      if (stderr.isError() || stderr.get().empty()) {
+        output = Error(status.error());
+      } else {
+        output = Error(status.error() + " Cause: " + stderr.get());
+      }
+    }
+    readSpan.finish();
+
+    tracing::ScopedSpan deleteSpan("delete_context", m_loggingMetadata,
+                                   invocation);
+    // A command killed on timeout may have left children writing in its
+    // files.
+    rc.deleteContext(!outcome.timedOut);
+    deleteSpan.finish();
+
+    auditInvocation(m_options.auditLog, m_loggingMetadata, start, outcome,
+                    input.size(), output.isSome() ? output.get().size() : 0,
+                    output.isError());
+    return output;
+  } catch (const std::runtime_error& e) {
+    auditInvocation(m_options.auditLog, m_loggingMetadata, start, outcome,
+                    input.size(), 0, true);
+    return Error(e.what());
   }
-  auto output = rc.readOutput();
-  rc.deleteContext();
-  return output;
 }
 
 Try<string> CommandRunner::run(const Command& command,
@@ -213,5 +806,54 @@ Try<string> CommandRunner::run(const Command& command,
   }
   return output.get();
 }
+
+Future<vector<Try<string>>> CommandRunner::asyncRunAll(
+    const Command& command, const std::string& input) {
+  if (command.executables().size() == 1) {
+    return asyncRun(command, input).then([](const Try<string>& output) {
+      return vector<Try<string>>{output};
+    });
+  }
+
+  vector<Future<Try<string>>> outputs;
+  for (const Command& executable : command.split()) {
+    outputs.push_back(asyncRun(executable, input));
+  }
+  return await(outputs).then([](const vector<Future<Try<string>>>& outputs) {
+    vector<Try<string>> results;
+    results.reserve(outputs.size());
+    for (const Future<Try<string>>& output : outputs) {
+      if (output.isReady()) {
+        results.push_back(output.get());
+      } else {
+        results.push_back(Error("Command execution error"));
+      }
+    }
+    return results;
+  });
+}
+
+Try<vector<string>> CommandRunner::runAll(const Command& command,
+                                          const std::string& input) {
+  return awaitAll(asyncRunAll(command, input));
+}
+
+Try<vector<string>> CommandRunner::awaitAll(
+    const Future<vector<Try<string>>>& outputs) {
+  if (!outputs.await()) {
+    return Error("Command timed out");
+  }
+  if (!outputs.isReady()) {
+    return Error("Command execution error");
+  }
+
+  vector<string> results;
+  results.reserve(outputs->size());
+  for (const Try<string>& output : outputs.get()) {
+    if (output.isError()) return Error(output.error());
+    results.push_back(output.get());
+  }
+  return results;
+}
 }  // namespace mesos
 }  // namespace criteo
@@ -1,25 +1,33 @@
 #ifndef __COMMAND_RUNNER_HPP__
 #define __COMMAND_RUNNER_HPP__
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <process/future.hpp>
 #include <stout/try.hpp>
 
 #include "Command.hpp"
 #include "Logger.hpp"
+#include "RunnerOptions.hpp"
 
 namespace criteo {
 namespace mesos {
 
+// How a command terminated, defined by the runner.
+struct CommandOutcome;
+
 class CommandRunner {
  public:
   /**
    * @brief CommandRunner
    * @param debug true to publish debug level information, false otherwise.
    * @param loggingMetadata The metadata like task id prepended to logs.
+   * @param options The settings of the module running the commands.
    */
-  CommandRunner(bool debug, const logging::Metadata& loggingMetadata);
+  CommandRunner(bool debug, const logging::Metadata& loggingMetadata,
+                const RunnerOptions& options = RunnerOptions());
 
   /**
    * Run command receiving two paths to temporary files as input. The first is
@@ -27,9 +35,8 @@ class CommandRunner {
    * second one is the file where the command can log its outputs.
    *
    * The command must exit in less than the timeout given as parameter,
-   * otherwise the process receives a SIGTERM and then a SIGKILL if it still has
-   * not exited. SIGKILL is sent one second after the end of the timeout if the
-   * process is still running after SIGTERM.
+   * otherwise its process group receives a SIGTERM and then a SIGKILL if it
+   * still has not exited one second later.
    *
    * @param command The command to run.
    * @param serializedInput The serialized input passed to the command through
@@ -45,12 +52,15 @@ class CommandRunner {
                        const std::string& serializedInput);
 
   /**
-   * Run a command synchonously without timeout and without using libprocess.
-   * Using libprocess in the watch loop can generate some deadlocks in
-   * libprocess.
+   * Run a command synchonously on the calling thread without using
+   * libprocess. Using libprocess in the watch checks can generate some
+   * deadlocks in libprocess.
+   *
+   * The command must exit in less than its timeout, otherwise its process
+   * group receives a SIGTERM and then a SIGKILL one second later if it still
+   * has not exited.
    */
-  Try<std::string> runWithoutTimeout(const Command& command,
-                                     const std::string& input);
+  Try<std::string> runSync(const Command& command, const std::string& input);
 
   /**
    * Run a command asynchonously.
@@ -58,9 +68,8 @@ class CommandRunner {
    * while waiting for the command's output.
    *
    * The command must exit in less than the timeout given as parameter,
-   * otherwise the process receives a SIGTERM and then a SIGKILL if it still has
-   * not exited. SIGKILL is sent one second after the end of the timeout if the
-   * process is still running after SIGTERM.
+   * otherwise its process group receives a SIGTERM and then a SIGKILL if it
+   * still has not exited one second later.
    *
    * @param command The command to run.
    * @param serializedInput The serialized input passed to the command through
@@ -71,9 +80,94 @@ class CommandRunner {
   process::Future<Try<std::string>> asyncRun(
       const Command& command, const std::string& serializedInput);
 
+  /**
+   * Run all the executables of a command concurrently, each one under the
+   * timeout of the command.
+   *
+   * @return Future on the outputs of the executables, in their configured
+   *   order.
+   */
+  process::Future<std::vector<Try<std::string>>> asyncRunAll(
+      const Command& command, const std::string& serializedInput);
+
+  /**
+   * Run all the executables of a command concurrently and wait for them.
+   *
+   * @return The outputs of the executables in their configured order, or the
+   *   error of the first one which failed.
+   */
+  Try<std::vector<std::string>> runAll(const Command& command,
+                                       const std::string& serializedInput);
+
+  /**
+   * Wait for the outputs of several executables.
+   *
+   * @return The outputs of the executables, or the error of the first one
+   *   which failed.
+   */
+  static Try<std::vector<std::string>> awaitAll(
+      const process::Future<std::vector<Try<std::string>>>& outputs);
+
  private:
+  /**
+   * @return true if debug mode is enabled and the current call is sampled.
+   */
+  bool sampleDebug() const;
+
+  /**
+   * @return The identifier of the invocation of a command in the traces, the
+   *   one of the event if the caller set it in the metadata.
+   */
+  uint64_t invocationId() const;
+
+  /**
+   * @return The file to execute for a command, its in-memory copy if it has
+   *   been preloaded.
+   */
+  const std::string& program(const Command& command) const;
+
+  /**
+   * @return The circuit breaker of a command, nullptr if the module has none.
+   */
+  std::shared_ptr<CircuitBreaker> circuitBreaker(const Command& command) const;
+
+  /**
+   * @return The priority of the commands of the current event in the
+   *   execution queue.
+   */
+  ExecutionQueue::Priority priority() const;
+
+  /**
+   * Run a command if its circuit breaker, if any, allows it and record its
+   * outcome in the breaker. Called once the call got its slot in the
+   * execution queue, so that a trial call does not hold its token while
+   * waiting.
+   */
+  process::Future<Try<std::string>> asyncRunWithBreaker(
+      const Command& command, const std::string& input);
+
+  /**
+   * Run a command.
+   *
+   * @param outcome Filled with how the command terminated if not null, once
+   *   the output is ready.
+   */
+  process::Future<Try<std::string>> asyncRunCommand(
+      const Command& command, const std::string& input,
+      const std::shared_ptr<CommandOutcome>& outcome);
+
+  /**
+   * Run a command on the calling thread.
+   *
+   * @param outcome Filled with how the command terminated.
+   */
+  Try<std::string> runSyncCommand(const Command& command,
+                                  const std::string& input,
+                                  CommandOutcome& outcome);
+
   bool m_debug;
   logging::Metadata m_loggingMetadata;
+  RunnerOptions m_options;
 };
 
 }  // namespace mesos
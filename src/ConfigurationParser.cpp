@@ -1,11 +1,23 @@
 #include "ConfigurationParser.hpp"
+#include "AuditLog.hpp"
+#include "CircuitBreaker.hpp"
+#include "CommandHook.hpp"
+#include "IsolatorOptions.hpp"
+#include "RunningContext.hpp"
+#include "TemporaryFilePool.hpp"
+#include "Tracer.hpp"
 
 #include <map>
+#include <stdexcept>
 #include <stout/foreach.hpp>
+#include <stout/strings.hpp>
 namespace criteo {
 namespace mesos {
 
 using std::map;
+using std::set;
+using std::stod;
+using std::stof;
 using std::stoul;
 using std::string;
 
@@ -15,6 +27,9 @@ const string SLAVE_RUN_TASK_LABEL_DECORATOR_KEY =
 const string SLAVE_EXECUTOR_ENVIRONMENT_DECORATOR_KEY =
     "hook_slave_executor_environment_decorator";
 const string SLAVE_REMOVE_EXECUTOR_KEY = "hook_slave_remove_executor_hook";
+const string SLAVE_LAUNCH_DECORATOR_KEY = "hook_slave_launch_decorator";
+const string SLAVE_LAUNCH_DECORATION_TTL_KEY =
+    "hook_slave_launch_decoration_ttl";
 
 // Isolator commands.
 const string PREPARE_KEY = "isolator_prepare";
@@ -22,9 +37,47 @@ const string ISOLATE_KEY = "isolator_isolate";
 const string WATCH_KEY = "isolator_watch";
 const string CLEANUP_KEY = "isolator_cleanup";
 const string USAGE_KEY = "isolator_usage";
+const string WATCH_WORKERS_KEY = "isolator_watch_workers";
+const string USAGE_REFRESH_INTERVAL_KEY = "isolator_usage_refresh_interval";
+const string USAGE_REFRESH_CONCURRENCY_KEY =
+    "isolator_usage_refresh_concurrency";
+const string USAGE_CHANNEL_KEY = "isolator_usage_channel";
+const string USAGE_CHANNEL_MAX_AGE_KEY = "isolator_usage_channel_max_age";
+const string USAGE_SOURCE_DIR_KEY = "isolator_usage_source_dir";
+const string COMMAND_SETS_KEY = "command_sets";
+const string STATE_DIR_KEY = "isolator_state_dir";
+const string RECOVERY_WORKERS_KEY = "isolator_recovery_workers";
+const string LAZY_RECOVERY_KEY = "isolator_lazy_recovery";
+const string ORPHAN_CLEANUP_CONCURRENCY_KEY =
+    "isolator_orphan_cleanup_concurrency";
 
 // Additional parameters.
 const string DEBUG_KEY = "debug";  // enable debug mode.
+const string DEBUG_SAMPLE_RATES_KEY = "debug_sample_rates";
+const string DEBUG_CONTAINER_FILTER_KEY = "debug_container_filter";
+const string DEBUG_FRAMEWORK_FILTER_KEY = "debug_framework_filter";
+const string TRACE_BUFFER_SIZE_KEY = "trace_buffer_size";
+const string AUDIT_FILE_KEY = "audit_file";
+const string AUDIT_CAPACITY_KEY = "audit_capacity";
+const string TEMP_DIR_KEY = "temp_dir";
+const string TEMP_FILE_POOL_SIZE_KEY = "temp_file_pool_size";
+const string PRELOAD_EXECUTABLES_KEY = "preload_executables";
+const string WARM_UP_KEY = "warm_up";
+const string MAX_OUTPUT_SIZE_KEY = "max_output_size";
+const string MAX_CONCURRENT_COMMANDS_KEY = "max_concurrent_commands";
+const string COMMAND_CGROUP_KEY = "command_cgroup";
+const string COMMAND_CPUSET_KEY = "command_cpuset";
+const string COMMAND_CPU_WEIGHT_KEY = "command_cpu_weight";
+const string COMMAND_CPU_QUOTA_KEY = "command_cpu_quota";
+const string COMMAND_NICE_KEY = "command_nice";
+const string COMMAND_IONICE_KEY = "command_ionice";
+const string COMMAND_FILE_SIZE_LIMIT_KEY = "command_file_size_limit";
+const string CIRCUIT_BREAKER_KEY = "circuit_breaker";
+const string CIRCUIT_BREAKER_WINDOW_KEY = "circuit_breaker_window";
+const string CIRCUIT_BREAKER_FAILURE_RATE_KEY = "circuit_breaker_failure_rate";
+const string CIRCUIT_BREAKER_SLOW_CALL_RATE_KEY =
+    "circuit_breaker_slow_call_rate";
+const string CIRCUIT_BREAKER_COOLDOWN_KEY = "circuit_breaker_cooldown";
 
 const string MODULE_NAME_KEY = "module_name";
 
@@ -76,9 +129,66 @@ Option<RecurrentCommand> extractRecurrentCommand(
     command.setFrequence(frequence);
   }
 
+  string minFrequenceStr = getOrEmpty(kv, commandKey + "_min_frequence");
+  if (!minFrequenceStr.empty()) command.setMinFrequence(stof(minFrequenceStr));
+  string maxFrequenceStr = getOrEmpty(kv, commandKey + "_max_frequence");
+  if (!maxFrequenceStr.empty()) command.setMaxFrequence(stof(maxFrequenceStr));
+
+  if (command.minFrequence() > command.frequence() ||
+      command.frequence() > command.maxFrequence()) {
+    throw std::invalid_argument(
+        commandKey + "_frequence must be between " + commandKey +
+        "_min_frequence and " + commandKey + "_max_frequence");
+  }
+
   return Option<RecurrentCommand>(command);
 }
 
+// Parse the commands of a named command set, whose keys are the ones of the
+// isolator commands prefixed by "<name>.".
+CommandSet extractCommandSet(const map<string, string>& kv,
+                             const string& name) {
+  const string prefix = name + ".";
+  map<string, string> setKv;
+  for (const auto& entry : kv) {
+    if (strings::startsWith(entry.first, prefix)) {
+      setKv[entry.first.substr(prefix.size())] = entry.second;
+    }
+  }
+
+  CommandSet commandSet;
+  commandSet.name = name;
+  commandSet.prepareCommand = extractCommand(setKv, PREPARE_KEY);
+  commandSet.isolateCommand = extractCommand(setKv, ISOLATE_KEY);
+  commandSet.watchCommand = extractRecurrentCommand(setKv, WATCH_KEY);
+  commandSet.cleanupCommand = extractCommand(setKv, CLEANUP_KEY);
+  commandSet.usageCommand = extractCommand(setKv, USAGE_KEY);
+  return commandSet;
+}
+
+// Parse a list like "usage:0.01,watch:0.1,*:1".
+map<string, double> extractRates(const map<string, string>& kv,
+                                 const std::string& key) {
+  map<string, double> rates;
+  foreach (const string& token, strings::tokenize(getOrEmpty(kv, key), ",")) {
+    std::vector<string> rate = strings::split(strings::trim(token), ":");
+    if (rate.size() != 2) {
+      throw std::invalid_argument(key + " expects method:rate pairs, got \"" +
+                                  token + "\"");
+    }
+    rates[rate[0]] = stod(rate[1]);
+  }
+  return rates;
+}
+
+set<string> extractSet(const map<string, string>& kv, const std::string& key) {
+  set<string> values;
+  foreach (const string& token, strings::tokenize(getOrEmpty(kv, key), ",")) {
+    values.insert(strings::trim(token));
+  }
+  return values;
+}
+
 Configuration ConfigurationParser::parse(
     const ::mesos::Parameters& parameters) {
   map<string, string> p = toMap(parameters);
@@ -90,14 +200,153 @@ Configuration ConfigurationParser::parse(
       extractCommand(p, SLAVE_REMOVE_EXECUTOR_KEY);
   configuration.slaveRunTaskLabelDecoratorCommand =
       extractCommand(p, SLAVE_RUN_TASK_LABEL_DECORATOR_KEY);
+  configuration.slaveLaunchDecoratorCommand =
+      extractCommand(p, SLAVE_LAUNCH_DECORATOR_KEY);
+  string launchDecorationTtlStr =
+      getOrEmpty(p, SLAVE_LAUNCH_DECORATION_TTL_KEY);
+  configuration.launchDecorationTtl =
+      launchDecorationTtlStr.empty() ? DEFAULT_LAUNCH_DECORATION_TTL.secs()
+                                     : stof(launchDecorationTtlStr);
 
   configuration.prepareCommand = extractCommand(p, PREPARE_KEY);
   configuration.isolateCommand = extractCommand(p, ISOLATE_KEY);
   configuration.watchCommand = extractRecurrentCommand(p, WATCH_KEY);
   configuration.cleanupCommand = extractCommand(p, CLEANUP_KEY);
   configuration.usageCommand = extractCommand(p, USAGE_KEY);
+  set<string> commandSetNames;
+  foreach (const string& token,
+           strings::tokenize(getOrEmpty(p, COMMAND_SETS_KEY), ",")) {
+    string name = strings::trim(token);
+    if (!commandSetNames.insert(name).second) {
+      throw std::invalid_argument(COMMAND_SETS_KEY +
+                                  " lists the command set \"" + name +
+                                  "\" twice");
+    }
+    configuration.commandSets.push_back(extractCommandSet(p, name));
+  }
 
   configuration.isDebugSet = getOrEmpty(p, DEBUG_KEY) == "true";
+  configuration.debugSampleRates = extractRates(p, DEBUG_SAMPLE_RATES_KEY);
+  string debugContainerFilter = getOrEmpty(p, DEBUG_CONTAINER_FILTER_KEY);
+  if (!debugContainerFilter.empty()) {
+    configuration.debugContainerFilter = debugContainerFilter;
+  }
+  configuration.debugFrameworkFilter =
+      extractSet(p, DEBUG_FRAMEWORK_FILTER_KEY);
+
+  string traceBufferSizeStr = getOrEmpty(p, TRACE_BUFFER_SIZE_KEY);
+  configuration.traceBufferSize = traceBufferSizeStr.empty()
+                                      ? tracing::DEFAULT_TRACE_BUFFER_SIZE
+                                      : stoul(traceBufferSizeStr);
+
+  string auditFile = getOrEmpty(p, AUDIT_FILE_KEY);
+  if (!auditFile.empty()) configuration.auditFile = auditFile;
+  string auditCapacityStr = getOrEmpty(p, AUDIT_CAPACITY_KEY);
+  configuration.auditCapacity = auditCapacityStr.empty()
+                                    ? audit::DEFAULT_AUDIT_CAPACITY
+                                    : std::stoull(auditCapacityStr);
+
+  configuration.tempDir = getOrEmpty(p, TEMP_DIR_KEY);
+  if (configuration.tempDir.empty()) configuration.tempDir = DEFAULT_TEMP_DIR;
+  string tempFilePoolSizeStr = getOrEmpty(p, TEMP_FILE_POOL_SIZE_KEY);
+  configuration.tempFilePoolSize = tempFilePoolSizeStr.empty()
+                                       ? DEFAULT_TEMP_FILE_POOL_SIZE
+                                       : stoul(tempFilePoolSizeStr);
+
+  configuration.preloadExecutables =
+      getOrEmpty(p, PRELOAD_EXECUTABLES_KEY) == "true";
+  configuration.warmUp = getOrEmpty(p, WARM_UP_KEY) == "true";
+
+  string maxOutputSizeStr = getOrEmpty(p, MAX_OUTPUT_SIZE_KEY);
+  configuration.maxOutputSize = maxOutputSizeStr.empty()
+                                    ? DEFAULT_MAX_OUTPUT_SIZE
+                                    : stoul(maxOutputSizeStr);
+
+  string maxConcurrentCommandsStr = getOrEmpty(p, MAX_CONCURRENT_COMMANDS_KEY);
+  configuration.maxConcurrentCommands =
+      maxConcurrentCommandsStr.empty() ? 0 : stoul(maxConcurrentCommandsStr);
+
+  string commandCgroup = getOrEmpty(p, COMMAND_CGROUP_KEY);
+  if (!commandCgroup.empty()) configuration.commandCgroup = commandCgroup;
+  string commandCpuset = getOrEmpty(p, COMMAND_CPUSET_KEY);
+  if (!commandCpuset.empty()) configuration.commandCpuset = commandCpuset;
+  string commandCpuWeightStr = getOrEmpty(p, COMMAND_CPU_WEIGHT_KEY);
+  if (!commandCpuWeightStr.empty()) {
+    configuration.commandCpuWeight = stoul(commandCpuWeightStr);
+  }
+  string commandCpuQuotaStr = getOrEmpty(p, COMMAND_CPU_QUOTA_KEY);
+  if (!commandCpuQuotaStr.empty()) {
+    configuration.commandCpuQuota = stof(commandCpuQuotaStr);
+  }
+  string commandNiceStr = getOrEmpty(p, COMMAND_NICE_KEY);
+  if (!commandNiceStr.empty()) configuration.commandNice = stoi(commandNiceStr);
+  string commandIonice = getOrEmpty(p, COMMAND_IONICE_KEY);
+  if (!commandIonice.empty()) configuration.commandIonice = commandIonice;
+  string commandFileSizeLimitStr = getOrEmpty(p, COMMAND_FILE_SIZE_LIMIT_KEY);
+  if (!commandFileSizeLimitStr.empty()) {
+    configuration.commandFileSizeLimit = stoul(commandFileSizeLimitStr);
+  }
+
+  configuration.circuitBreaker = getOrEmpty(p, CIRCUIT_BREAKER_KEY) == "true";
+  string circuitBreakerWindowStr = getOrEmpty(p, CIRCUIT_BREAKER_WINDOW_KEY);
+  configuration.circuitBreakerWindow = circuitBreakerWindowStr.empty()
+                                           ? DEFAULT_CIRCUIT_BREAKER_WINDOW
+                                           : stoul(circuitBreakerWindowStr);
+  string circuitBreakerFailureRateStr =
+      getOrEmpty(p, CIRCUIT_BREAKER_FAILURE_RATE_KEY);
+  configuration.circuitBreakerFailureRate =
+      circuitBreakerFailureRateStr.empty()
+          ? DEFAULT_CIRCUIT_BREAKER_FAILURE_RATE
+          : stod(circuitBreakerFailureRateStr);
+  string circuitBreakerSlowCallRateStr =
+      getOrEmpty(p, CIRCUIT_BREAKER_SLOW_CALL_RATE_KEY);
+  configuration.circuitBreakerSlowCallRate =
+      circuitBreakerSlowCallRateStr.empty()
+          ? DEFAULT_CIRCUIT_BREAKER_SLOW_CALL_RATE
+          : stod(circuitBreakerSlowCallRateStr);
+  string circuitBreakerCooldownStr =
+      getOrEmpty(p, CIRCUIT_BREAKER_COOLDOWN_KEY);
+  configuration.circuitBreakerCooldown =
+      circuitBreakerCooldownStr.empty()
+          ? DEFAULT_CIRCUIT_BREAKER_COOLDOWN.secs()
+          : stof(circuitBreakerCooldownStr);
+
+  configuration.stateDir = getOrEmpty(p, STATE_DIR_KEY);
+  if (configuration.stateDir.empty()) {
+    configuration.stateDir = DEFAULT_ISOLATOR_STATE_DIR;
+  }
+  string recoveryWorkersStr = getOrEmpty(p, RECOVERY_WORKERS_KEY);
+  configuration.recoveryWorkers = recoveryWorkersStr.empty()
+                                      ? DEFAULT_RECOVERY_WORKERS
+                                      : stoul(recoveryWorkersStr);
+  configuration.lazyRecovery = getOrEmpty(p, LAZY_RECOVERY_KEY) == "true";
+  string orphanCleanupConcurrencyStr =
+      getOrEmpty(p, ORPHAN_CLEANUP_CONCURRENCY_KEY);
+  configuration.orphanCleanupConcurrency =
+      orphanCleanupConcurrencyStr.empty() ? DEFAULT_ORPHAN_CLEANUP_CONCURRENCY
+                                          : stoul(orphanCleanupConcurrencyStr);
+
+  string watchWorkersStr = getOrEmpty(p, WATCH_WORKERS_KEY);
+  configuration.watchWorkers =
+      watchWorkersStr.empty() ? DEFAULT_WATCH_WORKERS : stoul(watchWorkersStr);
+
+  string usageRefreshIntervalStr = getOrEmpty(p, USAGE_REFRESH_INTERVAL_KEY);
+  if (!usageRefreshIntervalStr.empty()) {
+    configuration.usageRefreshInterval = stof(usageRefreshIntervalStr);
+  }
+  string usageRefreshConcurrencyStr =
+      getOrEmpty(p, USAGE_REFRESH_CONCURRENCY_KEY);
+  configuration.usageRefreshConcurrency =
+      usageRefreshConcurrencyStr.empty() ? DEFAULT_USAGE_REFRESH_CONCURRENCY
+                                         : stoul(usageRefreshConcurrencyStr);
+  string usageChannel = getOrEmpty(p, USAGE_CHANNEL_KEY);
+  if (!usageChannel.empty()) configuration.usageChannel = usageChannel;
+  string usageChannelMaxAgeStr = getOrEmpty(p, USAGE_CHANNEL_MAX_AGE_KEY);
+  if (!usageChannelMaxAgeStr.empty()) {
+    configuration.usageChannelMaxAge = stof(usageChannelMaxAgeStr);
+  }
+  string usageSourceDir = getOrEmpty(p, USAGE_SOURCE_DIR_KEY);
+  if (!usageSourceDir.empty()) configuration.usageSourceDir = usageSourceDir;
 
   configuration.name = getOrEmpty(p, MODULE_NAME_KEY);
   if (configuration.name.empty())
@@ -1,6 +1,11 @@
 #ifndef CONFIGURATION_PARSER_HPP
 #define CONFIGURATION_PARSER_HPP
 
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
 #include <mesos/mesos.pb.h>
 #include <stout/option.hpp>
 
@@ -20,13 +25,105 @@ struct Configuration {
   Option<RecurrentCommand> watchCommand;
   Option<Command> cleanupCommand;
   Option<Command> usageCommand;
+  // additional command sets of the isolator, configured with the same keys
+  // as above prefixed by "<set name>.".
+  std::vector<CommandSet> commandSets;
 
   Option<Command> slaveRunTaskLabelDecoratorCommand;
   Option<Command> slaveExecutorEnvironmentDecoratorCommand;
   Option<Command> slaveRemoveExecutorHookCommand;
+  // command computing both the labels and the environment of an executor,
+  // replacing the two decorator commands above.
+  Option<Command> slaveLaunchDecoratorCommand;
+  // seconds during which the environment computed by the launch decorator is
+  // kept for the environment hook.
+  float launchDecorationTtl;
 
   // this flag allows the user to enable debug mode.
   bool isDebugSet;
+  // sampling rate of the debug logs per method, "*" for the other methods.
+  std::map<std::string, double> debugSampleRates;
+  // regex the task or container id must match to be logged in debug mode.
+  Option<std::string> debugContainerFilter;
+  // framework ids logged in debug mode, all of them if empty.
+  std::set<std::string> debugFrameworkFilter;
+
+  // number of spans kept in memory for the trace endpoint, 0 disables it.
+  size_t traceBufferSize;
+
+  // path of the ring file recording every command invocation, if any.
+  Option<std::string> auditFile;
+  // number of records kept in the audit ring file.
+  uint64_t auditCapacity;
+
+  // directory holding the per-module directories of the temporary files.
+  std::string tempDir;
+  // number of idle temporary file triplets kept for reuse.
+  size_t tempFilePoolSize;
+
+  // whether the executables are copied in memory when the module is created
+  // and executed from there.
+  bool preloadExecutables;
+  // whether the command backends are started and the executables paged in
+  // when the module is created.
+  bool warmUp;
+
+  // size in bytes above which the output of a command is rejected.
+  size_t maxOutputSize;
+  // number of commands of the module running at once, 0 for no limit.
+  size_t maxConcurrentCommands;
+
+  // cgroup the commands are spawned into.
+  Option<std::string> commandCgroup;
+  // CPUs the commands run on.
+  Option<std::string> commandCpuset;
+  // CPU weight of the cgroup of the commands.
+  Option<size_t> commandCpuWeight;
+  // number of CPUs the cgroup of the commands can use.
+  Option<float> commandCpuQuota;
+  // nice value of the commands.
+  Option<int> commandNice;
+  // I/O scheduling class and level of the commands.
+  Option<std::string> commandIonice;
+  // size in bytes of the largest file the commands can write.
+  Option<size_t> commandFileSizeLimit;
+
+  // whether the commands which keep failing or are too slow are not run for
+  // a while.
+  bool circuitBreaker;
+  // number of recent calls of a command the failure rates are computed on.
+  size_t circuitBreakerWindow;
+  // rate of failed calls stopping a command.
+  double circuitBreakerFailureRate;
+  // rate of calls lasting more than half their timeout stopping a command.
+  double circuitBreakerSlowCallRate;
+  // seconds during which a stopped command is not run.
+  float circuitBreakerCooldown;
+
+  // directory where the isolator saves the context of the containers.
+  std::string stateDir;
+  // number of threads restoring the container contexts at recovery.
+  size_t recoveryWorkers;
+  // whether recovery defers parsing the container contexts to their first use.
+  bool lazyRecovery;
+  // number of cleanup commands run at once for the orphan containers.
+  size_t orphanCleanupConcurrency;
+
+  // number of threads running the watch checks of the isolator.
+  size_t watchWorkers;
+
+  // interval in seconds of the background refresh of the usage snapshots, if
+  // usage() must not wait for the usage command.
+  Option<float> usageRefreshInterval;
+  // number of usage commands run at once by the background refresher.
+  size_t usageRefreshConcurrency;
+  // shared-memory channel where an external collector publishes the container
+  // statistics.
+  Option<std::string> usageChannel;
+  // age in seconds after which the statistics of the channel are ignored.
+  Option<float> usageChannelMaxAge;
+  // directory where an external collector publishes the container statistics.
+  Option<std::string> usageSourceDir;
 };
 
 /**
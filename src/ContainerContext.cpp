@@ -0,0 +1,104 @@
+#include "ContainerContext.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include <stout/json.hpp>
+#include <stout/protobuf.hpp>
+#include <stout/stringify.hpp>
+
+namespace criteo {
+namespace mesos {
+
+using std::string;
+using ::mesos::slave::ContainerConfig;
+
+// Number of references kept before the expired ones are first swept.
+static const size_t MINIMUM_SWEEP_THRESHOLD = 1024;
+
+ContainerContext::Members ContainerContext::serialize(
+    const ContainerConfig& config) {
+  Members members;
+  members.frameworkId = config.executor_info().framework_id().value();
+
+  JSON::Object object = JSON::protobuf(config);
+  members.values.reserve(object.values.size());
+  for (const auto& member : object.values) {
+    members.values.push_back(stringify(JSON::String(member.first)) + ":" +
+                             stringify(member.second));
+  }
+  return members;
+}
+
+string ContainerContext::json() const {
+  size_t size = 2;
+  for (const auto& member : m_members) size += member->size() + 1;
+
+  string json;
+  json.reserve(size);
+  json += '{';
+  for (size_t i = 0; i < m_members.size(); ++i) {
+    if (i > 0) json += ',';
+    json += *m_members[i];
+  }
+  json += '}';
+  return json;
+}
+
+ContainerContextInterner::ContainerContextInterner()
+    : m_sweepThreshold(MINIMUM_SWEEP_THRESHOLD) {}
+
+std::shared_ptr<const ContainerContext> ContainerContextInterner::intern(
+    const ContainerConfig& config) {
+  return intern(ContainerContext::serialize(config));
+}
+
+std::shared_ptr<const ContainerContext> ContainerContextInterner::intern(
+    ContainerContext::Members&& members) {
+  auto context = std::make_shared<ContainerContext>();
+  context->m_frameworkId = internString(std::move(members.frameworkId));
+  context->m_members.reserve(members.values.size());
+  for (string& value : members.values) {
+    context->m_members.push_back(internString(std::move(value)));
+  }
+  return context;
+}
+
+size_t ContainerContextInterner::size() const {
+  size_t size = 0;
+  for (const auto& entry : m_strings) {
+    if (!entry.second.expired()) ++size;
+  }
+  return size;
+}
+
+std::shared_ptr<const string> ContainerContextInterner::internString(
+    string&& value) {
+  size_t hash = std::hash<string>()(value);
+  auto range = m_strings.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    std::shared_ptr<const string> interned = it->second.lock();
+    if (interned && *interned == value) return interned;
+  }
+
+  if (m_strings.size() >= m_sweepThreshold) sweep();
+  auto interned = std::make_shared<const string>(std::move(value));
+  m_strings.emplace(hash, interned);
+  return interned;
+}
+
+void ContainerContextInterner::sweep() {
+  for (auto it = m_strings.begin(); it != m_strings.end();) {
+    if (it->second.expired()) {
+      it = m_strings.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Sweeping again only once the table has doubled keeps it amortized.
+  m_sweepThreshold = std::max(MINIMUM_SWEEP_THRESHOLD, 2 * m_strings.size());
+}
+
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,85 @@
+#ifndef __CONTAINER_CONTEXT_HPP__
+#define __CONTAINER_CONTEXT_HPP__
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <mesos/slave/isolator.hpp>
+
+namespace criteo {
+namespace mesos {
+
+/**
+ * @brief The ContainerContext is the immutable configuration of a container as
+ * passed to the commands, i.e., the JSON members of its ContainerConfig. The
+ * members are interned by a ContainerContextInterner so that the ones repeated
+ * between containers, such as the executor of nested containers and task group
+ * siblings, are stored once.
+ */
+class ContainerContext {
+ public:
+  /**
+   * The serialized members of a config before they are interned. Serializing
+   * is the expensive part and can be done on any thread.
+   */
+  struct Members {
+    std::string frameworkId;
+    // Each member is `"name":value`, in the order of the keys.
+    std::vector<std::string> values;
+  };
+
+  static Members serialize(const ::mesos::slave::ContainerConfig& config);
+
+  /**
+   * @return The id of the framework of the container, empty if unknown.
+   */
+  inline const std::string& frameworkId() const { return *m_frameworkId; }
+
+  /**
+   * @return The JSON of the ContainerConfig of the container.
+   */
+  std::string json() const;
+
+ private:
+  friend class ContainerContextInterner;
+
+  std::shared_ptr<const std::string> m_frameworkId;
+  std::vector<std::shared_ptr<const std::string>> m_members;
+};
+
+/**
+ * @brief The ContainerContextInterner builds the contexts of the containers,
+ * sharing the identical members between them. It only keeps weak references
+ * to the members, they are freed with the last context using them. It is not
+ * thread-safe.
+ */
+class ContainerContextInterner {
+ public:
+  ContainerContextInterner();
+
+  std::shared_ptr<const ContainerContext> intern(
+      const ::mesos::slave::ContainerConfig& config);
+  std::shared_ptr<const ContainerContext> intern(
+      ContainerContext::Members&& members);
+
+  /**
+   * @return The number of distinct strings used by the live contexts.
+   */
+  size_t size() const;
+
+ private:
+  std::shared_ptr<const std::string> internString(std::string&& value);
+
+  // Drop the references to the strings no longer used by any context.
+  void sweep();
+
+  std::unordered_multimap<size_t, std::weak_ptr<const std::string>> m_strings;
+  size_t m_sweepThreshold;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __CONTAINER_CONTEXT_HPP__
@@ -0,0 +1,162 @@
+#include "DebugLog.hpp"
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include <glog/logging.h>
+
+namespace criteo {
+namespace mesos {
+namespace logging {
+
+using std::string;
+
+// Time the drainer sleeps when there is nothing to log.
+const std::chrono::milliseconds DEBUG_SINK_IDLE_PERIOD(10);
+
+static size_t roundUpToPowerOfTwo(size_t value) {
+  size_t power = 2;
+  while (power < value) power <<= 1;
+  return power;
+}
+
+AsyncLogSink::AsyncLogSink(size_t capacity)
+    : m_mask(roundUpToPowerOfTwo(capacity) - 1),
+      m_enqueuePosition(0),
+      m_dequeuePosition(0),
+      m_dropped(0) {
+  m_slots.reset(new Slot[m_mask + 1]);
+  for (size_t i = 0; i <= m_mask; ++i) {
+    m_slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+AsyncLogSink& AsyncLogSink::instance() {
+  static AsyncLogSink sink(DEFAULT_DEBUG_SINK_CAPACITY);
+  static std::once_flag started;
+  std::call_once(started, []() {
+    std::thread(&AsyncLogSink::drain, &sink).detach();
+  });
+  return sink;
+}
+
+// Bounded queue from Dmitry Vyukov: each slot carries a sequence number telling
+// producers and consumers whether it is free or filled for their position.
+bool AsyncLogSink::push(string&& message) {
+  size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = m_slots[position & m_mask];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    intptr_t diff =
+        static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+    if (diff == 0) {
+      if (m_enqueuePosition.compare_exchange_weak(position, position + 1,
+                                                  std::memory_order_relaxed)) {
+        slot.message = std::move(message);
+        slot.sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      ++m_dropped;
+      return false;
+    } else {
+      position = m_enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool AsyncLogSink::pop(string& message) {
+  size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = m_slots[position & m_mask];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    intptr_t diff =
+        static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+    if (diff == 0) {
+      if (m_dequeuePosition.compare_exchange_weak(position, position + 1,
+                                                  std::memory_order_relaxed)) {
+        message = std::move(slot.message);
+        slot.message.clear();
+        slot.sequence.store(position + m_mask + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      position = m_dequeuePosition.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void AsyncLogSink::drain() {
+  uint64_t reportedDrops = 0;
+  string message;
+  while (true) {
+    bool drained = false;
+    while (pop(message)) {
+      LOG(INFO) << message;
+      drained = true;
+    }
+
+    uint64_t drops = dropped();
+    if (drops != reportedDrops) {
+      LOG(WARNING) << "Debug log sink is full, dropped "
+                   << (drops - reportedDrops) << " messages";
+      reportedDrops = drops;
+    }
+
+    if (!drained) std::this_thread::sleep_for(DEBUG_SINK_IDLE_PERIOD);
+  }
+}
+
+DebugSampler::DebugSampler() : m_defaultRate(1.0) {}
+
+DebugSampler::DebugSampler(const std::map<string, double>& rates,
+                           const Option<string>& containerFilter,
+                           const std::set<string>& frameworkFilter)
+    : m_rates(rates), m_defaultRate(1.0), m_frameworkFilter(frameworkFilter) {
+  auto defaultRate = m_rates.find("*");
+  if (defaultRate != m_rates.end()) {
+    m_defaultRate = defaultRate->second;
+    m_rates.erase(defaultRate);
+  }
+  if (containerFilter.isSome()) {
+    m_containerFilter = std::regex(containerFilter.get());
+  }
+}
+
+bool DebugSampler::sample(const Metadata& metadata) const {
+  if (m_containerFilter.isSome() &&
+      !std::regex_search(metadata.taskId, m_containerFilter.get())) {
+    return false;
+  }
+
+  if (!m_frameworkFilter.empty() &&
+      m_frameworkFilter.count(metadata.frameworkId) == 0) {
+    return false;
+  }
+
+  double rate = m_defaultRate;
+  auto it = m_rates.find(metadata.method);
+  if (it != m_rates.end()) rate = it->second;
+
+  if (rate >= 1.0) return true;
+  if (rate <= 0.0) return false;
+
+  thread_local std::minstd_rand generator(std::random_device{}());
+  return std::uniform_real_distribution<double>(0.0, 1.0)(generator) < rate;
+}
+
+DebugMessage::DebugMessage(const Metadata& metadata) {
+  m_stream << "[TASK=" << metadata.taskId << ", METHOD=" << metadata.method
+           << "] ";
+}
+
+DebugMessage::~DebugMessage() { AsyncLogSink::instance().push(m_stream.str()); }
+
+}  // namespace logging
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,129 @@
+#ifndef __DEBUG_LOG_HPP__
+#define __DEBUG_LOG_HPP__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include <stout/option.hpp>
+
+#include "Logger.hpp"
+
+// Log a debug message through the asynchronous sink. The caller is expected to
+// have checked that debug mode is enabled and sampled for this call.
+#define TASK_DEBUG(metadata) \
+  ::criteo::mesos::logging::DebugMessage(metadata).stream()
+
+namespace criteo {
+namespace mesos {
+namespace logging {
+
+// Number of pending messages the sink can hold before dropping new ones.
+const size_t DEFAULT_DEBUG_SINK_CAPACITY = 8192;
+
+/**
+ * @brief The AsyncLogSink is a bounded lock-free queue of log messages drained
+ * to glog by a background thread, so that producing a debug message never
+ * blocks the caller on I/O. Messages are dropped when the queue is full.
+ */
+class AsyncLogSink {
+ public:
+  /**
+   * @param capacity The maximum number of pending messages, rounded up to a
+   *   power of two.
+   */
+  explicit AsyncLogSink(size_t capacity);
+
+  /**
+   * @return The sink shared by all modules, its drainer thread is started on
+   *   first use.
+   */
+  static AsyncLogSink& instance();
+
+  /**
+   * Queue a message without blocking.
+   * @return false if the queue is full and the message has been dropped.
+   */
+  bool push(std::string&& message);
+
+  /**
+   * Take the oldest pending message.
+   * @return false if the queue is empty.
+   */
+  bool pop(std::string& message);
+
+  inline uint64_t dropped() const { return m_dropped.load(); }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    std::string message;
+  };
+
+  void drain();
+
+  std::unique_ptr<Slot[]> m_slots;
+  size_t m_mask;
+  std::atomic<size_t> m_enqueuePosition;
+  std::atomic<size_t> m_dequeuePosition;
+  std::atomic<uint64_t> m_dropped;
+};
+
+/**
+ * @brief The DebugSampler decides which calls are logged when debug mode is
+ * enabled, based on a sampling rate per method and optional filters on the
+ * container and the framework.
+ */
+class DebugSampler {
+ public:
+  /**
+   * Sample every call.
+   */
+  DebugSampler();
+
+  /**
+   * @param rates The sampling rate between 0 and 1 of each method. The rate of
+   *   the "*" key applies to the methods not listed, it defaults to 1.
+   * @param containerFilter If set, only calls whose task or container id
+   *   matches this regular expression are logged.
+   * @param frameworkFilter If not empty, only calls of these framework ids are
+   *   logged.
+   */
+  DebugSampler(const std::map<std::string, double>& rates,
+               const Option<std::string>& containerFilter,
+               const std::set<std::string>& frameworkFilter);
+
+  bool sample(const Metadata& metadata) const;
+
+ private:
+  std::map<std::string, double> m_rates;
+  double m_defaultRate;
+  Option<std::regex> m_containerFilter;
+  std::set<std::string> m_frameworkFilter;
+};
+
+/**
+ * Accumulate a message and push it to the shared sink on destruction.
+ */
+class DebugMessage {
+ public:
+  explicit DebugMessage(const Metadata& metadata);
+  ~DebugMessage();
+
+  inline std::ostream& stream() { return m_stream; }
+
+ private:
+  std::ostringstream m_stream;
+};
+
+}  // namespace logging
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __DEBUG_LOG_HPP__
@@ -0,0 +1,181 @@
+#include "ExecutableCache.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef MFD_EXEC
+#define MFD_EXEC 0x0010U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#define F_SEAL_WRITE 0x0008
+#endif
+
+namespace criteo {
+namespace mesos {
+
+using std::string;
+
+/*
+ * Create a memory file which can be sealed and executed, or return -1 if the
+ * kernel does not support it.
+ */
+static int createMemoryFile(const string& name) {
+#ifdef SYS_memfd_create
+  // Recent kernels may refuse to execute memory files not created with
+  // MFD_EXEC, which older kernels do not know about.
+  const unsigned int flags = MFD_CLOEXEC | MFD_ALLOW_SEALING;
+  int fd = static_cast<int>(
+      syscall(SYS_memfd_create, name.c_str(), flags | MFD_EXEC));
+  if (fd == -1 && errno == EINVAL) {
+    fd = static_cast<int>(syscall(SYS_memfd_create, name.c_str(), flags));
+  }
+  return fd;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+static Try<Nothing> copy(int from, int to, size_t size) {
+  char buffer[65536];
+  size_t copied = 0;
+  while (copied < size) {
+    ssize_t length = ::read(from, buffer, sizeof(buffer));
+    if (length == -1 && errno == EINTR) continue;
+    if (length == -1) return ErrnoError("Failed to read");
+    if (length == 0) break;
+    ssize_t written = 0;
+    while (written < length) {
+      ssize_t result = ::write(to, buffer + written, length - written);
+      if (result == -1 && errno == EINTR) continue;
+      if (result == -1) return ErrnoError("Failed to write");
+      written += result;
+    }
+    copied += length;
+  }
+  return Nothing();
+}
+
+ExecutableCache::ExecutableCache() {}
+
+ExecutableCache::~ExecutableCache() {
+  for (int fd : m_fds) ::close(fd);
+}
+
+Try<string> ExecutableCache::resolve(const string& executable) {
+  string resolved = executable;
+  if (executable.find('/') == string::npos) {
+    Option<string> found;
+    for (const string& directory :
+         strings::tokenize(os::getenv("PATH").getOrElse(""), ":")) {
+      string candidate = path::join(directory, executable);
+      if (::access(candidate.c_str(), X_OK) == 0) {
+        found = candidate;
+        break;
+      }
+    }
+    if (found.isNone()) return Error("\"" + executable + "\" is not in PATH");
+    resolved = found.get();
+  }
+
+  struct stat status;
+  if (::stat(resolved.c_str(), &status) == -1) {
+    return ErrnoError("Cannot find \"" + resolved + "\"");
+  }
+  if (!S_ISREG(status.st_mode)) {
+    return Error("\"" + resolved + "\" is not a regular file");
+  }
+  if (::access(resolved.c_str(), X_OK) == -1) {
+    return Error("\"" + resolved + "\" is not executable");
+  }
+  return resolved;
+}
+
+void ExecutableCache::pageIn(const string& executable) {
+  Try<string> resolved = resolve(executable);
+  if (resolved.isError()) return;
+
+  int fd = ::open(resolved->c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) return;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+  ::close(fd);
+}
+
+Try<Nothing> ExecutableCache::preload(const string& executable) {
+  if (m_paths.count(executable) > 0) return Nothing();
+
+  Try<string> resolved = resolve(executable);
+  if (resolved.isError()) return Error(resolved.error());
+
+  int file = ::open(resolved->c_str(), O_RDONLY | O_CLOEXEC);
+  if (file == -1) {
+    return ErrnoError("Failed to open \"" + resolved.get() + "\"");
+  }
+
+  int fd = createMemoryFile(Path(resolved.get()).basename());
+  if (fd == -1) {
+    // Without memory files the opened file still survives being replaced by
+    // a rename, but not being rewritten in place.
+    fd = file;
+  } else {
+    struct stat status;
+    Try<Nothing> copied = Nothing();
+    if (::fstat(file, &status) == -1) {
+      copied = ErrnoError("Failed to stat");
+    } else {
+      copied = copy(file, fd, status.st_size);
+    }
+    ::close(file);
+    if (copied.isError()) {
+      ::close(fd);
+      return Error("Failed to copy \"" + resolved.get() +
+                   "\": " + copied.error());
+    }
+    if (::fchmod(fd, 0555) == -1) {
+      ErrnoError error("Failed to make the copy of \"" + resolved.get() +
+                       "\" executable");
+      ::close(fd);
+      return error;
+    }
+    // The copy is still usable without the seals, only less protected.
+    if (::fcntl(fd, F_ADD_SEALS,
+                F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) ==
+        -1) {
+      LOG(WARNING) << "Failed to seal the copy of \"" << resolved.get()
+                   << "\": " << os::strerror(errno);
+    }
+  }
+
+  m_fds.push_back(fd);
+  m_paths[executable] =
+      "/proc/" + stringify(getpid()) + "/fd/" + stringify(fd);
+  return Nothing();
+}
+
+const string& ExecutableCache::path(const string& executable) const {
+  auto it = m_paths.find(executable);
+  return it != m_paths.end() ? it->second : executable;
+}
+
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,70 @@
+#ifndef __EXECUTABLE_CACHE_HPP__
+#define __EXECUTABLE_CACHE_HPP__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+namespace criteo {
+namespace mesos {
+
+/**
+ * @brief The ExecutableCache keeps a sealed in-memory copy of the executables
+ * of a module, loaded when the module is created. The copies are executed
+ * instead of the files on disk so that invocations neither resolve the path
+ * nor page the file in again, and are not affected by someone rewriting the
+ * file while it runs.
+ *
+ * The copies are executed through their /proc/<agent pid>/fd path, which
+ * works for scripts too since the interpreter can open it after the exec.
+ */
+class ExecutableCache {
+ public:
+  ExecutableCache();
+  ~ExecutableCache();
+
+  ExecutableCache(const ExecutableCache&) = delete;
+  ExecutableCache& operator=(const ExecutableCache&) = delete;
+
+  /**
+   * Check that an executable is a regular file the agent can execute.
+   *
+   * @param executable The path of the executable, looked up in PATH if it has
+   *   no slash.
+   * @return The path of the executable file.
+   */
+  static Try<std::string> resolve(const std::string& executable);
+
+  /**
+   * Ask the kernel to read an executable in the page cache ahead of its first
+   * invocation.
+   */
+  static void pageIn(const std::string& executable);
+
+  /**
+   * Copy an executable into a sealed memory file, or keep it open if memory
+   * files are not supported. The cache is not thread-safe while preloading,
+   * it must be done before the cache is shared with the runners.
+   */
+  Try<Nothing> preload(const std::string& executable);
+
+  /**
+   * @return The path to execute for an executable, the one of its in-memory
+   *   copy if it has been preloaded.
+   */
+  const std::string& path(const std::string& executable) const;
+
+  inline size_t size() const { return m_paths.size(); }
+
+ private:
+  std::map<std::string, std::string> m_paths;
+  std::vector<int> m_fds;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __EXECUTABLE_CACHE_HPP__
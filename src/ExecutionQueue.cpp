@@ -0,0 +1,153 @@
+#include "ExecutionQueue.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <unordered_map>
+
+namespace criteo {
+namespace mesos {
+
+using std::string;
+
+struct FrameworkWeights {
+  std::mutex mutex;
+  std::unordered_map<string, double> weights;
+};
+
+static FrameworkWeights& frameworkWeights() {
+  static FrameworkWeights* weights = new FrameworkWeights();
+  return *weights;
+}
+
+ExecutionQueue::ExecutionQueue(size_t maxConcurrentCommands)
+    : m_maxConcurrentCommands(std::max<size_t>(maxConcurrentCommands, 1)),
+      m_running(0) {}
+
+ExecutionQueue::Priority ExecutionQueue::priorityOf(const string& method) {
+  return method == "usage" || method == "watch" ? TELEMETRY : LIFECYCLE;
+}
+
+void ExecutionQueue::setFrameworkWeight(const string& frameworkId,
+                                        double weight) {
+  FrameworkWeights& weights = frameworkWeights();
+  std::lock_guard<std::mutex> lock(weights.mutex);
+  if (weight == 1) {
+    weights.weights.erase(frameworkId);
+  } else {
+    weights.weights[frameworkId] = weight;
+  }
+}
+
+double ExecutionQueue::frameworkWeight(const string& frameworkId) {
+  FrameworkWeights& weights = frameworkWeights();
+  std::lock_guard<std::mutex> lock(weights.mutex);
+  auto it = weights.weights.find(frameworkId);
+  return it == weights.weights.end() ? 1 : it->second;
+}
+
+void ExecutionQueue::submit(Priority priority, const string& frameworkId,
+                            const Grant& grant) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!hasFreeSlot()) {
+      PriorityClass& priorityClass = m_classes[priority];
+      auto inserted =
+          priorityClass.frameworks.emplace(frameworkId, Framework());
+      Framework& framework = inserted.first->second;
+      if (inserted.second) framework.virtualTime = priorityClass.virtualTime;
+      framework.waiting.push_back(grant);
+      ++priorityClass.waiting;
+      return;
+    }
+    ++m_running;
+  }
+  grant();
+}
+
+process::Future<Nothing> ExecutionQueue::acquire(Priority priority,
+                                                 const string& frameworkId) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (hasFreeSlot()) {
+      ++m_running;
+      return Nothing();
+    }
+  }
+
+  auto promise = std::make_shared<process::Promise<Nothing>>();
+  process::Future<Nothing> slot = promise->future();
+  submit(priority, frameworkId, [promise]() { promise->set(Nothing()); });
+  return slot;
+}
+
+void ExecutionQueue::acquireSync(Priority priority, const string& frameworkId) {
+  struct Waiter {
+    std::mutex mutex;
+    std::condition_variable granted;
+    bool isGranted = false;
+  };
+
+  auto waiter = std::make_shared<Waiter>();
+  submit(priority, frameworkId, [waiter]() {
+    std::lock_guard<std::mutex> lock(waiter->mutex);
+    waiter->isGranted = true;
+    waiter->granted.notify_one();
+  });
+
+  std::unique_lock<std::mutex> lock(waiter->mutex);
+  waiter->granted.wait(lock, [&waiter]() { return waiter->isGranted; });
+}
+
+void ExecutionQueue::release() {
+  Grant grant;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    grant = next();
+    if (!grant) --m_running;
+  }
+  // The slot goes straight to the next command.
+  if (grant) grant();
+}
+
+size_t ExecutionQueue::running() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_running;
+}
+
+size_t ExecutionQueue::waiting() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_classes[LIFECYCLE].waiting + m_classes[TELEMETRY].waiting;
+}
+
+bool ExecutionQueue::hasFreeSlot() const {
+  // The commands already waiting go first.
+  return m_running < m_maxConcurrentCommands &&
+         m_classes[LIFECYCLE].waiting == 0 && m_classes[TELEMETRY].waiting == 0;
+}
+
+ExecutionQueue::Grant ExecutionQueue::next() {
+  for (PriorityClass& priorityClass : m_classes) {
+    if (priorityClass.waiting == 0) continue;
+
+    // The framework which received the least service for its weight.
+    auto selected = priorityClass.frameworks.begin();
+    for (auto it = priorityClass.frameworks.begin();
+         it != priorityClass.frameworks.end(); ++it) {
+      if (it->second.virtualTime < selected->second.virtualTime) selected = it;
+    }
+
+    Framework& framework = selected->second;
+    Grant grant = std::move(framework.waiting.front());
+    framework.waiting.pop_front();
+    --priorityClass.waiting;
+    priorityClass.virtualTime = framework.virtualTime;
+    framework.virtualTime += 1 / frameworkWeight(selected->first);
+    if (framework.waiting.empty()) priorityClass.frameworks.erase(selected);
+    return grant;
+  }
+  return Grant();
+}
+
+}  // namespace mesos
+}  // namespace criteo
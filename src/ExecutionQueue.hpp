@@ -0,0 +1,117 @@
+#ifndef __EXECUTION_QUEUE_HPP__
+#define __EXECUTION_QUEUE_HPP__
+
+#include <stddef.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <process/future.hpp>
+
+#include <stout/nothing.hpp>
+
+namespace criteo {
+namespace mesos {
+
+// Label of the FrameworkInfo giving the share of the command slots of a
+// framework relative to the others, 1 if the label is missing.
+const std::string FRAMEWORK_WEIGHT_LABEL = "command_modules_weight";
+
+/**
+ * @brief The ExecutionQueue bounds the number of commands of a module running
+ * at once. The commands waiting for a slot are granted one by priority class
+ * first, so that the lifecycle events of the containers are not delayed by
+ * the telemetry ones, then fairly between the frameworks within a class,
+ * according to their weights. It is thread-safe.
+ */
+class ExecutionQueue {
+ public:
+  enum Priority { LIFECYCLE, TELEMETRY };
+
+  /**
+   * A grant is called once a slot is given to a command, possibly on the
+   * thread releasing the slot. It must not block.
+   */
+  typedef std::function<void()> Grant;
+
+  explicit ExecutionQueue(size_t maxConcurrentCommands);
+
+  /**
+   * @return The priority class of the commands of an event.
+   */
+  static Priority priorityOf(const std::string& method);
+
+  /**
+   * Set the weight of a framework in all the queues of the agent. The hook
+   * sees the FrameworkInfo of the tasks and records it for the isolator.
+   */
+  static void setFrameworkWeight(const std::string& frameworkId,
+                                 double weight);
+  static double frameworkWeight(const std::string& frameworkId);
+
+  /**
+   * Wait for a slot. The grant is called right away if one is free and no
+   * other command waits.
+   *
+   * @param frameworkId The framework of the command, empty if unknown.
+   */
+  void submit(Priority priority, const std::string& frameworkId,
+              const Grant& grant);
+
+  /**
+   * @return A future ready once the command got a slot.
+   */
+  process::Future<Nothing> acquire(Priority priority,
+                                   const std::string& frameworkId);
+
+  /**
+   * Block the calling thread until the command gets a slot.
+   */
+  void acquireSync(Priority priority, const std::string& frameworkId);
+
+  /**
+   * Give back the slot of a command which completed.
+   */
+  void release();
+
+  size_t running() const;
+  size_t waiting() const;
+
+ private:
+  struct Framework {
+    std::deque<Grant> waiting;
+    // The service received by the framework divided by its weight.
+    double virtualTime;
+  };
+
+  struct PriorityClass {
+    PriorityClass() : virtualTime(0), waiting(0) {}
+
+    // Only the frameworks with waiting commands.
+    std::map<std::string, Framework> frameworks;
+    // The virtual time of the last framework served, a framework starting to
+    // wait begins from there so that it cannot claim the time it was idle.
+    double virtualTime;
+    size_t waiting;
+  };
+
+  // Whether a command can run right away, called under the lock.
+  bool hasFreeSlot() const;
+
+  // Pop the next command to run, returns an empty grant if none waits.
+  Grant next();
+
+  const size_t m_maxConcurrentCommands;
+
+  mutable std::mutex m_mutex;
+  size_t m_running;
+  PriorityClass m_classes[2];
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __EXECUTION_QUEUE_HPP__
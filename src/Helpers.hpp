@@ -1,33 +1,107 @@
 #ifndef __HELPERS_HPP__
 #define __HELPERS_HPP__
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <stout/json.hpp>
 #include <stout/protobuf.hpp>
 #include <stout/result.hpp>
+#include <stout/try.hpp>
+
+#include "Logger.hpp"
+#include "Probes.hpp"
+#include "Tracer.hpp"
 
 namespace criteo {
 namespace mesos {
 
-template <class Proto>
-Result<Proto> jsonToProtobuf(const std::string& output) {
-  if (output.empty()) return Error("No content to parse");
-
-  auto outputJsonTry = JSON::parse(output);
-  if (outputJsonTry.isError()) {
-    return Error("Malformed JSON. " + outputJsonTry.error());
-  }
-
-  auto outputJson = outputJsonTry.get();
-  if (!outputJson.is<JSON::Object>()) {
+/**
+ * Parse the JSON output of a command, which must be an object.
+ *
+ * @param output The non-empty JSON output of the command.
+ * @param metadata The metadata of the call, the parsing is traced in the spans
+ * of its invocation.
+ */
+inline Try<JSON::Value> parseOutput(const std::string& output,
+                                    const logging::Metadata& metadata) {
+  tracing::ScopedSpan parseSpan("parse_json", metadata, metadata.invocation);
+  Try<JSON::Value> json = JSON::parse(output);
+  parseSpan.finish();
+  if (json.isError()) return Error("Malformed JSON. " + json.error());
+  if (!json->is<JSON::Object>()) {
     return Error("Malformed Protobuf. JSON object is expected.");
   }
+  return json;
+}
 
-  auto proto = ::protobuf::parse<Proto>(outputJson);
+/**
+ * Convert the parsed output of a command into a protobuf message.
+ *
+ * @param json The JSON object returned by parseOutput.
+ * @param metadata The metadata of the call, the conversion is traced in the
+ * spans of its invocation.
+ */
+template <class Proto>
+Result<Proto> toProtobuf(const JSON::Value& json,
+                         const logging::Metadata& metadata) {
+  tracing::ScopedSpan convertSpan("to_protobuf", metadata,
+                                  metadata.invocation);
+  Try<Proto> proto = ::protobuf::parse<Proto>(json);
+  convertSpan.finish();
   if (proto.isError()) {
     return Error("Error while converting JSON to protobuf. " + proto.error());
   }
+  return std::move(proto.get());
+}
+
+/**
+ * Parse the output of a command into a protobuf message.
+ *
+ * @param output The JSON output of the command.
+ * @param metadata The metadata of the call, the parsing is traced in the spans
+ * of its invocation.
+ */
+template <class Proto>
+Result<Proto> jsonToProtobuf(const std::string& output,
+                             const logging::Metadata& metadata) {
+  if (output.empty()) return Error("No content to parse");
+
+  PROBE_PARSE_START(metadata, output.size());
+  Try<JSON::Value> json = parseOutput(output, metadata);
+  if (json.isError()) {
+    PROBE_PARSE_END(metadata, false);
+    return Error(json.error());
+  }
+
+  Result<Proto> proto = toProtobuf<Proto>(json.get(), metadata);
+  PROBE_PARSE_END(metadata, proto.isSome());
   return proto;
 }
+
+/**
+ * Parse the outputs of the executables of a command and merge them into one
+ * protobuf message in the order of the executables, i.e., repeated fields are
+ * concatenated and the last executable setting a singular field wins.
+ *
+ * @param outputs The JSON outputs of the executables.
+ * @param metadata The metadata of the call, used to trace the parsing.
+ * @return None if there is no output.
+ */
+template <class Proto>
+Result<Proto> mergeOutputs(const std::vector<std::string>& outputs,
+                           const logging::Metadata& metadata) {
+  if (outputs.empty()) return None();
+
+  Result<Proto> merged = jsonToProtobuf<Proto>(outputs.front(), metadata);
+  for (size_t i = 1; i < outputs.size() && merged.isSome(); ++i) {
+    Result<Proto> proto = jsonToProtobuf<Proto>(outputs[i], metadata);
+    if (!proto.isSome()) return proto;
+    merged->MergeFrom(proto.get());
+  }
+  return merged;
+}
 }  // namespace mesos
 }  // namespace criteo
 
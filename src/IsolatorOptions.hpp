@@ -0,0 +1,80 @@
+#ifndef __ISOLATOR_OPTIONS_HPP__
+#define __ISOLATOR_OPTIONS_HPP__
+
+#include <stddef.h>
+
+#include <string>
+
+#include <stout/duration.hpp>
+#include <stout/option.hpp>
+
+#include "WatchScheduler.hpp"
+
+namespace criteo {
+namespace mesos {
+
+// Number of usage commands the background refresher runs at once if the user
+// does not override it in configuration.
+const size_t DEFAULT_USAGE_REFRESH_CONCURRENCY = 4;
+
+// Directory holding the per-module directories of the container contexts if
+// the user does not override it in configuration.
+const std::string DEFAULT_ISOLATOR_STATE_DIR =
+    "/var/run/mesos/isolators/command";
+
+// Number of threads restoring the container contexts at recovery if the user
+// does not override it in configuration.
+const size_t DEFAULT_RECOVERY_WORKERS = 8;
+
+// Number of cleanup commands run at once for the orphan containers if the
+// user does not override it in configuration.
+const size_t DEFAULT_ORPHAN_CLEANUP_CONCURRENCY = 4;
+
+/**
+ * @brief The IsolatorOptions struct gathers the settings of the isolator
+ * which are not specific to one of its commands.
+ */
+struct IsolatorOptions {
+  IsolatorOptions()
+      : stateDir(DEFAULT_ISOLATOR_STATE_DIR),
+        recoveryWorkers(DEFAULT_RECOVERY_WORKERS),
+        lazyRecovery(false),
+        orphanCleanupConcurrency(DEFAULT_ORPHAN_CLEANUP_CONCURRENCY),
+        watchWorkers(DEFAULT_WATCH_WORKERS),
+        usageRefreshConcurrency(DEFAULT_USAGE_REFRESH_CONCURRENCY) {}
+
+  // Directory where the context of every container is saved to survive agent
+  // restarts.
+  std::string stateDir;
+  // Number of threads restoring the container contexts at recovery.
+  size_t recoveryWorkers;
+  // If true, recovery only indexes the containers and the context of each
+  // one is restored on its first use.
+  bool lazyRecovery;
+  // Number of cleanup commands run at once for the orphan containers reported
+  // at recovery.
+  size_t orphanCleanupConcurrency;
+
+  // Number of threads running the watch checks of the containers.
+  size_t watchWorkers;
+
+  // If set, usage() serves the latest snapshot of the statistics of a
+  // container, refreshed in the background at this interval.
+  Option<Duration> usageRefreshInterval;
+  // Number of usage commands run at once by the background refresher.
+  size_t usageRefreshConcurrency;
+
+  // If set, usage() first reads the statistics published by an external
+  // collector in this shared-memory channel.
+  Option<std::string> usageChannel;
+  // If set, the statistics published in the channel longer ago are ignored.
+  Option<Duration> usageChannelMaxAge;
+  // If set, usage() then reads the statistics published by an external
+  // collector in this directory.
+  Option<std::string> usageSourceDir;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __ISOLATOR_OPTIONS_HPP__
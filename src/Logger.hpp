@@ -1,6 +1,7 @@
 #ifndef __LOGGING_LOGGER_HPP__
 #define __LOGGING_LOGGER_HPP__
 
+#include <cstdint>
 #include <string>
 
 #define TASK_LOG(severity, metadata)           \
@@ -13,6 +14,11 @@ namespace logging {
 struct Metadata {
   std::string taskId;
   std::string method;
+  // Empty when the framework of the call is unknown.
+  std::string frameworkId;
+  // Identifier grouping the trace spans of the event, including the parsing
+  // of the outputs. 0 lets the runner allocate one per command.
+  uint64_t invocation;
 };
 }  // namespace logging
 }  // namespace mesos
@@ -1,28 +1,223 @@
 #include "ModulesFactory.hpp"
 
+#include <glog/logging.h>
+
+#include <stout/path.hpp>
+
+#include "AuditLog.hpp"
 #include "CommandHook.hpp"
 #include "CommandIsolator.hpp"
 #include "ConfigurationParser.hpp"
+#include "ExecutableCache.hpp"
+#include "TemporaryFilePool.hpp"
+#include "Tracer.hpp"
+#include "UnixSocketBackend.hpp"
 
 namespace criteo {
 namespace mesos {
 
 using std::map;
 using std::string;
+using std::vector;
+
+// The tracer is shared by all the modules loaded in the agent, its buffer is
+// as large as the largest one configured by the modules.
+static void setupTracing(const Configuration& cfg) {
+  tracing::Tracer::instance().requestCapacity(cfg.traceBufferSize);
+  if (cfg.traceBufferSize > 0) tracing::serveChromeTrace();
+}
+
+/*
+ * Check the executables of the commands of a module, and preload or warm
+ * them up if configured. A broken executable is only reported so that the
+ * agent still starts, its invocations will fail as they would have without
+ * the check.
+ */
+static std::shared_ptr<const ExecutableCache> prepareExecutables(
+    const Configuration& cfg, const vector<Command>& commands) {
+  auto cache = std::make_shared<ExecutableCache>();
+  for (const Command& command : commands) {
+    for (const string& executable : command.executables()) {
+      if (UnixSocketBackend::handles(executable)) {
+        // Getting the backend starts its I/O thread.
+        if (cfg.warmUp) UnixSocketBackend::get(executable);
+        continue;
+      }
+
+      Try<string> resolved = ExecutableCache::resolve(executable);
+      if (resolved.isError()) {
+        LOG(ERROR) << "Invalid command in module " << cfg.name << ": "
+                   << resolved.error();
+        continue;
+      }
+      if (cfg.preloadExecutables) {
+        Try<Nothing> preloaded = cache->preload(executable);
+        if (preloaded.isError()) {
+          LOG(WARNING) << "Module " << cfg.name << " executes \"" << executable
+                       << "\" from disk: " << preloaded.error();
+        }
+      } else if (cfg.warmUp) {
+        ExecutableCache::pageIn(executable);
+      }
+    }
+  }
+  if (cache->size() == 0) return nullptr;
+  return cache;
+}
+
+/*
+ * Configure the cgroup and CPUs of the commands of a module. Commands which
+ * cannot be placed still run, the error is logged when the agent starts.
+ */
+static std::shared_ptr<const CommandPlacement> createPlacement(
+    const Configuration& cfg) {
+  if (cfg.commandCgroup.isNone() && cfg.commandCpuset.isNone() &&
+      cfg.commandNice.isNone() && cfg.commandIonice.isNone()) {
+    if (cfg.commandCpuWeight.isSome() || cfg.commandCpuQuota.isSome()) {
+      LOG(ERROR) << "Module " << cfg.name << " sets CPU limits without "
+                 << "command_cgroup, they are ignored";
+    }
+    return nullptr;
+  }
+
+  PlacementOptions options;
+  options.cgroup = cfg.commandCgroup;
+  options.cpuset = cfg.commandCpuset;
+  if (cfg.commandCpuWeight.isSome()) {
+    options.cpuWeight = cfg.commandCpuWeight.get();
+  }
+  if (cfg.commandCpuQuota.isSome()) {
+    options.cpuQuota = cfg.commandCpuQuota.get();
+  }
+  options.nice = cfg.commandNice;
+  options.ionice = cfg.commandIonice;
+
+  Try<std::shared_ptr<CommandPlacement>> placement =
+      CommandPlacement::create(options);
+  if (placement.isError()) {
+    LOG(ERROR) << "Module " << cfg.name << " runs its commands unplaced: "
+               << placement.error();
+    return nullptr;
+  }
+  return placement.get();
+}
+
+static RunnerOptions createRunnerOptions(const Configuration& cfg,
+                                         const vector<Command>& commands) {
+  RunnerOptions options;
+  options.debugSampler = std::make_shared<logging::DebugSampler>(
+      cfg.debugSampleRates, cfg.debugContainerFilter,
+      cfg.debugFrameworkFilter);
+
+  // The audit log is an observability facility, failing to open it must not
+  // prevent the agent from starting.
+  if (cfg.auditFile.isSome()) {
+    Try<std::shared_ptr<audit::AuditLog>> auditLog = audit::AuditLog::open(
+        cfg.auditFile.get(), cfg.auditCapacity, cfg.name);
+    if (auditLog.isError()) {
+      LOG(ERROR) << "Audit disabled for module " << cfg.name << ": "
+                 << auditLog.error();
+    } else {
+      options.auditLog = auditLog.get();
+    }
+  }
+
+  // Each module gets its own directory so that it can be swept at startup.
+  string tempDir = path::join(cfg.tempDir, cfg.name);
+  Try<std::shared_ptr<TemporaryFilePool>> tempFilePool =
+      TemporaryFilePool::open(tempDir, cfg.tempFilePoolSize);
+  if (tempFilePool.isError()) {
+    LOG(ERROR) << "Temporary files of module " << cfg.name
+               << " fall back to /tmp: " << tempFilePool.error();
+  } else {
+    options.tempFilePool = tempFilePool.get();
+  }
+
+  options.executables = prepareExecutables(cfg, commands);
+  options.maxOutputSize = cfg.maxOutputSize;
+  options.fileSizeLimit = cfg.commandFileSizeLimit;
+  options.placement = createPlacement(cfg);
+  if (cfg.maxConcurrentCommands > 0) {
+    options.executionQueue =
+        std::make_shared<ExecutionQueue>(cfg.maxConcurrentCommands);
+  }
+
+  if (cfg.circuitBreaker) {
+    CircuitBreakerOptions circuitBreakerOptions;
+    circuitBreakerOptions.window = cfg.circuitBreakerWindow;
+    circuitBreakerOptions.failureRate = cfg.circuitBreakerFailureRate;
+    circuitBreakerOptions.slowCallRate = cfg.circuitBreakerSlowCallRate;
+    circuitBreakerOptions.cooldown = Milliseconds(
+        static_cast<int64_t>(cfg.circuitBreakerCooldown * 1000));
+    options.circuitBreakers =
+        std::make_shared<CircuitBreakers>(circuitBreakerOptions);
+  }
+  return options;
+}
+
+static IsolatorOptions createIsolatorOptions(const Configuration& cfg) {
+  IsolatorOptions options;
+  options.stateDir = cfg.stateDir;
+  options.recoveryWorkers = cfg.recoveryWorkers;
+  options.lazyRecovery = cfg.lazyRecovery;
+  options.orphanCleanupConcurrency = cfg.orphanCleanupConcurrency;
+  options.watchWorkers = cfg.watchWorkers;
+  if (cfg.usageRefreshInterval.isSome()) {
+    options.usageRefreshInterval = Milliseconds(
+        static_cast<int64_t>(cfg.usageRefreshInterval.get() * 1000));
+  }
+  options.usageRefreshConcurrency = cfg.usageRefreshConcurrency;
+  options.usageChannel = cfg.usageChannel;
+  if (cfg.usageChannelMaxAge.isSome()) {
+    options.usageChannelMaxAge = Milliseconds(
+        static_cast<int64_t>(cfg.usageChannelMaxAge.get() * 1000));
+  }
+  options.usageSourceDir = cfg.usageSourceDir;
+  return options;
+}
 
 ::mesos::Hook* createHook(const ::mesos::Parameters& parameters) {
   Configuration cfg = ConfigurationParser::parse(parameters);
-  return new CommandHook(cfg.slaveRunTaskLabelDecoratorCommand,
-                         cfg.slaveExecutorEnvironmentDecoratorCommand,
-                         cfg.slaveRemoveExecutorHookCommand, cfg.isDebugSet);
+  setupTracing(cfg);
+  vector<Command> commands;
+  for (const Option<Command>& command :
+       {cfg.slaveRunTaskLabelDecoratorCommand,
+        cfg.slaveExecutorEnvironmentDecoratorCommand,
+        cfg.slaveRemoveExecutorHookCommand, cfg.slaveLaunchDecoratorCommand}) {
+    if (command.isSome()) commands.push_back(command.get());
+  }
+  return new CommandHook(
+      cfg.slaveRunTaskLabelDecoratorCommand,
+      cfg.slaveExecutorEnvironmentDecoratorCommand,
+      cfg.slaveRemoveExecutorHookCommand, cfg.isDebugSet,
+      createRunnerOptions(cfg, commands), cfg.slaveLaunchDecoratorCommand,
+      Milliseconds(static_cast<int64_t>(cfg.launchDecorationTtl * 1000)));
 }
 
 ::mesos::slave::Isolator* createIsolator(
     const ::mesos::Parameters& parameters) {
   Configuration cfg = ConfigurationParser::parse(parameters);
-  return new CommandIsolator(cfg.name, cfg.prepareCommand, cfg.isolateCommand,
-                             cfg.watchCommand, cfg.cleanupCommand,
-                             cfg.usageCommand, cfg.isDebugSet);
+  setupTracing(cfg);
+  // The commands configured without prefix make the first command set.
+  std::vector<CommandSet> commandSets = {
+      CommandSet{cfg.name, cfg.prepareCommand, cfg.isolateCommand,
+                 cfg.watchCommand, cfg.cleanupCommand, cfg.usageCommand}};
+  commandSets.insert(commandSets.end(), cfg.commandSets.begin(),
+                     cfg.commandSets.end());
+  vector<Command> commands;
+  for (const CommandSet& commandSet : commandSets) {
+    for (const Option<Command>& command :
+         {commandSet.prepareCommand, commandSet.isolateCommand,
+          commandSet.cleanupCommand, commandSet.usageCommand}) {
+      if (command.isSome()) commands.push_back(command.get());
+    }
+    if (commandSet.watchCommand.isSome()) {
+      commands.push_back(commandSet.watchCommand.get());
+    }
+  }
+  return new CommandIsolator(cfg.name, commandSets, cfg.isDebugSet,
+                             createRunnerOptions(cfg, commands),
+                             createIsolatorOptions(cfg));
 }
 }  // namespace mesos
 }  // namespace criteo
@@ -0,0 +1,68 @@
+#ifndef __PROBES_HPP__
+#define __PROBES_HPP__
+
+/*
+ * USDT probes of the modules, usable with bpftrace, perf or SystemTap under
+ * the `criteo_mesos` provider. They are compiled in only when the project is
+ * configured with -DENABLE_USDT_PROBES=ON, otherwise the macros expand to
+ * nothing and their arguments are not even evaluated.
+ *
+ * The first two arguments of every probe are the task (or container) id and
+ * the method taken from the logging metadata.
+ */
+#ifdef CRITEO_MESOS_USDT
+
+#include <sys/sdt.h>
+
+#define PROBE_COMMAND_SPAWN(metadata, executable, pid)                \
+  STAP_PROBE4(criteo_mesos, command_spawn, (metadata).taskId.c_str(), \
+              (metadata).method.c_str(), (executable).c_str(), pid)
+
+#define PROBE_COMMAND_EXIT(metadata, executable, status)             \
+  STAP_PROBE4(criteo_mesos, command_exit, (metadata).taskId.c_str(), \
+              (metadata).method.c_str(), (executable).c_str(), status)
+
+#define PROBE_COMMAND_TIMEOUT(metadata, executable, pid)                \
+  STAP_PROBE4(criteo_mesos, command_timeout, (metadata).taskId.c_str(), \
+              (metadata).method.c_str(), (executable).c_str(), pid)
+
+#define PROBE_COMMAND_SIGTERM(metadata, pid)                            \
+  STAP_PROBE3(criteo_mesos, command_sigterm, (metadata).taskId.c_str(), \
+              (metadata).method.c_str(), pid)
+
+#define PROBE_COMMAND_SIGKILL(metadata, pid)                            \
+  STAP_PROBE3(criteo_mesos, command_sigkill, (metadata).taskId.c_str(), \
+              (metadata).method.c_str(), pid)
+
+#define PROBE_PARSE_START(metadata, size)                             \
+  STAP_PROBE3(criteo_mesos, parse_start, (metadata).taskId.c_str(), \
+              (metadata).method.c_str(), size)
+
+#define PROBE_PARSE_END(metadata, succeeded)                        \
+  STAP_PROBE3(criteo_mesos, parse_end, (metadata).taskId.c_str(), \
+              (metadata).method.c_str(), succeeded)
+
+#define PROBE_ISOLATOR_EVENT_ENTRY(metadata)                     \
+  STAP_PROBE2(criteo_mesos, isolator_event_entry,                \
+              (metadata).taskId.c_str(), (metadata).method.c_str())
+
+#define PROBE_ISOLATOR_EVENT_EXIT(metadata, succeeded)          \
+  STAP_PROBE3(criteo_mesos, isolator_event_exit,                \
+              (metadata).taskId.c_str(), (metadata).method.c_str(), \
+              succeeded)
+
+#else
+
+#define PROBE_COMMAND_SPAWN(metadata, executable, pid)
+#define PROBE_COMMAND_EXIT(metadata, executable, status)
+#define PROBE_COMMAND_TIMEOUT(metadata, executable, pid)
+#define PROBE_COMMAND_SIGTERM(metadata, pid)
+#define PROBE_COMMAND_SIGKILL(metadata, pid)
+#define PROBE_PARSE_START(metadata, size)
+#define PROBE_PARSE_END(metadata, succeeded)
+#define PROBE_ISOLATOR_EVENT_ENTRY(metadata)
+#define PROBE_ISOLATOR_EVENT_EXIT(metadata, succeeded)
+
+#endif  // CRITEO_MESOS_USDT
+
+#endif  // __PROBES_HPP__
@@ -0,0 +1,56 @@
+#ifndef __RUNNER_OPTIONS_HPP__
+#define __RUNNER_OPTIONS_HPP__
+
+#include <memory>
+
+#include <stout/option.hpp>
+
+#include "AuditLog.hpp"
+#include "CircuitBreaker.hpp"
+#include "CommandPlacement.hpp"
+#include "DebugLog.hpp"
+#include "ExecutableCache.hpp"
+#include "ExecutionQueue.hpp"
+#include "RunningContext.hpp"
+#include "TemporaryFilePool.hpp"
+
+namespace criteo {
+namespace mesos {
+
+/**
+ * @brief The RunnerOptions struct gathers the settings of a module that apply
+ * to every command it runs. It is cheap to copy, the facilities it holds are
+ * shared between the copies.
+ */
+struct RunnerOptions {
+  RunnerOptions() : maxOutputSize(DEFAULT_MAX_OUTPUT_SIZE) {}
+
+  // Decides which calls are logged in debug mode, all of them if not set.
+  std::shared_ptr<const logging::DebugSampler> debugSampler;
+  // Records every invocation of the module's commands if set.
+  std::shared_ptr<audit::AuditLog> auditLog;
+  // Provides the temporary files of the commands, fresh files in /tmp are
+  // used for every invocation if not set.
+  std::shared_ptr<TemporaryFilePool> tempFilePool;
+  // Holds the in-memory copies of the executables preloaded when the module
+  // was created, the files on disk are executed if not set.
+  std::shared_ptr<const ExecutableCache> executables;
+  // Size in bytes above which the output of a command is rejected.
+  size_t maxOutputSize;
+  // Size in bytes of the largest file a command can write, enforced with
+  // RLIMIT_FSIZE, unlimited if not set.
+  Option<size_t> fileSizeLimit;
+  // Stop running the commands which keep failing or are too slow if set.
+  std::shared_ptr<CircuitBreakers> circuitBreakers;
+  // Bounds the number of commands running at once and orders the waiting
+  // ones if set, the commands run as soon as they are called otherwise.
+  std::shared_ptr<ExecutionQueue> executionQueue;
+  // Spawns the commands into their cgroup and on their CPUs if set, the
+  // commands run alongside the agent otherwise.
+  std::shared_ptr<const CommandPlacement> placement;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __RUNNER_OPTIONS_HPP__
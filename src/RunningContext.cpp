@@ -1,74 +1,125 @@
 #include "RunningContext.hpp"
+#include "DebugLog.hpp"
+#include "Tracer.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include <fstream>
 #include <stout/os.hpp>
+#include <stout/stringify.hpp>
 
 namespace criteo {
 namespace mesos {
 
-RunningContext::TemporaryFile::TemporaryFile() {
-  char filepath[] = TEMP_FILE_TEMPLATE;
-  int fd = mkstemp(filepath);
-  if (fd == -1)
-    throw std::runtime_error("Unable to create temporary file to run commands");
-  close(fd);
-  m_filepath = std::string(filepath);
-}
+RunningContext::TemporaryFile::TemporaryFile(const std::string& filepath,
+                                             int fd)
+    : m_filepath(filepath), m_fd(fd) {}
+
+Try<std::string> RunningContext::TemporaryFile::readAll(size_t maxSize,
+                                                        bool truncate) const {
+  // The file is read from its path since the command may have replaced it,
+  // but a symlink put in its place is not followed.
+  int fd = ::open(m_filepath.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  if (fd == -1) return ErrnoError("Failed to open \"" + m_filepath + "\"");
+
+  struct stat status;
+  if (::fstat(fd, &status) == -1) {
+    ErrnoError error("Failed to stat \"" + m_filepath + "\"");
+    ::close(fd);
+    return error;
+  }
+  size_t size = static_cast<size_t>(status.st_size);
+  if (size > maxSize) {
+    if (!truncate) {
+      ::close(fd);
+      return Error("Output of " + stringify(size) + " bytes exceeds the " +
+                   stringify(maxSize) + " bytes limit");
+    }
+    size = maxSize;
+  }
+  // Empty files cannot be mapped.
+  if (size == 0) {
+    ::close(fd);
+    return std::string();
+  }
 
-std::string RunningContext::TemporaryFile::readAll() const {
-  std::ifstream ifs(m_filepath);
-  std::string content((std::istreambuf_iterator<char>(ifs)),
-                      (std::istreambuf_iterator<char>()));
-  ifs.close();
+  void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return ErrnoError("Failed to map \"" + m_filepath + "\"");
+  }
+  std::string content(static_cast<const char*>(mapping), size);
+  ::munmap(mapping, size);
   return content;
 }
 
-void RunningContext::TemporaryFile::write(const std::string& content) const {
-  std::ofstream ofs;
-  ofs.open(m_filepath);
-  ofs << content;
-  std::flush(ofs);
-  ofs.close();
+Try<Nothing> RunningContext::TemporaryFile::write(
+    const std::string& content) const {
+  return os::write(m_fd, content);
 }
 
 inline const std::string& RunningContext::TemporaryFile::filepath() const {
   return m_filepath;
 }
 
-RunningContext::RunningContext(bool debug,
-                               const logging::Metadata& loggingMetadata,
-                               const Command& command, const std::string& input)
-    : debug(debug), loggingMetadata(loggingMetadata) {
-  inputFile.write(input);
+TemporaryFiles RunningContext::acquireFiles(
+    const std::shared_ptr<TemporaryFilePool>& filePool) {
+  Try<TemporaryFiles> files = filePool->acquire();
+  if (files.isError())
+    throw std::runtime_error("Unable to create temporary file to run commands");
+  return files.get();
+}
+
+RunningContext::RunningContext(
+    bool debug, const logging::Metadata& loggingMetadata,
+    const Command& command, const std::string& input, uint64_t invocation,
+    const std::shared_ptr<TemporaryFilePool>& filePool, size_t maxOutputSize)
+    : debug(debug),
+      loggingMetadata(loggingMetadata),
+      maxOutputSize(maxOutputSize),
+      filePool(filePool ? filePool : TemporaryFilePool::unpooled()),
+      files(acquireFiles(this->filePool)),
+      inputFile(files.input, files.inputFd),
+      outputFile(files.output, files.outputFd),
+      errorFile(files.error, files.errorFd) {
+  tracing::ScopedSpan writeSpan("write_input", loggingMetadata, invocation);
+  Try<Nothing> written = inputFile.write(input);
+  if (written.isError()) {
+    filePool->release(files, false);
+    throw std::runtime_error("Unable to write the input of the command: " +
+                             written.error());
+  }
+  writeSpan.finish();
   args = {inputFile.filepath(), outputFile.filepath(), errorFile.filepath()};
 
   if (debug) {
-    TASK_LOG(INFO, loggingMetadata)
+    TASK_DEBUG(loggingMetadata)
         << "Calling command: \"" << command.command() << "\" ("
         << command.timeout() << "s) " << inputFile.filepath() << " "
         << outputFile.filepath() << " " << errorFile.filepath();
+    TASK_DEBUG(loggingMetadata) << "Input: " << input;
   }
 }
 
-void RunningContext::deleteContext() const {
+void RunningContext::deleteContext(bool reusable) const {
   if (debug)
-    TASK_LOG(INFO, loggingMetadata) << "Removing temp files " << inputFile
-                                    << " " << outputFile << " " << errorFile;
-  os::rm(inputFile.filepath());
-  os::rm(outputFile.filepath());
-  os::rm(errorFile.filepath());
+    TASK_DEBUG(loggingMetadata) << "Releasing temp files " << inputFile << " "
+                                << outputFile << " " << errorFile;
+  filePool->release(files, reusable);
 }
 
 Try<std::string> RunningContext::readOutput() const {
-  return readFile(outputFile);
+  Try<std::string> output = outputFile.readAll(maxOutputSize, false);
+  if (debug && output.isSome()) {
+    TASK_DEBUG(loggingMetadata) << "Output: " << output.get();
+  }
+  return output;
 }
 
 Try<std::string> RunningContext::readError() const {
-  return readFile(errorFile);
-}
-
-Try<std::string> RunningContext::readFile(const TemporaryFile& file) const {
-  return os::read(file.filepath());
+  return errorFile.readAll(maxOutputSize, true);
 }
 }  // namespace mesos
 }  // namespace criteo
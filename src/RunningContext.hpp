@@ -1,22 +1,43 @@
 #ifndef __RUNNING_CONTEXT_HPP__
 #define __RUNNING_CONTEXT_HPP__
 
+#include <stdint.h>
+
+#include <memory>
+
+#include <stout/nothing.hpp>
 #include <stout/try.hpp>
 
 #include "Command.hpp"
 #include "Logger.hpp"
-
-#define TEMP_FILE_TEMPLATE "/tmp/criteo-mesos-XXXXXX"
+#include "TemporaryFilePool.hpp"
 
 namespace criteo {
 namespace mesos {
 
+// Maximum size in bytes of the output of a command if the user does not
+// override it in configuration.
+const size_t DEFAULT_MAX_OUTPUT_SIZE = 16 * 1024 * 1024;
+
 class RunningContext {
  public:
+  /**
+   * @param filePool The pool the temporary files are taken from, files are
+   *   created in /tmp and removed afterwards if not set.
+   * @param maxOutputSize The size in bytes above which the output of the
+   *   command is rejected, and its error truncated.
+   */
   RunningContext(bool debug, const logging::Metadata& loggingMetadata,
-                 const Command& command, const std::string& input);
-
-  void deleteContext() const;
+                 const Command& command, const std::string& input,
+                 uint64_t invocation = 0,
+                 const std::shared_ptr<TemporaryFilePool>& filePool = nullptr,
+                 size_t maxOutputSize = DEFAULT_MAX_OUTPUT_SIZE);
+
+  /**
+   * Give the temporary files back to the pool.
+   * @param reusable false if the command may still be writing in the files.
+   */
+  void deleteContext(bool reusable = true) const;
   Try<std::string> readOutput() const;
   Try<std::string> readError() const;
   const std::vector<std::string>& get_args() const { return args; };
@@ -27,19 +48,26 @@ class RunningContext {
    */
   class TemporaryFile {
    public:
-    TemporaryFile();
+    /*
+     * @param fd The descriptor of the file held by the pool.
+     */
+    TemporaryFile(const std::string& filepath, int fd);
 
     /*
-     * Read whole content of the temporary file.
+     * Read whole content of the temporary file through a memory mapping, so
+     * that it is copied only once into the returned string.
+     * @param maxSize The size above which the content is not read.
+     * @param truncate Whether to return the first maxSize bytes of a larger
+     *   file instead of an error.
      * @return The content of the file.
      */
-    std::string readAll() const;
+    Try<std::string> readAll(size_t maxSize, bool truncate) const;
 
     /*
-     * Write content to the temporary file and flush it.
+     * Write content to the temporary file through its descriptor.
      * @param content The content to write to the file.
      */
-    void write(const std::string& content) const;
+    Try<Nothing> write(const std::string& content) const;
 
     inline const std::string& filepath() const;
 
@@ -51,13 +79,19 @@ class RunningContext {
 
    private:
     std::string m_filepath;
+    int m_fd;
   };
 
-  Try<std::string> readFile(const TemporaryFile& file) const;
+  static TemporaryFiles acquireFiles(
+      const std::shared_ptr<TemporaryFilePool>& filePool);
 
   bool debug;
   const logging::Metadata loggingMetadata;
   std::vector<std::string> args;
+  size_t maxOutputSize;
+
+  std::shared_ptr<TemporaryFilePool> filePool;
+  TemporaryFiles files;
 
   TemporaryFile inputFile;
   TemporaryFile outputFile;
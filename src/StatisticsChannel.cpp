@@ -0,0 +1,157 @@
+#include "StatisticsChannel.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stout/error.hpp>
+
+namespace criteo {
+namespace mesos {
+namespace statistics {
+
+using std::string;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+
+// Number of attempts to read a slot being written before giving up.
+const int MAX_READ_ATTEMPTS = 64;
+
+StatisticsChannel::StatisticsChannel(const string& path,
+                                     const Option<Duration>& maxAge,
+                                     const Duration& checkInterval)
+    : m_path(path),
+      m_maxAge(maxAge),
+      m_checkInterval(checkInterval),
+      m_device(0),
+      m_inode(0),
+      m_mapping(nullptr),
+      m_length(0),
+      m_header(nullptr),
+      m_slots(nullptr) {}
+
+StatisticsChannel::~StatisticsChannel() { detach(); }
+
+bool StatisticsChannel::attach() {
+  int fd = ::open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) return false;
+
+  struct stat status;
+  ChannelHeader header;
+  bool valid = fstat(fd, &status) == 0 &&
+               pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+               header.magic == CHANNEL_MAGIC &&
+               header.version == CHANNEL_VERSION &&
+               header.slotSize == sizeof(ChannelSlot) &&
+               header.capacity > 0 &&
+               static_cast<size_t>(status.st_size) ==
+                   channelLength(header.capacity);
+  if (!valid) {
+    ::close(fd);
+    return false;
+  }
+
+  size_t length = status.st_size;
+  void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) return false;
+
+  m_device = status.st_dev;
+  m_inode = status.st_ino;
+  m_nextCheck = steady_clock::now() + nanoseconds(m_checkInterval.ns());
+  m_mapping = mapping;
+  m_length = length;
+  m_header = static_cast<ChannelHeader*>(mapping);
+  m_slots = reinterpret_cast<ChannelSlot*>(static_cast<char*>(mapping) +
+                                           sizeof(ChannelHeader));
+  return true;
+}
+
+void StatisticsChannel::detach() {
+  if (m_mapping != nullptr) munmap(m_mapping, m_length);
+  m_mapping = nullptr;
+  m_length = 0;
+  m_header = nullptr;
+  m_slots = nullptr;
+}
+
+bool StatisticsChannel::replaced() {
+  steady_clock::time_point now = steady_clock::now();
+  if (now < m_nextCheck) return false;
+  m_nextCheck = now + nanoseconds(m_checkInterval.ns());
+
+  struct stat status;
+  return ::stat(m_path.c_str(), &status) == -1 || status.st_dev != m_device ||
+         status.st_ino != m_inode;
+}
+
+Result<::mesos::ResourceStatistics> StatisticsChannel::read(
+    const string& containerId) {
+  if (m_header != nullptr && (m_header->closed.load() || replaced())) {
+    detach();
+  }
+  if (m_header == nullptr && !attach()) return None();
+
+  const uint64_t capacity = m_header->capacity;
+  uint64_t index = firstSlot(*m_header, containerId);
+  for (uint64_t probe = 0; probe < capacity; ++probe) {
+    const ChannelSlot& slot = m_slots[(index + probe) % capacity];
+
+    int attempts = 0;
+    while (!readSlot(slot, m_copy, false)) {
+      if (++attempts == MAX_READ_ATTEMPTS) {
+        return Error("Slot of container " + containerId + " kept changing");
+      }
+    }
+    if (m_copy.state == SLOT_FREE) return None();
+    if (m_copy.state != SLOT_USED ||
+        strncmp(m_copy.containerId, containerId.c_str(),
+                sizeof(m_copy.containerId)) != 0) {
+      continue;
+    }
+
+    attempts = 0;
+    while (!readSlot(slot, m_copy, true)) {
+      if (++attempts == MAX_READ_ATTEMPTS) {
+        return Error("Slot of container " + containerId + " kept changing");
+      }
+    }
+    // The slot may have been given to another container in between.
+    if (m_copy.state != SLOT_USED ||
+        strncmp(m_copy.containerId, containerId.c_str(),
+                sizeof(m_copy.containerId)) != 0) {
+      return None();
+    }
+    if (m_maxAge.isSome()) {
+      uint64_t now = duration_cast<microseconds>(
+                         system_clock::now().time_since_epoch())
+                         .count();
+      // The statistics of a dead writer stay in the channel forever.
+      if (now > m_copy.timestamp &&
+          now - m_copy.timestamp > static_cast<uint64_t>(m_maxAge->us())) {
+        return None();
+      }
+    }
+    if (m_copy.length > sizeof(m_copy.data)) {
+      return Error("Invalid statistics length in channel");
+    }
+
+    ::mesos::ResourceStatistics statistics;
+    if (!statistics.ParsePartialFromArray(m_copy.data, m_copy.length)) {
+      return Error("Malformed Protobuf in channel");
+    }
+    if (!statistics.has_timestamp()) {
+      statistics.set_timestamp(m_copy.timestamp / 1e6);
+    }
+    return statistics;
+  }
+  return None();
+}
+
+}  // namespace statistics
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,88 @@
+#ifndef __STATISTICS_CHANNEL_HPP__
+#define __STATISTICS_CHANNEL_HPP__
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <string>
+
+#include <mesos/mesos.hpp>
+#include <stout/duration.hpp>
+#include <stout/option.hpp>
+#include <stout/result.hpp>
+
+#include "StatisticsChannelLayout.hpp"
+
+namespace criteo {
+namespace mesos {
+namespace statistics {
+
+// Interval between two checks that the path of a channel still names the
+// mapped file.
+const Duration DEFAULT_CHANNEL_CHECK_INTERVAL = Seconds(1);
+
+/**
+ * @brief The StatisticsChannel reads the statistics an external process
+ * publishes for each container in a shared-memory channel, see
+ * StatisticsChannelLayout.hpp. Reads are lock-free and never enter the
+ * kernel once the channel is mapped.
+ *
+ * The channel is mapped on first use and mapped again when its writer
+ * replaces it, so the writer may start after the agent. A writer restarting
+ * without closing the previous channel is detected by checking the path
+ * periodically. The reader is not thread-safe.
+ */
+class StatisticsChannel {
+ public:
+  /**
+   * @param path The path of the channel, usually under /dev/shm.
+   * @param maxAge The statistics published longer ago are ignored, e.g.
+   *   because their writer died.
+   * @param checkInterval The interval between two checks that the path still
+   *   names the mapped channel.
+   */
+  explicit StatisticsChannel(
+      const std::string& path, const Option<Duration>& maxAge = None(),
+      const Duration& checkInterval = DEFAULT_CHANNEL_CHECK_INTERVAL);
+
+  ~StatisticsChannel();
+
+  /**
+   * @return The latest statistics published for the container, None if there
+   *   are none, they are too old or the channel does not exist yet.
+   */
+  Result<::mesos::ResourceStatistics> read(const std::string& containerId);
+
+  inline const std::string& path() const { return m_path; }
+
+ private:
+  bool attach();
+  void detach();
+
+  /**
+   * @return true if the path names another file than the mapped channel. The
+   *   path is only checked once per check interval.
+   */
+  bool replaced();
+
+  std::string m_path;
+  Option<Duration> m_maxAge;
+  Duration m_checkInterval;
+  std::chrono::steady_clock::time_point m_nextCheck;
+  // Identity of the mapped file.
+  dev_t m_device;
+  ino_t m_inode;
+  void* m_mapping;
+  size_t m_length;
+  ChannelHeader* m_header;
+  ChannelSlot* m_slots;
+  // Copy of the slot being read, kept here rather than on the stack.
+  ChannelSlot m_copy;
+};
+
+}  // namespace statistics
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __STATISTICS_CHANNEL_HPP__
@@ -0,0 +1,107 @@
+#ifndef __STATISTICS_CHANNEL_LAYOUT_HPP__
+#define __STATISTICS_CHANNEL_LAYOUT_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+namespace criteo {
+namespace mesos {
+namespace statistics {
+
+// Number of slots of a channel created by the writer if the caller does not
+// override it.
+const uint64_t DEFAULT_CHANNEL_CAPACITY = 4096;
+
+const uint32_t CHANNEL_MAGIC = 0x54415453;  // "STAT"
+const uint32_t CHANNEL_VERSION = 1;
+
+// States of a slot.
+const uint32_t SLOT_FREE = 0;
+const uint32_t SLOT_USED = 1;
+// The container of the slot is gone. The slot can be reused but, unlike a
+// free slot, does not end the lookup of a container.
+const uint32_t SLOT_REMOVED = 2;
+
+/*
+ * Layout of a statistics channel: a header followed by `capacity` slots. The
+ * slot of a container is found by linear probing from the hash of its id.
+ * There is at most one writer, which updates a slot under its sequence
+ * number: the sequence is odd while the slot is being written so that readers
+ * detect and retry torn reads without any lock. Any change of the layout must
+ * bump CHANNEL_VERSION.
+ */
+struct ChannelHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotSize;
+  // Set when the writer replaced the channel by a new file, readers must map
+  // the path again.
+  std::atomic<uint32_t> closed;
+  uint64_t capacity;
+  uint8_t padding[40];
+};
+
+struct ChannelSlot {
+  uint64_t sequence;
+  uint32_t state;
+  // Size of the serialized ResourceStatistics in `data`.
+  uint32_t length;
+  // Microseconds since epoch when the statistics were published.
+  uint64_t timestamp;
+  char containerId[128];
+  uint8_t data[3944];
+};
+
+static_assert(sizeof(ChannelHeader) == 64, "Channel header layout changed");
+static_assert(sizeof(ChannelSlot) == 4096, "Channel slot layout changed");
+
+/**
+ * @return The size of a channel file of a given capacity.
+ */
+inline size_t channelLength(uint64_t capacity) {
+  return sizeof(ChannelHeader) + capacity * sizeof(ChannelSlot);
+}
+
+/**
+ * @return The slot where the lookup of a container starts.
+ */
+inline uint64_t firstSlot(const ChannelHeader& header,
+                          const std::string& containerId) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : containerId) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash % header.capacity;
+}
+
+/**
+ * Copy the metadata of a slot, and its data if `withData` is set, under its
+ * sequence number.
+ *
+ * @return false if the slot was being written, the copy must be retried.
+ */
+inline bool readSlot(const ChannelSlot& slot, ChannelSlot& copy,
+                     bool withData) {
+  uint64_t before = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+  if (before & 1) return false;
+  memcpy(&copy, &slot, offsetof(ChannelSlot, data));
+  if (withData) {
+    memcpy(copy.data, slot.data,
+           std::min<size_t>(copy.length, sizeof(copy.data)));
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return __atomic_load_n(&slot.sequence, __ATOMIC_RELAXED) == before;
+}
+
+}  // namespace statistics
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __STATISTICS_CHANNEL_LAYOUT_HPP__
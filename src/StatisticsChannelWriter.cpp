@@ -0,0 +1,185 @@
+#include "StatisticsChannelWriter.hpp"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <new>
+
+#include <stout/error.hpp>
+
+namespace criteo {
+namespace mesos {
+namespace statistics {
+
+using std::string;
+
+// Tell the readers of the channel at `path`, if any, that it is replaced.
+static void closeChannel(const string& path) {
+  int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd == -1) return;
+
+  struct stat status;
+  if (fstat(fd, &status) == 0 &&
+      static_cast<size_t>(status.st_size) >= sizeof(ChannelHeader)) {
+    void* mapping = mmap(nullptr, sizeof(ChannelHeader),
+                         PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping != MAP_FAILED) {
+      ChannelHeader* header = static_cast<ChannelHeader*>(mapping);
+      if (header->magic == CHANNEL_MAGIC) header->closed.store(1);
+      munmap(mapping, sizeof(ChannelHeader));
+    }
+  }
+  ::close(fd);
+}
+
+Try<std::shared_ptr<StatisticsChannelWriter>> StatisticsChannelWriter::create(
+    const string& path, uint64_t capacity) {
+  if (capacity == 0) return Error("Channel capacity must be positive");
+
+  size_t length = channelLength(capacity);
+  int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd != -1) {
+    struct stat status;
+    ChannelHeader header;
+    bool compatible =
+        fstat(fd, &status) == 0 &&
+        static_cast<size_t>(status.st_size) == length &&
+        pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+        header.magic == CHANNEL_MAGIC && header.version == CHANNEL_VERSION &&
+        header.slotSize == sizeof(ChannelSlot) &&
+        header.capacity == capacity && header.closed.load() == 0;
+    if (compatible) {
+      void* mapping =
+          mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (mapping == MAP_FAILED) {
+        return ErrnoError("Failed to map channel '" + path + "'");
+      }
+      return std::shared_ptr<StatisticsChannelWriter>(
+          new StatisticsChannelWriter(mapping, length));
+    }
+    ::close(fd);
+  }
+
+  // Build the new channel aside so that readers never map a partial one.
+  string temporary = path + ".new";
+  fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    return ErrnoError("Failed to create channel '" + temporary + "'");
+  }
+  if (ftruncate(fd, length) == -1) {
+    ErrnoError error("Failed to resize channel '" + temporary + "'");
+    ::close(fd);
+    return error;
+  }
+  void* mapping =
+      mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return ErrnoError("Failed to map channel '" + temporary + "'");
+  }
+
+  ChannelHeader* header = new (mapping) ChannelHeader();
+  header->magic = CHANNEL_MAGIC;
+  header->version = CHANNEL_VERSION;
+  header->slotSize = sizeof(ChannelSlot);
+  header->closed.store(0);
+  header->capacity = capacity;
+
+  closeChannel(path);
+  if (::rename(temporary.c_str(), path.c_str()) == -1) {
+    ErrnoError error("Failed to rename channel '" + temporary + "'");
+    munmap(mapping, length);
+    return error;
+  }
+  return std::shared_ptr<StatisticsChannelWriter>(
+      new StatisticsChannelWriter(mapping, length));
+}
+
+StatisticsChannelWriter::StatisticsChannelWriter(void* mapping, size_t length)
+    : m_mapping(mapping),
+      m_length(length),
+      m_header(static_cast<ChannelHeader*>(mapping)),
+      m_slots(reinterpret_cast<ChannelSlot*>(static_cast<char*>(mapping) +
+                                             sizeof(ChannelHeader))) {}
+
+StatisticsChannelWriter::~StatisticsChannelWriter() {
+  munmap(m_mapping, m_length);
+}
+
+ChannelSlot* StatisticsChannelWriter::find(const string& containerId,
+                                           bool claim) {
+  const uint64_t capacity = m_header->capacity;
+  uint64_t index = firstSlot(*m_header, containerId);
+  ChannelSlot* reusable = nullptr;
+  for (uint64_t probe = 0; probe < capacity; ++probe) {
+    ChannelSlot& slot = m_slots[(index + probe) % capacity];
+    if (slot.state == SLOT_FREE) {
+      if (!claim) return nullptr;
+      return reusable != nullptr ? reusable : &slot;
+    }
+    if (slot.state == SLOT_REMOVED) {
+      if (reusable == nullptr) reusable = &slot;
+    } else if (containerId == slot.containerId) {
+      return &slot;
+    }
+  }
+  return claim ? reusable : nullptr;
+}
+
+// Update a slot under its sequence number.
+template <typename F>
+static void writeSlot(ChannelSlot& slot, F update) {
+  uint64_t sequence = slot.sequence;
+  __atomic_store_n(&slot.sequence, sequence + 1, __ATOMIC_RELAXED);
+  std::atomic_thread_fence(std::memory_order_release);
+  update(slot);
+  __atomic_store_n(&slot.sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+Try<Nothing> StatisticsChannelWriter::publish(const string& containerId,
+                                              const string& statistics) {
+  if (containerId.empty() ||
+      containerId.size() >= sizeof(ChannelSlot::containerId)) {
+    return Error("Invalid container id '" + containerId + "'");
+  }
+  if (statistics.size() > sizeof(ChannelSlot::data)) {
+    return Error("Statistics of container " + containerId + " are too large");
+  }
+
+  ChannelSlot* slot = find(containerId, true);
+  if (slot == nullptr) return Error("Channel is full");
+
+  uint64_t timestamp =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  writeSlot(*slot, [&](ChannelSlot& slot) {
+    slot.state = SLOT_USED;
+    slot.length = statistics.size();
+    slot.timestamp = timestamp;
+    memset(slot.containerId, 0, sizeof(slot.containerId));
+    memcpy(slot.containerId, containerId.data(), containerId.size());
+    memcpy(slot.data, statistics.data(), statistics.size());
+  });
+  return Nothing();
+}
+
+void StatisticsChannelWriter::remove(const string& containerId) {
+  ChannelSlot* slot = find(containerId, false);
+  if (slot == nullptr) return;
+
+  writeSlot(*slot, [](ChannelSlot& slot) {
+    slot.state = SLOT_REMOVED;
+    slot.length = 0;
+    memset(slot.containerId, 0, sizeof(slot.containerId));
+  });
+}
+
+}  // namespace statistics
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,74 @@
+#ifndef __STATISTICS_CHANNEL_WRITER_HPP__
+#define __STATISTICS_CHANNEL_WRITER_HPP__
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+#include "StatisticsChannelLayout.hpp"
+
+namespace criteo {
+namespace mesos {
+namespace statistics {
+
+/**
+ * @brief The StatisticsChannelWriter is the reference implementation of the
+ * writer of a statistics channel, meant to be linked into the collector
+ * publishing the statistics of the containers. It only depends on the layout
+ * of the channel, the statistics are given already serialized.
+ *
+ * A channel has a single writer and the writer is not thread-safe.
+ */
+class StatisticsChannelWriter {
+ public:
+  /**
+   * Open or create a channel. An existing channel with the same layout is
+   * reused, otherwise it is replaced atomically and its readers are told to
+   * map the new one.
+   *
+   * @param path The path of the channel, usually under /dev/shm.
+   * @param capacity The maximum number of containers of the channel.
+   */
+  static Try<std::shared_ptr<StatisticsChannelWriter>> create(
+      const std::string& path, uint64_t capacity = DEFAULT_CHANNEL_CAPACITY);
+
+  ~StatisticsChannelWriter();
+
+  /**
+   * Publish the statistics of a container.
+   *
+   * @param containerId The id of the container, shorter than 128 bytes.
+   * @param statistics The serialized ResourceStatistics of the container, its
+   *   timestamp defaults to the time of publication.
+   */
+  Try<Nothing> publish(const std::string& containerId,
+                       const std::string& statistics);
+
+  /**
+   * Remove the statistics of a container.
+   */
+  void remove(const std::string& containerId);
+
+  inline uint64_t capacity() const { return m_header->capacity; }
+
+ private:
+  StatisticsChannelWriter(void* mapping, size_t length);
+
+  // Look up the slot of a container, or a slot to give it if `claim` is set.
+  ChannelSlot* find(const std::string& containerId, bool claim);
+
+  void* m_mapping;
+  size_t m_length;
+  ChannelHeader* m_header;
+  ChannelSlot* m_slots;
+};
+
+}  // namespace statistics
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __STATISTICS_CHANNEL_WRITER_HPP__
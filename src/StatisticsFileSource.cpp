@@ -0,0 +1,114 @@
+#include "StatisticsFileSource.hpp"
+#include "Helpers.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stout/error.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
+
+namespace criteo {
+namespace mesos {
+
+using std::string;
+
+const string BINARY_EXTENSION = ".pb";
+const string JSON_EXTENSION = ".json";
+
+StatisticsFileSource::StatisticsFileSource(const string& directory)
+    : m_directory(directory) {}
+
+Result<::mesos::ResourceStatistics> StatisticsFileSource::read(
+    const string& containerId, const logging::Metadata& metadata) {
+  for (const string& extension : {BINARY_EXTENSION, JSON_EXTENSION}) {
+    string path = path::join(m_directory, containerId + extension);
+
+    struct stat status;
+    if (::stat(path.c_str(), &status) == -1) {
+      if (errno == ENOENT) continue;
+      return ErrnoError("Failed to stat '" + path + "'");
+    }
+
+    Generation generation = {status.st_ino, status.st_size, status.st_mtim};
+    if (m_cache.contains(containerId)) {
+      const Entry& entry = m_cache.at(containerId);
+      if (entry.path == path && entry.generation == generation) {
+        return entry.statistics;
+      }
+    }
+    return load(containerId, path, metadata);
+  }
+
+  m_cache.erase(containerId);
+  return None();
+}
+
+Result<::mesos::ResourceStatistics> StatisticsFileSource::load(
+    const string& containerId, const string& path,
+    const logging::Metadata& metadata) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    // The collector removed the file in between.
+    if (errno == ENOENT) return None();
+    return ErrnoError("Failed to open '" + path + "'");
+  }
+
+  // The generation is taken from the opened file, which may already have been
+  // replaced since it was stat'ed.
+  struct stat status;
+  if (fstat(fd, &status) == -1) {
+    ErrnoError error("Failed to stat '" + path + "'");
+    ::close(fd);
+    return error;
+  }
+  if (status.st_size == 0) {
+    ::close(fd);
+    return Error("Statistics file '" + path + "' is empty");
+  }
+
+  size_t length = status.st_size;
+  void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    return ErrnoError("Failed to map '" + path + "'");
+  }
+
+  Result<::mesos::ResourceStatistics> statistics = None();
+  if (strings::endsWith(path, BINARY_EXTENSION)) {
+    ::mesos::ResourceStatistics parsed;
+    if (parsed.ParsePartialFromArray(mapping, static_cast<int>(length))) {
+      statistics = parsed;
+    } else {
+      statistics = Error("Malformed Protobuf");
+    }
+  } else {
+    statistics = jsonToProtobuf<::mesos::ResourceStatistics>(
+        string(static_cast<const char*>(mapping), length), metadata);
+  }
+  munmap(mapping, length);
+
+  if (statistics.isError()) {
+    return Error("Failed to parse '" + path + "': " + statistics.error());
+  }
+
+  ::mesos::ResourceStatistics result = statistics.get();
+  if (!result.has_timestamp()) {
+    result.set_timestamp(status.st_mtim.tv_sec + status.st_mtim.tv_nsec / 1e9);
+  }
+
+  Entry entry = {path, {status.st_ino, status.st_size, status.st_mtim},
+                 result};
+  m_cache[containerId] = entry;
+  return result;
+}
+
+void StatisticsFileSource::forget(const string& containerId) {
+  m_cache.erase(containerId);
+}
+
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,79 @@
+#ifndef __STATISTICS_FILE_SOURCE_HPP__
+#define __STATISTICS_FILE_SOURCE_HPP__
+
+#include <sys/types.h>
+#include <time.h>
+
+#include <string>
+
+#include <mesos/mesos.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/result.hpp>
+
+#include "Logger.hpp"
+
+namespace criteo {
+namespace mesos {
+
+/**
+ * @brief The StatisticsFileSource reads the statistics of the containers
+ * published by an external collector in a directory, one file per container:
+ * `<container id>.pb` holds a serialized ResourceStatistics and
+ * `<container id>.json` its JSON representation. The collector is expected to
+ * replace a file atomically, with rename(2).
+ *
+ * A file is mapped and parsed only when its generation (inode, size and
+ * modification time) changes, otherwise reading it costs a single stat(2).
+ * The source is not thread-safe.
+ */
+class StatisticsFileSource {
+ public:
+  explicit StatisticsFileSource(const std::string& directory);
+
+  /**
+   * @param containerId The id of the container.
+   * @param metadata The logging metadata of the call.
+   * @return The latest statistics published for the container, None if there
+   *   are none.
+   */
+  Result<::mesos::ResourceStatistics> read(const std::string& containerId,
+                                           const logging::Metadata& metadata);
+
+  /**
+   * Drop the cached statistics of a container.
+   */
+  void forget(const std::string& containerId);
+
+  inline const std::string& directory() const { return m_directory; }
+
+ private:
+  struct Generation {
+    ino_t inode;
+    off_t size;
+    struct timespec mtime;
+
+    bool operator==(const Generation& that) const {
+      return inode == that.inode && size == that.size &&
+             mtime.tv_sec == that.mtime.tv_sec &&
+             mtime.tv_nsec == that.mtime.tv_nsec;
+    }
+  };
+
+  struct Entry {
+    std::string path;
+    Generation generation;
+    ::mesos::ResourceStatistics statistics;
+  };
+
+  Result<::mesos::ResourceStatistics> load(const std::string& containerId,
+                                           const std::string& path,
+                                           const logging::Metadata& metadata);
+
+  std::string m_directory;
+  hashmap<std::string, Entry> m_cache;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __STATISTICS_FILE_SOURCE_HPP__
@@ -0,0 +1,219 @@
+#include "TemporaryFilePool.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <list>
+#include <map>
+
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+namespace criteo {
+namespace mesos {
+
+using std::string;
+
+const string TEMP_FILE_PREFIX = "criteo-mesos-";
+
+/*
+ * Create a file only the agent can access, and keep it open.
+ *
+ * @param filepath Set to the path of the file.
+ * @return The descriptor of the file.
+ */
+static Try<int> createFile(const string& directory, string& filepath) {
+  string path = path::join(directory, TEMP_FILE_PREFIX + "XXXXXX");
+  std::vector<char> pattern(path.begin(), path.end());
+  pattern.push_back('\0');
+  int fd = mkostemp(pattern.data(), O_CLOEXEC);
+  if (fd == -1) {
+    return ErrnoError("Unable to create temporary file in " + directory);
+  }
+  filepath = pattern.data();
+  return fd;
+}
+
+static void removeFile(const string& filepath, int fd) {
+  if (fd != -1) ::close(fd);
+  os::rm(filepath);
+}
+
+/*
+ * Empty a file through its descriptor, and rewind it for the next input.
+ *
+ * @return false if the path does not lead to the file anymore.
+ */
+static bool resetFile(const string& filepath, int fd) {
+  struct stat held;
+  struct stat current;
+  return ::fstat(fd, &held) == 0 && ::lstat(filepath.c_str(), &current) == 0 &&
+         held.st_dev == current.st_dev && held.st_ino == current.st_ino &&
+         ::ftruncate(fd, 0) == 0 && ::lseek(fd, 0, SEEK_SET) == 0;
+}
+
+/*
+ * Create the directory of a pool with mode 0700, or check that an existing
+ * one has it. The commands of the agent run on the files of the directory
+ * with its privileges: a user able to swap them, e.g. for symlinks, could
+ * make the agent overwrite any file.
+ */
+static Try<Nothing> createPrivateDirectory(const string& directory) {
+  string parent = Path(directory).dirname();
+  Try<Nothing> parentCreated = os::mkdir(parent);
+  if (parentCreated.isError()) {
+    return Error("Failed to create " + parent + ": " + parentCreated.error());
+  }
+  if (::mkdir(directory.c_str(), S_IRWXU) == -1 && errno != EEXIST) {
+    return ErrnoError("Failed to create " + directory);
+  }
+
+  struct stat status;
+  if (::lstat(directory.c_str(), &status) == -1) {
+    return ErrnoError("Failed to stat " + directory);
+  }
+  if (!S_ISDIR(status.st_mode)) return Error(directory + " is not a directory");
+  if (status.st_uid != ::geteuid() ||
+      (status.st_mode & (S_IRWXG | S_IRWXO)) != 0) {
+    return Error(directory + " must be owned by uid " +
+                 stringify(::geteuid()) + " with mode 0700");
+  }
+
+  // Who can write in the parent can rename the directory and put another in
+  // its place, unless the parent is sticky.
+  if (::stat(parent.c_str(), &status) == -1) {
+    return ErrnoError("Failed to stat " + parent);
+  }
+  if ((status.st_uid != 0 && status.st_uid != ::geteuid()) ||
+      ((status.st_mode & (S_IWGRP | S_IWOTH)) != 0 &&
+       (status.st_mode & S_ISVTX) == 0)) {
+    return Error(parent + " can be modified by other users");
+  }
+  return Nothing();
+}
+
+TemporaryFilePool::TemporaryFilePool(const string& directory, size_t capacity)
+    : m_directory(directory), m_capacity(capacity) {
+  m_idle.reserve(capacity);
+}
+
+Try<std::shared_ptr<TemporaryFilePool>> TemporaryFilePool::open(
+    const string& directory, size_t capacity) {
+  static std::mutex mutex;
+  static std::map<string, std::shared_ptr<TemporaryFilePool>> pools;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = pools.find(directory);
+  if (it != pools.end()) return it->second;
+
+  Try<Nothing> created = createPrivateDirectory(directory);
+  if (created.isError()) return Error(created.error());
+
+  // The files of a previous run are not referenced anymore, the directory is
+  // swept in a single pass before the pool is populated.
+  Try<std::list<string>> entries = os::ls(directory);
+  if (entries.isError()) {
+    return Error("Failed to list " + directory + ": " + entries.error());
+  }
+  for (const string& entry : entries.get()) {
+    if (strings::startsWith(entry, TEMP_FILE_PREFIX)) {
+      os::rm(path::join(directory, entry));
+    }
+  }
+
+  std::shared_ptr<TemporaryFilePool> pool(
+      new TemporaryFilePool(directory, capacity));
+  for (size_t i = 0; i < capacity; ++i) {
+    Try<TemporaryFiles> files = pool->create();
+    if (files.isError()) return Error(files.error());
+    pool->m_idle.push_back(files.get());
+  }
+
+  pools[directory] = pool;
+  return pool;
+}
+
+TemporaryFilePool::~TemporaryFilePool() {
+  for (const TemporaryFiles& files : m_idle) {
+    ::close(files.inputFd);
+    ::close(files.outputFd);
+    ::close(files.errorFd);
+  }
+}
+
+std::shared_ptr<TemporaryFilePool> TemporaryFilePool::unpooled() {
+  static std::shared_ptr<TemporaryFilePool> pool(
+      new TemporaryFilePool("/tmp", 0));
+  return pool;
+}
+
+Try<TemporaryFiles> TemporaryFilePool::acquire() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_idle.empty()) {
+      TemporaryFiles files = std::move(m_idle.back());
+      m_idle.pop_back();
+      return files;
+    }
+  }
+  return create();
+}
+
+void TemporaryFilePool::release(const TemporaryFiles& files, bool reusable) {
+  if (reusable && m_capacity > 0) {
+    // A file the command removed or replaced is not the one held anymore,
+    // the triplet is then dropped.
+    reusable = resetFile(files.input, files.inputFd) &&
+               resetFile(files.output, files.outputFd) &&
+               resetFile(files.error, files.errorFd);
+    if (reusable) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_idle.size() < m_capacity) {
+        m_idle.push_back(files);
+        return;
+      }
+    }
+  }
+  remove(files);
+}
+
+size_t TemporaryFilePool::idle() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_idle.size();
+}
+
+Try<TemporaryFiles> TemporaryFilePool::create() const {
+  TemporaryFiles files;
+  Try<int> input = createFile(m_directory, files.input);
+  if (input.isError()) return Error(input.error());
+  files.inputFd = input.get();
+
+  Try<int> output = createFile(m_directory, files.output);
+  if (output.isError()) {
+    removeFile(files.input, files.inputFd);
+    return Error(output.error());
+  }
+  files.outputFd = output.get();
+
+  Try<int> error = createFile(m_directory, files.error);
+  if (error.isError()) {
+    removeFile(files.input, files.inputFd);
+    removeFile(files.output, files.outputFd);
+    return Error(error.error());
+  }
+  files.errorFd = error.get();
+  return files;
+}
+
+void TemporaryFilePool::remove(const TemporaryFiles& files) const {
+  removeFile(files.input, files.inputFd);
+  removeFile(files.output, files.outputFd);
+  removeFile(files.error, files.errorFd);
+}
+
+}  // namespace mesos
+}  // namespace criteo
@@ -0,0 +1,104 @@
+#ifndef __TEMPORARY_FILE_POOL_HPP__
+#define __TEMPORARY_FILE_POOL_HPP__
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <stout/try.hpp>
+
+namespace criteo {
+namespace mesos {
+
+// Parent of the per-module directories holding the temporary files if the
+// user does not override it in configuration.
+const std::string DEFAULT_TEMP_DIR = "/var/run/criteo-mesos";
+
+// Number of idle file triplets kept by a module if the user does not override
+// it in configuration.
+const size_t DEFAULT_TEMP_FILE_POOL_SIZE = 8;
+
+/**
+ * @brief The input, output and error files passed to a command, with the
+ * descriptors through which the pool writes and resets them.
+ */
+struct TemporaryFiles {
+  TemporaryFiles() : inputFd(-1), outputFd(-1), errorFd(-1) {}
+
+  std::string input;
+  std::string output;
+  std::string error;
+
+  int inputFd;
+  int outputFd;
+  int errorFd;
+};
+
+/**
+ * @brief The TemporaryFilePool hands out the temporary files of the commands
+ * and keeps the released ones, truncated, for the next invocations instead of
+ * creating and unlinking three files per invocation.
+ */
+class TemporaryFilePool {
+ public:
+  /**
+   * Get the pool of a directory, creating it on first use. The directory is
+   * reserved to the pool: the files left by a previous run are removed and
+   * the idle triplets are created upfront. It must only be accessible to the
+   * agent, which runs the commands on the files it holds: it is created with
+   * mode 0700 and refused if it exists with another owner, if other users
+   * can access it, or if they can replace it.
+   *
+   * @param directory The directory holding the files.
+   * @param capacity The maximum number of idle triplets kept in the pool.
+   */
+  static Try<std::shared_ptr<TemporaryFilePool>> open(
+      const std::string& directory, size_t capacity);
+
+  ~TemporaryFilePool();
+
+  /**
+   * @return A pool creating fresh files in /tmp for every invocation and
+   *   removing them afterwards.
+   */
+  static std::shared_ptr<TemporaryFilePool> unpooled();
+
+  /**
+   * @return An idle triplet, or new files if the pool is empty.
+   */
+  Try<TemporaryFiles> acquire();
+
+  /**
+   * Give back files obtained with acquire. They are reset through their
+   * descriptors, a file which the command removed or replaced is not reused.
+   *
+   * @param files The files to give back.
+   * @param reusable false if a process may still write in the files, they
+   *   are then removed instead of being reused.
+   */
+  void release(const TemporaryFiles& files, bool reusable);
+
+  /**
+   * @return The number of idle triplets.
+   */
+  size_t idle() const;
+
+  inline const std::string& directory() const { return m_directory; }
+
+ private:
+  TemporaryFilePool(const std::string& directory, size_t capacity);
+
+  Try<TemporaryFiles> create() const;
+  void remove(const TemporaryFiles& files) const;
+
+  std::string m_directory;
+  size_t m_capacity;
+  mutable std::mutex m_mutex;
+  std::vector<TemporaryFiles> m_idle;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __TEMPORARY_FILE_POOL_HPP__
@@ -0,0 +1,181 @@
+#include "Tracer.hpp"
+
+#include <unistd.h>
+#include <chrono>
+#include <functional>
+#include <set>
+
+#include <process/http.hpp>
+#include <process/process.hpp>
+
+#include <stout/json.hpp>
+#include <stout/stringify.hpp>
+
+namespace criteo {
+namespace mesos {
+namespace tracing {
+
+using std::string;
+using std::vector;
+
+const string TRACE_PROCESS_ID = "command-modules";
+
+uint64_t nowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+Tracer& Tracer::instance() {
+  static Tracer tracer;
+  return tracer;
+}
+
+Tracer::Tracer()
+    : m_capacity(DEFAULT_TRACE_BUFFER_SIZE),
+      m_next(0),
+      m_configured(false),
+      m_enabled(true),
+      m_invocations(0) {
+  m_spans.reserve(m_capacity);
+}
+
+void Tracer::setCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  resize(capacity);
+}
+
+void Tracer::requestCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_configured || capacity > m_capacity) resize(capacity);
+}
+
+void Tracer::resize(size_t capacity) {
+  m_spans.clear();
+  m_spans.shrink_to_fit();
+  m_spans.reserve(capacity);
+  m_capacity = capacity;
+  m_next = 0;
+  m_configured = true;
+  m_enabled = capacity > 0;
+}
+
+void Tracer::record(const char* name, const logging::Metadata& metadata,
+                    uint64_t invocation, uint64_t start, uint64_t end) {
+  if (!enabled()) return;
+
+  Span span = {name,       metadata.taskId, metadata.method,
+               invocation, start,           end > start ? end - start : 0};
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_capacity == 0) return;
+  if (m_spans.size() < m_capacity) {
+    m_spans.push_back(std::move(span));
+  } else {
+    m_spans[m_next] = std::move(span);
+  }
+  m_next = (m_next + 1) % m_capacity;
+}
+
+vector<Span> Tracer::spans() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_spans.size() < m_capacity) return m_spans;
+
+  vector<Span> ordered;
+  ordered.reserve(m_spans.size());
+  ordered.insert(ordered.end(), m_spans.begin() + m_next, m_spans.end());
+  ordered.insert(ordered.end(), m_spans.begin(), m_spans.begin() + m_next);
+  return ordered;
+}
+
+string Tracer::chromeTrace() const {
+  const int pid = getpid();
+  std::hash<string> hasher;
+  std::set<string> namedTracks;
+
+  // Each task gets its own track so that concurrent invocations for different
+  // containers do not overlap in the viewer.
+  JSON::Array events;
+  for (const Span& span : spans()) {
+    int tid = static_cast<int>(hasher(span.taskId) % 0x7fffffff);
+
+    if (namedTracks.insert(span.taskId).second) {
+      JSON::Object args;
+      args.values["name"] = span.taskId;
+
+      JSON::Object track;
+      track.values["name"] = "thread_name";
+      track.values["ph"] = "M";
+      track.values["pid"] = pid;
+      track.values["tid"] = tid;
+      track.values["args"] = args;
+      events.values.push_back(track);
+    }
+
+    JSON::Object args;
+    args.values["invocation"] = span.invocation;
+
+    JSON::Object event;
+    event.values["name"] = span.name;
+    event.values["cat"] = span.method;
+    event.values["ph"] = "X";
+    event.values["ts"] = span.start;
+    event.values["dur"] = span.duration;
+    event.values["pid"] = pid;
+    event.values["tid"] = tid;
+    event.values["args"] = args;
+    events.values.push_back(event);
+  }
+
+  JSON::Object trace;
+  trace.values["traceEvents"] = events;
+  trace.values["displayTimeUnit"] = "ms";
+  return stringify(trace);
+}
+
+ScopedSpan::ScopedSpan(const char* name, const logging::Metadata& metadata,
+                       uint64_t invocation)
+    : m_name(name),
+      m_metadata(metadata),
+      m_invocation(invocation),
+      m_start(0),
+      m_finished(!Tracer::instance().enabled()) {
+  if (!m_finished) m_start = nowMicros();
+}
+
+void ScopedSpan::finish() {
+  if (m_finished) return;
+  m_finished = true;
+  Tracer::instance().record(m_name, m_metadata, m_invocation, m_start,
+                            nowMicros());
+}
+
+/*
+ * Libprocess process serving the content of the tracer over HTTP on the
+ * agent's port.
+ */
+class TraceProcess : public process::Process<TraceProcess> {
+ public:
+  TraceProcess() : ProcessBase(TRACE_PROCESS_ID) {}
+
+ protected:
+  virtual void initialize() {
+    route("/trace",
+          "Returns the latest command invocations as a Chrome trace.",
+          [](const process::http::Request&)
+              -> process::Future<process::http::Response> {
+                process::http::OK response(Tracer::instance().chromeTrace());
+                response.headers["Content-Type"] = "application/json";
+                return response;
+              });
+  }
+};
+
+void serveChromeTrace() {
+  static std::once_flag started;
+  std::call_once(started, []() { process::spawn(new TraceProcess(), true); });
+}
+
+}  // namespace tracing
+}  // namespace mesos
+}  // namespace criteo
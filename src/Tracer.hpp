@@ -0,0 +1,131 @@
+#ifndef __TRACER_HPP__
+#define __TRACER_HPP__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+
+namespace criteo {
+namespace mesos {
+namespace tracing {
+
+// Number of spans kept in memory if the user does not override it in
+// configuration.
+const size_t DEFAULT_TRACE_BUFFER_SIZE = 4096;
+
+/**
+ * @brief A Span is one timed phase of a command invocation, e.g., the spawn of
+ * the child process or the parsing of its output.
+ */
+struct Span {
+  // Phase names are always string literals so they are not copied.
+  const char* name;
+  std::string taskId;
+  std::string method;
+  uint64_t invocation;
+  // Microseconds since epoch.
+  uint64_t start;
+  uint64_t duration;
+};
+
+/**
+ * @brief The Tracer keeps the most recent spans of all modules loaded in the
+ * agent in a bounded buffer and exports them in the Chrome trace format so
+ * that they can be opened in chrome://tracing or Perfetto.
+ */
+class Tracer {
+ public:
+  static Tracer& instance();
+
+  /**
+   * Resize the buffer. Existing spans are dropped.
+   * @param capacity The maximum number of spans kept, 0 disables tracing.
+   */
+  void setCapacity(size_t capacity);
+
+  /**
+   * Grow the buffer so that it holds at least the given number of spans. The
+   * buffer is shared by all the modules of the agent, so it is sized after
+   * the largest capacity requested by any of them.
+   * @param capacity The number of spans wanted by a module, 0 if it does not
+   * trace anything.
+   */
+  void requestCapacity(size_t capacity);
+
+  inline bool enabled() const { return m_enabled.load(); }
+
+  /**
+   * @return A new identifier grouping the spans of one invocation.
+   */
+  inline uint64_t nextInvocation() { return ++m_invocations; }
+
+  void record(const char* name, const logging::Metadata& metadata,
+              uint64_t invocation, uint64_t start, uint64_t end);
+
+  /**
+   * @return The recorded spans, oldest first.
+   */
+  std::vector<Span> spans() const;
+
+  /**
+   * @return The recorded spans serialized as a Chrome trace JSON document.
+   */
+  std::string chromeTrace() const;
+
+ private:
+  Tracer();
+
+  // Must be called with m_mutex held.
+  void resize(size_t capacity);
+
+  mutable std::mutex m_mutex;
+  std::vector<Span> m_spans;
+  size_t m_capacity;
+  size_t m_next;
+  // Whether the capacity has been set, the default one is not a request.
+  bool m_configured;
+  std::atomic<bool> m_enabled;
+  std::atomic<uint64_t> m_invocations;
+};
+
+/**
+ * @return The current time in microseconds since epoch.
+ */
+uint64_t nowMicros();
+
+/**
+ * Record a span covering the lifetime of the object or ending at the first
+ * call to finish().
+ */
+class ScopedSpan {
+ public:
+  ScopedSpan(const char* name, const logging::Metadata& metadata,
+             uint64_t invocation = 0);
+  ~ScopedSpan() { finish(); }
+
+  void finish();
+
+ private:
+  const char* m_name;
+  const logging::Metadata& m_metadata;
+  uint64_t m_invocation;
+  uint64_t m_start;
+  bool m_finished;
+};
+
+/**
+ * Expose the Chrome trace on the /command-modules/trace endpoint of the agent.
+ * Calling this function several times only starts the endpoint once.
+ */
+void serveChromeTrace();
+
+}  // namespace tracing
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __TRACER_HPP__
@@ -0,0 +1,419 @@
+#include "UnixSocketBackend.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <vector>
+
+#include <stout/error.hpp>
+#include <stout/strings.hpp>
+
+namespace criteo {
+namespace mesos {
+
+using std::string;
+
+// Size of the length and id fields starting every frame.
+const size_t FRAME_HEADER_SIZE = 12;
+
+// Interval between two attempts to connect to a daemon whose backlog is full.
+const std::chrono::milliseconds CONNECT_RETRY_INTERVAL(10);
+
+static void appendUint32(string& buffer, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    buffer.push_back(static_cast<char>((value >> shift) & 0xff));
+  }
+}
+
+static void appendUint64(string& buffer, uint64_t value) {
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    buffer.push_back(static_cast<char>((value >> shift) & 0xff));
+  }
+}
+
+static uint64_t readUint(const char* data, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value = (value << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return value;
+}
+
+bool UnixSocketBackend::handles(const string& command) {
+  return strings::startsWith(command, UNIX_SOCKET_SCHEME);
+}
+
+std::shared_ptr<UnixSocketBackend> UnixSocketBackend::get(
+    const string& command) {
+  static std::mutex mutex;
+  static std::map<string, std::shared_ptr<UnixSocketBackend>> backends;
+
+  string path = command.substr(UNIX_SOCKET_SCHEME.size());
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = backends.find(path);
+  if (it != backends.end()) return it->second;
+
+  std::shared_ptr<UnixSocketBackend> backend(
+      new UnixSocketBackend(path, DEFAULT_SOCKET_CONNECTIONS));
+  backends[path] = backend;
+  return backend;
+}
+
+UnixSocketBackend::UnixSocketBackend(const string& path, size_t connections)
+    : m_path(path),
+      m_maxConnections(std::max<size_t>(connections, 1)),
+      m_nextId(0),
+      m_stopped(false) {
+  if (pipe2(m_wakeup, O_CLOEXEC | O_NONBLOCK) == -1) {
+    m_wakeup[0] = m_wakeup[1] = -1;
+  }
+  m_thread = std::thread(&UnixSocketBackend::run, this);
+}
+
+UnixSocketBackend::~UnixSocketBackend() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+  if (m_wakeup[1] != -1) (void)::write(m_wakeup[1], "x", 1);
+  m_thread.join();
+  if (m_wakeup[0] != -1) ::close(m_wakeup[0]);
+  if (m_wakeup[1] != -1) ::close(m_wakeup[1]);
+}
+
+void UnixSocketBackend::send(const string& method, const string& input,
+                             const Duration& timeout,
+                             const Callback& callback) {
+  if (m_wakeup[0] == -1) {
+    callback(Error("Unable to set up the connections to " + m_path));
+    return;
+  }
+  if (method.size() > 255 ||
+      input.size() + method.size() + 9 > MAX_FRAME_SIZE) {
+    callback(Error("Request to " + m_path + " is too large"));
+    return;
+  }
+
+  Request request;
+  request.deadline = Clock::now() + std::chrono::nanoseconds(timeout.ns());
+  request.callback = callback;
+
+  // The id is filled once allocated.
+  string& frame = request.frame;
+  frame.reserve(FRAME_HEADER_SIZE + 1 + method.size() + input.size());
+  appendUint32(frame, 8 + 1 + method.size() + input.size());
+  appendUint64(frame, 0);
+  frame.push_back(static_cast<char>(method.size()));
+  frame.append(method);
+  frame.append(input);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_stopped) {
+      request.id = ++m_nextId;
+      string id;
+      appendUint64(id, request.id);
+      frame.replace(4, 8, id);
+      m_queue.push_back(std::move(request));
+      (void)::write(m_wakeup[1], "x", 1);
+      return;
+    }
+  }
+  callback(Error("Connection to " + m_path + " was shut down"));
+}
+
+Try<string> UnixSocketBackend::call(const string& method, const string& input,
+                                    const Duration& timeout) {
+  std::mutex mutex;
+  std::condition_variable done;
+  Option<Try<string>> result;
+
+  send(method, input, timeout, [&](const Try<string>& output) {
+    std::lock_guard<std::mutex> lock(mutex);
+    result = output;
+    done.notify_one();
+  });
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&]() { return result.isSome(); });
+  return result.get();
+}
+
+/*
+ * Open a socket to the daemon without blocking the I/O thread: a connection
+ * refused because the backlog of the daemon is full is retried by the I/O
+ * loop rather than waited for.
+ */
+Try<int> UnixSocketBackend::connect() {
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd == -1) return ErrnoError("Failed to create socket");
+
+  Try<bool> connected = resumeConnect(fd);
+  if (connected.isError()) {
+    ::close(fd);
+    return Error(connected.error());
+  }
+
+  Connection& connection = m_connections[fd];
+  connection.inFlight = 0;
+  connection.connected = connected.get();
+  return fd;
+}
+
+/*
+ * @return true once the socket is connected, false while the daemon cannot
+ * accept it yet.
+ */
+Try<bool> UnixSocketBackend::resumeConnect(int fd) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (m_path.size() >= sizeof(address.sun_path)) {
+    return Error("Socket path " + m_path + " is too long");
+  }
+  memcpy(address.sun_path, m_path.data(), m_path.size());
+
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&address),
+                sizeof(address)) == 0 ||
+      errno == EISCONN) {
+    return true;
+  }
+  if (errno == EAGAIN || errno == EINPROGRESS || errno == EALREADY ||
+      errno == EINTR) {
+    return false;
+  }
+  return ErrnoError("Failed to connect to " + m_path);
+}
+
+void UnixSocketBackend::dispatch(Request&& request) {
+  // Pipeline the request on the least busy connection, preferably an
+  // established one, a new one is opened only if all of them are busy.
+  auto least = m_connections.end();
+  for (auto it = m_connections.begin(); it != m_connections.end(); ++it) {
+    if (least == m_connections.end() ||
+        std::make_pair(!it->second.connected, it->second.inFlight) <
+            std::make_pair(!least->second.connected, least->second.inFlight)) {
+      least = it;
+    }
+  }
+
+  if (least == m_connections.end() ||
+      (least->second.inFlight > 0 &&
+       m_connections.size() < m_maxConnections)) {
+    Try<int> fd = connect();
+    if (fd.isSome()) {
+      least = m_connections.find(fd.get());
+    } else if (least == m_connections.end()) {
+      request.callback(Error(fd.error()));
+      return;
+    }
+  }
+
+  least->second.output.append(request.frame);
+  least->second.inFlight++;
+  Pending pending = {least->first, request.deadline,
+                     std::move(request.callback)};
+  m_pending.emplace(request.id, std::move(pending));
+}
+
+bool UnixSocketBackend::flush(int fd, Connection& connection) {
+  while (!connection.output.empty()) {
+    ssize_t written = ::send(fd, connection.output.data(),
+                             connection.output.size(), MSG_NOSIGNAL);
+    if (written == -1) {
+      if (errno == EINTR) continue;
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    connection.output.erase(0, written);
+  }
+  return true;
+}
+
+bool UnixSocketBackend::receive(int fd, Connection& connection) {
+  char buffer[65536];
+  while (true) {
+    ssize_t size = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (size == 0) return false;
+    if (size == -1) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+      break;
+    }
+    connection.input.append(buffer, size);
+  }
+
+  size_t offset = 0;
+  while (connection.input.size() - offset >= FRAME_HEADER_SIZE + 1) {
+    const char* frame = connection.input.data() + offset;
+    uint32_t length = readUint(frame, 4);
+    if (length < 9 || length > MAX_FRAME_SIZE) return false;
+    if (connection.input.size() - offset < 4 + length) break;
+
+    uint64_t id = readUint(frame + 4, 8);
+    uint8_t status = frame[FRAME_HEADER_SIZE];
+    string payload(frame + FRAME_HEADER_SIZE + 1, length - 9);
+    offset += 4 + length;
+
+    if (m_pending.count(id) && m_pending[id].fd == fd) {
+      connection.inFlight--;
+      if (status == FRAME_STATUS_OK) {
+        complete(id, payload);
+      } else {
+        complete(id, Error("Daemon " + m_path + " failed: " + payload));
+      }
+    }
+  }
+  connection.input.erase(0, offset);
+  return true;
+}
+
+void UnixSocketBackend::complete(uint64_t id, const Try<string>& output) {
+  auto it = m_pending.find(id);
+  if (it == m_pending.end()) return;
+  Callback callback = std::move(it->second.callback);
+  m_pending.erase(it);
+  callback(output);
+}
+
+void UnixSocketBackend::close(int fd, const string& reason) {
+  std::vector<uint64_t> failed;
+  for (const auto& pending : m_pending) {
+    if (pending.second.fd == fd) failed.push_back(pending.first);
+  }
+  for (uint64_t id : failed) {
+    complete(id, Error("Connection to " + m_path + " " + reason));
+  }
+  m_connections.erase(fd);
+  ::close(fd);
+}
+
+void UnixSocketBackend::expire() {
+  Clock::time_point now = Clock::now();
+  std::vector<uint64_t> expired;
+  for (const auto& pending : m_pending) {
+    if (pending.second.deadline <= now) expired.push_back(pending.first);
+  }
+  // The connection stays usable, a late response is simply dropped.
+  for (uint64_t id : expired) {
+    auto connection = m_connections.find(m_pending[id].fd);
+    if (connection != m_connections.end()) connection->second.inFlight--;
+    complete(id, Error("Daemon " + m_path + " took too long to answer."));
+  }
+}
+
+void UnixSocketBackend::run() {
+  std::vector<struct pollfd> fds;
+  while (true) {
+    std::deque<Request> queue;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_stopped) break;
+      queue.swap(m_queue);
+    }
+    for (Request& request : queue) dispatch(std::move(request));
+
+    // The requests of a connection which cannot be established time out, it
+    // is given up once none of them is left.
+    bool connecting = false;
+    std::vector<int> unreachable;
+    std::vector<int> broken;
+    for (auto& connection : m_connections) {
+      if (!connection.second.connected) {
+        Try<bool> connected = connection.second.inFlight == 0
+                                  ? Try<bool>(Error("No request left"))
+                                  : resumeConnect(connection.first);
+        if (connected.isError()) {
+          unreachable.push_back(connection.first);
+          continue;
+        }
+        connection.second.connected = connected.get();
+        if (!connected.get()) {
+          connecting = true;
+          continue;
+        }
+      }
+      if (!flush(connection.first, connection.second)) {
+        broken.push_back(connection.first);
+      }
+    }
+    for (int fd : unreachable) close(fd, "could not be established");
+    for (int fd : broken) close(fd, "failed");
+
+    // An unconnected socket is reported as hung up, only the established
+    // connections are polled.
+    fds.clear();
+    fds.push_back({m_wakeup[0], POLLIN, 0});
+    for (const auto& connection : m_connections) {
+      if (!connection.second.connected) continue;
+      short events = POLLIN;
+      if (!connection.second.output.empty()) events |= POLLOUT;
+      fds.push_back({connection.first, events, 0});
+    }
+
+    int timeout = -1;
+    if (!m_pending.empty()) {
+      Clock::time_point deadline = Clock::time_point::max();
+      for (const auto& pending : m_pending) {
+        deadline = std::min(deadline, pending.second.deadline);
+      }
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - Clock::now());
+      timeout = std::max<int64_t>(remaining.count() + 1, 0);
+    }
+    int retry = static_cast<int>(CONNECT_RETRY_INTERVAL.count());
+    if (connecting && (timeout == -1 || timeout > retry)) timeout = retry;
+
+    if (::poll(fds.data(), fds.size(), timeout) == -1 && errno != EINTR) {
+      break;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      char buffer[64];
+      while (::read(m_wakeup[0], buffer, sizeof(buffer)) > 0) {
+      }
+    }
+
+    for (size_t i = 1; i < fds.size(); ++i) {
+      int fd = fds[i].fd;
+      auto connection = m_connections.find(fd);
+      if (connection == m_connections.end()) continue;
+
+      if ((fds[i].revents & POLLIN) && !receive(fd, connection->second)) {
+        close(fd, "was closed");
+      } else if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        close(fd, "was lost");
+      } else if ((fds[i].revents & POLLOUT) &&
+                 !flush(fd, connection->second)) {
+        close(fd, "failed");
+      }
+    }
+
+    expire();
+  }
+
+  std::vector<int> connections;
+  for (const auto& connection : m_connections) {
+    connections.push_back(connection.first);
+  }
+  for (int fd : connections) close(fd, "was shut down");
+
+  std::deque<Request> queue;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+    queue.swap(m_queue);
+  }
+  for (Request& request : queue) {
+    request.callback(Error("Connection to " + m_path + " was shut down"));
+  }
+}
+
+}  // namespace mesos
+}  // namespace criteo
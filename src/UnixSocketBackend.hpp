@@ -0,0 +1,154 @@
+#ifndef __UNIX_SOCKET_BACKEND_HPP__
+#define __UNIX_SOCKET_BACKEND_HPP__
+
+#include <stdint.h>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <stout/duration.hpp>
+#include <stout/try.hpp>
+
+namespace criteo {
+namespace mesos {
+
+// Prefix of the commands served by a daemon listening on a unix socket.
+const std::string UNIX_SOCKET_SCHEME = "unix://";
+
+// Maximum number of connections opened to a daemon.
+const size_t DEFAULT_SOCKET_CONNECTIONS = 4;
+
+// Larger frames are considered corrupted.
+const uint32_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+// Status of a response frame.
+const uint8_t FRAME_STATUS_OK = 0;
+const uint8_t FRAME_STATUS_ERROR = 1;
+
+/**
+ * @brief The UnixSocketBackend sends the invocations of a command configured
+ * as `unix://<path>` to a long-lived daemon listening on that socket instead
+ * of forking a process.
+ *
+ * Every frame starts with its length and the id of the invocation, both big
+ * endian, the length covering everything after itself:
+ *
+ *   request:  length:u32 id:u64 method_length:u8 method input
+ *   response: length:u32 id:u64 status:u8 output
+ *
+ * `method` is the event being handled, e.g. "prepare", and `input` the same
+ * JSON as the one given to the commands. A response with status 0 carries the
+ * output of the command, any other status an error message. Requests are
+ * pipelined over a small pool of connections and a daemon may answer them in
+ * any order.
+ */
+class UnixSocketBackend {
+ public:
+  typedef std::function<void(const Try<std::string>&)> Callback;
+
+  /**
+   * @return true if the command is served by a daemon.
+   */
+  static bool handles(const std::string& command);
+
+  /**
+   * @return The backend shared by all the commands served by the daemon of a
+   *   `unix://<path>` command.
+   */
+  static std::shared_ptr<UnixSocketBackend> get(const std::string& command);
+
+  /**
+   * @param path The path of the socket of the daemon.
+   * @param connections The maximum number of connections to the daemon.
+   */
+  UnixSocketBackend(const std::string& path, size_t connections);
+
+  /**
+   * Stop the I/O thread, failing the pending invocations.
+   */
+  ~UnixSocketBackend();
+
+  /**
+   * Send an invocation to the daemon. The callback runs on the I/O thread of
+   * the backend, it must not block.
+   *
+   * @param method The event being handled.
+   * @param input The serialized input of the command.
+   * @param timeout The time the daemon has to answer.
+   * @param callback Called with the output of the command or an error.
+   */
+  void send(const std::string& method, const std::string& input,
+            const Duration& timeout, const Callback& callback);
+
+  /**
+   * Send an invocation and wait for its output.
+   */
+  Try<std::string> call(const std::string& method, const std::string& input,
+                        const Duration& timeout);
+
+  inline const std::string& path() const { return m_path; }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Request {
+    uint64_t id;
+    std::string frame;
+    Clock::time_point deadline;
+    Callback callback;
+  };
+
+  struct Pending {
+    int fd;
+    Clock::time_point deadline;
+    Callback callback;
+  };
+
+  struct Connection {
+    // Frames waiting to be written and the number of bytes already written
+    // of the first one.
+    std::string output;
+    // Bytes read and not yet parsed.
+    std::string input;
+    size_t inFlight;
+    // Unset while the backlog of the daemon is full, the connection is then
+    // retried by the I/O loop.
+    bool connected;
+  };
+
+  void run();
+  void dispatch(Request&& request);
+  Try<int> connect();
+  Try<bool> resumeConnect(int fd);
+  bool flush(int fd, Connection& connection);
+  bool receive(int fd, Connection& connection);
+  void complete(uint64_t id, const Try<std::string>& output);
+  void close(int fd, const std::string& reason);
+  void expire();
+
+  const std::string m_path;
+  const size_t m_maxConnections;
+
+  std::mutex m_mutex;
+  std::deque<Request> m_queue;
+  uint64_t m_nextId;
+  bool m_stopped;
+  // Written to wake the I/O thread up.
+  int m_wakeup[2];
+
+  // State of the I/O thread.
+  std::map<int, Connection> m_connections;
+  std::map<uint64_t, Pending> m_pending;
+  std::thread m_thread;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __UNIX_SOCKET_BACKEND_HPP__
@@ -0,0 +1,149 @@
+#include "WatchScheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace criteo {
+namespace mesos {
+
+using std::string;
+
+// Number of slots of the timer wheel, deadlines further than a turn of the
+// wheel wait for their remaining rounds.
+const size_t WHEEL_SIZE = 512;
+
+WatchScheduler::WatchScheduler(size_t workers, const Duration& tick)
+    : m_tick(tick),
+      m_wheel(WHEEL_SIZE),
+      m_cursor(0),
+      m_nextId(0),
+      m_stopped(false),
+      m_random(std::random_device()()) {
+  m_timer = std::thread(&WatchScheduler::runTimer, this);
+  for (size_t i = 0; i < std::max<size_t>(workers, 1); ++i) {
+    m_workers.push_back(std::thread(&WatchScheduler::runWorker, this));
+  }
+}
+
+WatchScheduler::~WatchScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+  m_timerCondition.notify_all();
+  m_readyCondition.notify_all();
+  m_timer.join();
+  for (std::thread& worker : m_workers) worker.join();
+}
+
+void WatchScheduler::schedule(const string& key, const Duration& interval,
+                              const Check& check) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::uniform_int_distribution<int64_t> jitter(
+      0, std::max<int64_t>(interval.ns() - 1, 0));
+  Entry entry = {m_nextId++, key, check, 0};
+  m_active[entry.id] = key;
+  insert(std::move(entry), Nanoseconds(jitter(m_random)));
+}
+
+void WatchScheduler::unschedule(const string& key) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto it = m_active.begin(); it != m_active.end();) {
+    it = it->second == key ? m_active.erase(it) : std::next(it);
+  }
+  for (std::list<Entry>& slot : m_wheel) {
+    slot.remove_if([&key](const Entry& entry) { return entry.key == key; });
+  }
+}
+
+size_t WatchScheduler::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_active.size();
+}
+
+void WatchScheduler::insert(Entry&& entry, const Duration& delay) {
+  uint64_t ticks = std::max<int64_t>(
+      (delay.ns() + m_tick.ns() - 1) / m_tick.ns(), 1);
+  entry.rounds = (ticks - 1) / WHEEL_SIZE;
+  m_wheel[(m_cursor + ticks) % WHEEL_SIZE].push_back(std::move(entry));
+}
+
+void WatchScheduler::advance() {
+  m_cursor = (m_cursor + 1) % WHEEL_SIZE;
+  std::list<Entry>& slot = m_wheel[m_cursor];
+  for (auto it = slot.begin(); it != slot.end();) {
+    if (it->rounds > 0) {
+      --it->rounds;
+      ++it;
+    } else {
+      m_ready.push_back(std::move(*it));
+      it = slot.erase(it);
+    }
+  }
+}
+
+void WatchScheduler::runTimer() {
+  std::chrono::nanoseconds tick(m_tick.ns());
+  std::chrono::steady_clock::time_point next =
+      std::chrono::steady_clock::now() + tick;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stopped) {
+    m_timerCondition.wait_until(lock, next);
+    if (m_stopped) break;
+
+    // Catch up on the ticks missed if the thread has been delayed.
+    size_t due = m_ready.size();
+    while (next <= std::chrono::steady_clock::now()) {
+      advance();
+      next += tick;
+    }
+    if (m_ready.size() > due) m_readyCondition.notify_all();
+  }
+}
+
+void WatchScheduler::runWorker() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_readyCondition.wait(lock,
+                          [this]() { return m_stopped || !m_ready.empty(); });
+    if (m_stopped) break;
+
+    Entry entry = std::move(m_ready.front());
+    m_ready.pop_front();
+    if (m_active.count(entry.id) == 0) continue;
+
+    lock.unlock();
+    Option<Duration> delay = entry.check();
+    lock.lock();
+
+    if (m_active.count(entry.id) == 0) continue;
+    if (delay.isSome()) {
+      insert(std::move(entry), delay.get());
+    } else {
+      m_active.erase(entry.id);
+    }
+  }
+}
+
+AdaptiveInterval::AdaptiveInterval(const Duration& initial,
+                                   const Duration& min, const Duration& max)
+    : m_min(min),
+      m_max(std::max(min, max)),
+      m_current(std::min(std::max(initial, m_min), m_max)) {}
+
+Duration AdaptiveInterval::next(const Option<double>& pressure) {
+  double level =
+      pressure.isSome() ? std::min(std::max(pressure.get(), 0.0), 1.0) : 0.0;
+  Duration target = m_min + (m_max - m_min) * (1.0 - level);
+
+  if (target < m_current || m_current == Duration::zero()) {
+    m_current = target;
+  } else {
+    m_current = std::min(m_current * 2, target);
+  }
+  return m_current;
+}
+
+}  // namespace mesos
+}  // namespace criteo
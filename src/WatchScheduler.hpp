@@ -0,0 +1,142 @@
+#ifndef __WATCH_SCHEDULER_HPP__
+#define __WATCH_SCHEDULER_HPP__
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stout/duration.hpp>
+#include <stout/option.hpp>
+
+namespace criteo {
+namespace mesos {
+
+// Number of threads running the watch checks of a module if the user does
+// not override it in configuration.
+const size_t DEFAULT_WATCH_WORKERS = 4;
+
+/**
+ * @brief The WatchScheduler runs the recurrent watch checks of all the
+ * containers of a module. Deadlines are kept in a timer wheel driven by a
+ * single thread and the checks run on a bounded pool of worker threads.
+ */
+class WatchScheduler {
+ public:
+  /**
+   * A check returns the delay before its next run, or None to stop.
+   */
+  typedef std::function<Option<Duration>()> Check;
+
+  /**
+   * @param workers The number of threads running the checks.
+   * @param tick The resolution of the timer wheel.
+   */
+  explicit WatchScheduler(size_t workers,
+                          const Duration& tick = Milliseconds(10));
+
+  /**
+   * Stop the threads, waiting for the running checks to complete.
+   */
+  ~WatchScheduler();
+
+  /**
+   * Schedule a recurrent check. Its first run happens after a random delay
+   * within the interval so that containers started together are not checked
+   * in lock-step.
+   *
+   * @param key The key the check can be unscheduled with, several checks can
+   *   share the same key.
+   * @param interval The interval used to spread the first run.
+   * @param check The check to run.
+   */
+  void schedule(const std::string& key, const Duration& interval,
+                const Check& check);
+
+  /**
+   * Unschedule all the checks of a key. A running check completes but is not
+   * rescheduled.
+   */
+  void unschedule(const std::string& key);
+
+  /**
+   * @return The number of scheduled checks.
+   */
+  size_t size() const;
+
+ private:
+  struct Entry {
+    uint64_t id;
+    std::string key;
+    Check check;
+    // Number of turns of the wheel before the entry is due.
+    uint64_t rounds;
+  };
+
+  void insert(Entry&& entry, const Duration& delay);
+  void advance();
+  void runTimer();
+  void runWorker();
+
+  const Duration m_tick;
+  std::vector<std::list<Entry>> m_wheel;
+  size_t m_cursor;
+  std::deque<Entry> m_ready;
+  // Key of the scheduled checks, due or running ones included.
+  std::map<uint64_t, std::string> m_active;
+  uint64_t m_nextId;
+  bool m_stopped;
+  std::mt19937_64 m_random;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_timerCondition;
+  std::condition_variable m_readyCondition;
+  std::thread m_timer;
+  std::vector<std::thread> m_workers;
+};
+
+/**
+ * @brief The AdaptiveInterval computes the delay before the next watch check
+ * of a container from the pressure it reports, i.e., how close it is to one of
+ * its limits. The delay tightens at once toward the minimum as the pressure
+ * rises and backs off exponentially toward the maximum while it stays low.
+ */
+class AdaptiveInterval {
+ public:
+  /**
+   * @param initial The delay before the first pressure report.
+   * @param min The delay at full pressure.
+   * @param max The delay without pressure.
+   */
+  AdaptiveInterval(const Duration& initial, const Duration& min,
+                   const Duration& max);
+
+  /**
+   * Update the delay with the result of a check.
+   *
+   * @param pressure The reported pressure between 0 and 1, None if the check
+   *   reported nothing, which counts as no pressure.
+   * @return The delay before the next check.
+   */
+  Duration next(const Option<double>& pressure);
+
+  inline const Duration& current() const { return m_current; }
+
+ private:
+  Duration m_min;
+  Duration m_max;
+  Duration m_current;
+};
+
+}  // namespace mesos
+}  // namespace criteo
+
+#endif  // __WATCH_SCHEDULER_HPP__
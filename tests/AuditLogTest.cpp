@@ -0,0 +1,118 @@
+#include "AuditLog.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+
+using namespace criteo::mesos::audit;
+
+class AuditLogTest : public ::testing::Test {
+ public:
+  void SetUp() {
+    char path[] = "/tmp/audit_log_test_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    m_path = path;
+  }
+
+  void TearDown() { unlink(m_path.c_str()); }
+
+  Record record(const std::string& event, int32_t exitCode) {
+    Record record = Record();
+    copyString(record.event, event);
+    record.exitCode = exitCode;
+    return record;
+  }
+
+  std::string m_path;
+};
+
+TEST_F(AuditLogTest, should_append_records) {
+  Try<std::shared_ptr<AuditLog>> log = AuditLog::open(m_path, 4, "isolator");
+  ASSERT_SOME(log);
+  log.get()->append(record("usage", 0));
+  log.get()->append(record("cleanup", 2));
+
+  ASSERT_EQ(2u, log.get()->size());
+  Record read;
+  ASSERT_TRUE(log.get()->read(1, read));
+  EXPECT_EQ(2u, read.sequence);
+  EXPECT_STREQ("isolator", read.module);
+  EXPECT_STREQ("cleanup", read.event);
+  EXPECT_EQ(2, read.exitCode);
+}
+
+TEST_F(AuditLogTest, should_overwrite_oldest_records) {
+  Try<std::shared_ptr<AuditLog>> log = AuditLog::open(m_path, 2, "isolator");
+  ASSERT_SOME(log);
+  log.get()->append(record("prepare", 0));
+  log.get()->append(record("isolate", 0));
+  log.get()->append(record("usage", 0));
+
+  Record read;
+  EXPECT_FALSE(log.get()->read(0, read));
+  ASSERT_TRUE(log.get()->read(2, read));
+  EXPECT_STREQ("usage", read.event);
+}
+
+TEST_F(AuditLogTest, should_keep_history_when_reopened) {
+  {
+    Try<std::shared_ptr<AuditLog>> log = AuditLog::open(m_path, 4, "hook");
+    ASSERT_SOME(log);
+    log.get()->append(record("slaveRemoveExecutorHook", 0));
+  }
+
+  Try<std::shared_ptr<AuditLog>> log = AuditLog::open(m_path, 4, "hook");
+  ASSERT_SOME(log);
+  EXPECT_EQ(1u, log.get()->size());
+
+  // A different capacity resets the file once nobody maps it.
+  log.get().reset();
+  log = AuditLog::open(m_path, 8, "hook");
+  ASSERT_SOME(log);
+  EXPECT_EQ(0u, log.get()->size());
+  EXPECT_EQ(8u, log.get()->capacity());
+}
+
+TEST_F(AuditLogTest, should_share_the_file_between_modules) {
+  Try<std::shared_ptr<AuditLog>> isolator =
+      AuditLog::open(m_path, 4, "isolator");
+  ASSERT_SOME(isolator);
+  Try<std::shared_ptr<AuditLog>> hook = AuditLog::open(m_path, 4, "hook");
+  ASSERT_SOME(hook);
+
+  isolator.get()->append(record("usage", 0));
+  hook.get()->append(record("slaveRemoveExecutorHook", 0));
+
+  EXPECT_EQ(2u, isolator.get()->size());
+  Record read;
+  ASSERT_TRUE(isolator.get()->read(1, read));
+  EXPECT_STREQ("hook", read.module);
+}
+
+TEST_F(AuditLogTest, should_refuse_another_capacity_while_in_use) {
+  Try<std::shared_ptr<AuditLog>> isolator =
+      AuditLog::open(m_path, 4, "isolator");
+  ASSERT_SOME(isolator);
+  isolator.get()->append(record("usage", 0));
+
+  EXPECT_ERROR(AuditLog::open(m_path, 8, "hook"));
+
+  // The layout and history of the log in use are untouched.
+  EXPECT_EQ(4u, isolator.get()->capacity());
+  isolator.get()->append(record("cleanup", 0));
+  EXPECT_EQ(2u, isolator.get()->size());
+  Record read;
+  ASSERT_TRUE(isolator.get()->read(0, read));
+  EXPECT_STREQ("usage", read.event);
+}
+
+TEST_F(AuditLogTest, should_truncate_long_names) {
+  Record record = Record();
+  copyString(record.event, std::string(100, 'a'));
+  EXPECT_EQ(sizeof(record.event) - 1, strlen(record.event));
+}
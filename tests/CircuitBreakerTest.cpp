@@ -0,0 +1,118 @@
+#include "CircuitBreaker.hpp"
+
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+
+using namespace criteo::mesos;
+
+static CircuitBreakerOptions createOptions() {
+  CircuitBreakerOptions options;
+  options.window = 4;
+  options.failureRate = 0.5;
+  options.slowCallRate = 0.75;
+  options.cooldown = Milliseconds(50);
+  return options;
+}
+
+static void waitForCooldown() {
+  std::this_thread::sleep_for(std::chrono::milliseconds(80));
+}
+
+// Run a call allowed by the breaker and record its outcome.
+static void call(CircuitBreaker& breaker, bool failed, bool slow) {
+  Option<uint64_t> generation = breaker.tryAcquire();
+  ASSERT_SOME(generation);
+  breaker.record(generation.get(), failed, slow);
+}
+
+TEST(CircuitBreakerTest, should_open_when_calls_keep_failing) {
+  CircuitBreaker breaker("command", createOptions());
+
+  call(breaker, true, false);
+  // Less than half of the window is filled.
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.state());
+
+  call(breaker, true, false);
+  EXPECT_EQ(CircuitBreaker::OPEN, breaker.state());
+  EXPECT_NONE(breaker.tryAcquire());
+}
+
+TEST(CircuitBreakerTest, should_stay_closed_below_the_failure_rate) {
+  CircuitBreaker breaker("command", createOptions());
+
+  // One failure in every window of 4 calls.
+  for (int i = 0; i < 10; ++i) {
+    call(breaker, i % 4 == 3, false);
+  }
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.state());
+}
+
+TEST(CircuitBreakerTest, should_open_when_calls_are_slow) {
+  CircuitBreaker breaker("command", createOptions());
+
+  for (int i = 0; i < 2; ++i) {
+    call(breaker, false, true);
+  }
+  EXPECT_EQ(CircuitBreaker::OPEN, breaker.state());
+}
+
+TEST(CircuitBreakerTest, should_close_after_a_successful_trial) {
+  CircuitBreaker breaker("command", createOptions());
+  for (int i = 0; i < 2; ++i) {
+    call(breaker, true, false);
+  }
+  ASSERT_EQ(CircuitBreaker::OPEN, breaker.state());
+
+  waitForCooldown();
+  Option<uint64_t> trial = breaker.tryAcquire();
+  ASSERT_SOME(trial);
+  EXPECT_EQ(CircuitBreaker::HALF_OPEN, breaker.state());
+  // Only one trial at a time.
+  EXPECT_NONE(breaker.tryAcquire());
+
+  breaker.record(trial.get(), false, false);
+  EXPECT_EQ(CircuitBreaker::CLOSED, breaker.state());
+  EXPECT_SOME(breaker.tryAcquire());
+}
+
+TEST(CircuitBreakerTest, should_reopen_after_a_failed_trial) {
+  CircuitBreaker breaker("command", createOptions());
+  for (int i = 0; i < 2; ++i) {
+    call(breaker, true, false);
+  }
+
+  waitForCooldown();
+  call(breaker, true, false);
+  EXPECT_EQ(CircuitBreaker::OPEN, breaker.state());
+  EXPECT_NONE(breaker.tryAcquire());
+}
+
+TEST(CircuitBreakerTest, should_ignore_calls_allowed_before_the_trial) {
+  CircuitBreaker breaker("command", createOptions());
+  Option<uint64_t> stale = breaker.tryAcquire();
+  ASSERT_SOME(stale);
+  for (int i = 0; i < 2; ++i) {
+    call(breaker, true, false);
+  }
+
+  waitForCooldown();
+  Option<uint64_t> trial = breaker.tryAcquire();
+  ASSERT_SOME(trial);
+  // A call started before the breaker opened completes during the trial.
+  breaker.record(stale.get(), false, false);
+  EXPECT_EQ(CircuitBreaker::HALF_OPEN, breaker.state());
+
+  breaker.record(trial.get(), true, false);
+  EXPECT_EQ(CircuitBreaker::OPEN, breaker.state());
+}
+
+TEST(CircuitBreakerTest, should_have_one_breaker_per_executable_and_event) {
+  CircuitBreakers breakers(createOptions());
+
+  EXPECT_EQ(breakers.get("first", "usage"), breakers.get("first", "usage"));
+  EXPECT_NE(breakers.get("first", "usage"), breakers.get("second", "usage"));
+  EXPECT_NE(breakers.get("first", "usage"), breakers.get("first", "watch"));
+}
@@ -1,6 +1,13 @@
 #include "CommandHook.hpp"
 
+#include <stdlib.h>
+#include <unistd.h>
+
 #include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
 
 extern std::string g_resourcesPath;
 
@@ -75,6 +82,23 @@ TEST_F(CommandHookTest, should_run_slaveRemoveExecutorHook_command) {
   hook->slaveRemoveExecutorHook(frameworkInfo, executorInfo);
 }
 
+TEST_F(CommandHookTest,
+       should_concatenate_labels_of_all_slaveRunTaskLabelDecorator_commands) {
+  hook.reset(new CommandHook(
+      Command(g_resourcesPath + "slaveRunTaskLabelDecorator.sh," +
+              g_resourcesPath + "slaveRunTaskLabelDecorator_extra.sh"),
+      None(), None()));
+  auto result = hook->slaveRunTaskLabelDecorator(taskInfo, executorInfo,
+                                                 frameworkInfo, slaveInfo);
+  ASSERT_TRUE(result.isSome());
+  auto labels = result.get();
+  ASSERT_EQ(labels.labels_size(), 3);
+
+  ASSERT_EQ(labels.labels(0).key(), "LABEL_1");
+  ASSERT_EQ(labels.labels(1).key(), "LABEL_2");
+  ASSERT_EQ(labels.labels(2).key(), "LABEL_3");
+}
+
 class UnexistingCommandHookTest : public CommandHookTest {
  public:
   void SetUp() {
@@ -177,3 +201,69 @@ TEST_F(
   auto result = hook->slaveExecutorEnvironmentDecorator(executorInfo);
   ASSERT_TRUE(result.isError());
 }
+
+class LaunchDecoratorCommandHookTest : public CommandHookTest {
+ public:
+  void SetUp() {
+    CommandHookTest::SetUp();
+    Try<std::string> directory = os::mkdtemp("/tmp/launch_decorator_XXXXXX");
+    ASSERT_SOME(directory);
+    m_directory = directory.get();
+    // Written by slaveLaunchDecorator.sh at every invocation.
+    setenv("TEST_CALLS_FILE", path::join(m_directory, "calls").c_str(), 1);
+    executorInfo.mutable_executor_id()->set_value("executor");
+    executorInfo.mutable_framework_id()->set_value("framework");
+    hook.reset(new CommandHook(
+        None(), None(), None(), false, RunnerOptions(),
+        Command(g_resourcesPath + "slaveLaunchDecorator.sh")));
+  }
+
+  void TearDown() {
+    unsetenv("TEST_CALLS_FILE");
+    os::rmdir(m_directory);
+  }
+
+  size_t calls() {
+    Try<std::string> calls = os::read(path::join(m_directory, "calls"));
+    if (calls.isError()) return 0;
+    return strings::tokenize(calls.get(), "\n").size();
+  }
+
+  std::string m_directory;
+};
+
+TEST_F(LaunchDecoratorCommandHookTest,
+       should_answer_environment_hook_from_launch_decoration) {
+  auto labels = hook->slaveRunTaskLabelDecorator(taskInfo, executorInfo,
+                                                 frameworkInfo, slaveInfo);
+  ASSERT_TRUE(labels.isSome());
+  ASSERT_EQ(1, labels->labels_size());
+  EXPECT_EQ("LABEL_1", labels->labels(0).key());
+
+  auto environment = hook->slaveExecutorEnvironmentDecorator(executorInfo);
+  ASSERT_TRUE(environment.isSome());
+  ASSERT_EQ(1, environment->variables_size());
+  EXPECT_EQ("ENV_1", environment->variables(0).name());
+  EXPECT_EQ(1u, calls());
+
+  // The decoration is used once, the next hook runs the command.
+  environment = hook->slaveExecutorEnvironmentDecorator(executorInfo);
+  ASSERT_TRUE(environment.isSome());
+  EXPECT_EQ("ENV_1", environment->variables(0).name());
+  EXPECT_EQ(2u, calls());
+}
+
+TEST_F(LaunchDecoratorCommandHookTest,
+       should_run_launch_decorator_again_once_decoration_expired) {
+  hook.reset(new CommandHook(
+      None(), None(), None(), false, RunnerOptions(),
+      Command(g_resourcesPath + "slaveLaunchDecorator.sh"), Milliseconds(1)));
+  hook->slaveRunTaskLabelDecorator(taskInfo, executorInfo, frameworkInfo,
+                                   slaveInfo);
+  os::sleep(Milliseconds(10));
+
+  auto environment = hook->slaveExecutorEnvironmentDecorator(executorInfo);
+  ASSERT_TRUE(environment.isSome());
+  EXPECT_EQ("ENV_1", environment->variables(0).name());
+  EXPECT_EQ(2u, calls());
+}
@@ -1,8 +1,14 @@
 #include "CommandIsolator.hpp"
+#include "StatisticsChannelWriter.hpp"
 #include "gtest_helpers.hpp"
 
+#include <stdlib.h>
+
 #include <gtest/gtest.h>
 #include <process/gtest.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
 
 extern std::string g_resourcesPath;
 
@@ -371,6 +377,398 @@ TEST_F(EmptyOutputCommandIsolatorTest,
   ASSERT_TRUE(isolator->hasContainerContext(containerId));
 }
 
+class PressureCommandIsolatorTest : public CommandIsolatorTest {
+ public:
+  void SetUp() {
+    CommandIsolatorTest::SetUp();
+    Try<std::string> directory = os::mkdtemp("/tmp/pressure_test_XXXXXX");
+    ASSERT_SOME(directory);
+    m_directory = directory.get();
+    setenv("TEST_CALLS_FILE", path::join(m_directory, "calls").c_str(), 1);
+
+    RecurrentCommand watchCommand(g_resourcesPath + "watch_full_pressure.sh",
+                                  3, 0.5);
+    watchCommand.setMinFrequence(0.05);
+    watchCommand.setMaxFrequence(1);
+    isolator.reset(new CommandIsolator("test", None(), None(), watchCommand,
+                                       None(), None()));
+    CommandIsolatorTest::Prepare();
+  }
+
+  void TearDown() {
+    unsetenv("TEST_CALLS_FILE");
+    os::rmdir(m_directory);
+  }
+
+  size_t calls() {
+    Try<std::string> calls = os::read(path::join(m_directory, "calls"));
+    if (calls.isError()) return 0;
+    return strings::tokenize(calls.get(), "\n").size();
+  }
+
+  std::string m_directory;
+};
+
+TEST_F(PressureCommandIsolatorTest,
+       should_check_more_often_when_watch_command_reports_pressure) {
+  auto future = isolator->watch(containerId);
+  AWAIT_EXPECT_PENDING_FOR(future, Seconds(2));
+  future.discard();
+
+  // The checks would run 4 times at the initial interval of 0.5 second, full
+  // pressure brings the interval down to 0.05 second.
+  EXPECT_LE(12u, calls());
+}
+
+class MultipleCommandIsolatorTest : public CommandIsolatorTest {
+ public:
+  void SetUp() {
+    CommandIsolatorTest::SetUp();
+    isolator.reset(new CommandIsolator(
+        "test",
+        Command(g_resourcesPath + "prepare.sh," + g_resourcesPath +
+                "prepare_environment.sh"),
+        Command(g_resourcesPath + "isolate.sh," + g_resourcesPath + "ok.sh"),
+        RecurrentCommand(g_resourcesPath + "watch_pressure.sh," +
+                             g_resourcesPath + "watch.sh",
+                         3, 0.1),
+        None(),
+        Command(g_resourcesPath + "usage.sh," + g_resourcesPath +
+                "usage_memory.sh")));
+    CommandIsolatorTest::Prepare();
+  }
+};
+
+TEST_F(MultipleCommandIsolatorTest,
+       should_merge_container_launch_info_of_all_prepare_commands) {
+  Option<ContainerLaunchInfo> launchInfo = containerLaunchInfoFuture.get();
+  ASSERT_SOME(launchInfo);
+
+  EXPECT_EQ("/isolated_fs", launchInfo->rootfs());
+  EXPECT_EQ("app_user", launchInfo->user());
+  ASSERT_EQ(1, launchInfo->environment().variables_size());
+  EXPECT_EQ("PREPARED", launchInfo->environment().variables(0).name());
+}
+
+TEST_F(MultipleCommandIsolatorTest, should_run_all_isolate_commands) {
+  AWAIT_READY(isolator->isolate(containerId, pid));
+}
+
+TEST_F(MultipleCommandIsolatorTest,
+       should_report_limitation_of_any_watch_command) {
+  auto containerLimitation = isolator->watch(containerId);
+  AWAIT_READY(containerLimitation);
+  EXPECT_EQ("too much toto", containerLimitation->message());
+}
+
+TEST_F(MultipleCommandIsolatorTest,
+       should_merge_statistics_of_all_usage_commands) {
+  auto resourceStatistics = isolator->usage(containerId);
+  AWAIT_READY(resourceStatistics);
+
+  EXPECT_EQ(5, resourceStatistics->net_snmp_statistics().tcp_stats()
+                   .currestab());
+  EXPECT_EQ(1024u, resourceStatistics->mem_rss_bytes());
+  EXPECT_DOUBLE_EQ(12346, resourceStatistics->timestamp());
+}
+
+class CommandSetsIsolatorTest : public CommandIsolatorTest {
+ public:
+  void SetUp() {
+    CommandIsolatorTest::SetUp();
+    CommandSet main{"main", Command(g_resourcesPath + "prepare.sh"), None(),
+                    None(), None(), Command(g_resourcesPath + "usage.sh")};
+    CommandSet extra{"extra", Command(g_resourcesPath + "prepare_environment.sh"),
+                     None(), RecurrentCommand(g_resourcesPath + "watch.sh", 3, 0.1),
+                     Command(g_resourcesPath + "cleanup.sh"),
+                     Command(g_resourcesPath + "usage_memory.sh")};
+    isolator.reset(new CommandIsolator("test", {main, extra}));
+    CommandIsolatorTest::Prepare();
+  }
+};
+
+TEST_F(CommandSetsIsolatorTest,
+       should_merge_container_launch_info_of_all_command_sets) {
+  Option<ContainerLaunchInfo> launchInfo = containerLaunchInfoFuture.get();
+  ASSERT_SOME(launchInfo);
+
+  EXPECT_EQ("/isolated_fs", launchInfo->rootfs());
+  ASSERT_EQ(1, launchInfo->environment().variables_size());
+  EXPECT_EQ("PREPARED", launchInfo->environment().variables(0).name());
+}
+
+TEST_F(CommandSetsIsolatorTest, should_watch_with_any_command_set) {
+  auto containerLimitation = isolator->watch(containerId);
+  AWAIT_READY(containerLimitation);
+  EXPECT_EQ("too much toto", containerLimitation->message());
+}
+
+TEST_F(CommandSetsIsolatorTest, should_merge_statistics_of_all_command_sets) {
+  auto resourceStatistics = isolator->usage(containerId);
+  AWAIT_READY(resourceStatistics);
+
+  EXPECT_EQ(5, resourceStatistics->net_snmp_statistics().tcp_stats()
+                   .currestab());
+  EXPECT_EQ(1024u, resourceStatistics->mem_rss_bytes());
+}
+
+TEST_F(CommandSetsIsolatorTest, should_expose_all_command_sets) {
+  const std::vector<CommandSet>& commandSets = isolator->commandSets();
+  ASSERT_EQ(2u, commandSets.size());
+  EXPECT_EQ("main", commandSets[0].name);
+  EXPECT_EQ("extra", commandSets[1].name);
+  // The getters of the commands refer to the default set.
+  EXPECT_NONE(isolator->cleanupCommand());
+  EXPECT_SOME(commandSets[1].cleanupCommand);
+}
+
+TEST_F(CommandSetsIsolatorTest, should_share_container_context_across_sets) {
+  // Only the second set has a cleanup command, it still cleans the context
+  // shared by both sets up.
+  EXPECT_TRUE(isolator->hasContainerContext(containerId));
+  ASSERT_SOME(isolator->commandSets()[1].cleanupCommand);
+  AWAIT_READY(isolator->cleanup(containerId));
+  EXPECT_FALSE(isolator->hasContainerContext(containerId));
+}
+
+class RecoveryCommandIsolatorTest : public CommandIsolatorTest {
+ public:
+  void SetUp() {
+    CommandIsolatorTest::SetUp();
+    Try<std::string> directory =
+        os::mkdtemp("/tmp/command_isolator_test_XXXXXX");
+    ASSERT_SOME(directory);
+    m_directory = directory.get();
+    options.stateDir = path::join(m_directory, "state");
+    // Written by the cleanup commands counting their invocations.
+    setenv("TEST_CALLS_FILE", path::join(m_directory, "calls").c_str(), 1);
+    isolator.reset(createIsolator());
+    for (int i = 0; i < 20; ++i) {
+      ContainerID id;
+      id.set_value("container_" + std::to_string(i));
+      AWAIT_READY(isolator->prepare(id, containerConfig));
+      ContainerState state;
+      state.mutable_container_id()->CopyFrom(id);
+      states.push_back(state);
+    }
+    // Simulate an agent restart.
+    isolator.reset(createIsolator());
+  }
+
+  void TearDown() {
+    unsetenv("TEST_CALLS_FILE");
+    os::rmdir(m_directory);
+  }
+
+  CommandIsolator* createIsolator() {
+    return new CommandIsolator("test", None(), None(), None(), cleanupCommand,
+                               Command(g_resourcesPath + "usage.sh"), false,
+                               RunnerOptions(), options);
+  }
+
+  std::string m_directory;
+  IsolatorOptions options;
+  Option<Command> cleanupCommand;
+  std::vector<ContainerState> states;
+};
+
+TEST_F(RecoveryCommandIsolatorTest, should_recover_containers_in_parallel) {
+  options.recoveryWorkers = 4;
+  isolator.reset(createIsolator());
+  AWAIT_READY(isolator->recover(states, hashset<ContainerID>()));
+
+  for (const ContainerState& state : states) {
+    EXPECT_TRUE(isolator->hasContainerContext(state.container_id()));
+  }
+  AWAIT_READY(isolator->usage(states.back().container_id()));
+}
+
+TEST_F(RecoveryCommandIsolatorTest,
+       should_restore_context_on_first_use_when_lazy) {
+  options.lazyRecovery = true;
+  isolator.reset(createIsolator());
+  AWAIT_READY(isolator->recover(states, hashset<ContainerID>()));
+
+  for (const ContainerState& state : states) {
+    EXPECT_TRUE(isolator->hasContainerContext(state.container_id()));
+  }
+  auto stats = isolator->usage(states.front().container_id());
+  AWAIT_READY(stats);
+  EXPECT_EQ(5, stats->net_snmp_statistics().tcp_stats().currestab());
+
+  AWAIT_READY(isolator->cleanup(states.front().container_id()));
+  EXPECT_FALSE(isolator->hasContainerContext(states.front().container_id()));
+}
+
+TEST_F(RecoveryCommandIsolatorTest, should_clean_up_orphans_in_background) {
+  cleanupCommand = Command(g_resourcesPath + "sleep.sh");
+  options.orphanCleanupConcurrency = 10;
+  isolator.reset(createIsolator());
+  hashset<ContainerID> orphans;
+  for (const ContainerState& state : states) {
+    orphans.insert(state.container_id());
+  }
+
+  // Recovery does not wait for the cleanup commands, which take 1 second.
+  auto recovered = isolator->recover({}, orphans);
+  AWAIT_READY_FOR(recovered, Milliseconds(500));
+
+  // 20 orphans cleaned up 10 at a time take about 2 seconds.
+  const std::string contextDir = path::join(options.stateDir, "test");
+  for (int i = 0; i < 100 && !os::ls(contextDir)->empty(); ++i) {
+    os::sleep(Milliseconds(100));
+  }
+  EXPECT_TRUE(os::ls(contextDir)->empty());
+}
+
+TEST_F(RecoveryCommandIsolatorTest,
+       should_run_cleanup_command_of_orphans_once) {
+  cleanupCommand = Command(g_resourcesPath + "count_cleanup.sh");
+  options.orphanCleanupConcurrency = 1;
+  isolator.reset(createIsolator());
+  hashset<ContainerID> orphans;
+  orphans.insert(states[0].container_id());
+  orphans.insert(states[1].container_id());
+  AWAIT_READY(isolator->recover({}, orphans));
+
+  // Mesos cleans up the orphans too, one is being cleaned up in the
+  // background and the other one waits for it.
+  const std::string contextDir = path::join(options.stateDir, "test");
+  for (const ContainerID& orphan : orphans) {
+    AWAIT_READY_FOR(isolator->cleanup(orphan), Seconds(5));
+    EXPECT_FALSE(os::exists(path::join(contextDir, orphan.value())));
+  }
+  EXPECT_SOME_EQ("called\ncalled\n",
+                 os::read(path::join(m_directory, "calls")));
+}
+
+TEST_F(RecoveryCommandIsolatorTest, should_skip_missing_context_when_lazy) {
+  options.lazyRecovery = true;
+  isolator.reset(createIsolator());
+  ContainerState unknown;
+  unknown.mutable_container_id()->set_value("unknown");
+  AWAIT_READY(isolator->recover({unknown}, hashset<ContainerID>()));
+
+  AWAIT_FAILED(isolator->usage(unknown.container_id()));
+}
+
+class RefreshedUsageCommandIsolatorTest : public CommandIsolatorTest {
+ public:
+  void SetUp() {
+    CommandIsolatorTest::SetUp();
+    IsolatorOptions isolatorOptions;
+    isolatorOptions.usageRefreshInterval = Milliseconds(100);
+    isolatorOptions.usageRefreshConcurrency = 2;
+    isolator.reset(new CommandIsolator(
+        "test", None(), None(), None(), None(),
+        Command(g_resourcesPath + "usage.sh"), false, RunnerOptions(),
+        isolatorOptions));
+    CommandIsolatorTest::Prepare();
+  }
+};
+
+TEST_F(RefreshedUsageCommandIsolatorTest,
+       should_serve_usage_snapshot_refreshed_in_background) {
+  Duration waited = Duration::zero();
+  ::mesos::ResourceStatistics stats;
+  do {
+    auto resourceStatistics = isolator->usage(containerId);
+    AWAIT_READY(resourceStatistics);
+    stats = resourceStatistics.get();
+    os::sleep(Milliseconds(50));
+    waited += Milliseconds(50);
+  } while (!stats.has_net_snmp_statistics() && waited < Seconds(5));
+
+  EXPECT_EQ(5, stats.net_snmp_statistics().tcp_stats().currestab());
+}
+
+TEST_F(RefreshedUsageCommandIsolatorTest,
+       should_forget_usage_snapshot_on_cleanup) {
+  AWAIT_READY(isolator->cleanup(containerId));
+  AWAIT_FAILED(isolator->usage(containerId));
+}
+
+class PublishedUsageCommandIsolatorTest : public CommandIsolatorTest {
+ public:
+  void SetUp() {
+    CommandIsolatorTest::SetUp();
+    Try<std::string> directory = os::mkdtemp("/tmp/published_usage_XXXXXX");
+    ASSERT_SOME(directory);
+    m_directory = directory.get();
+
+    IsolatorOptions isolatorOptions;
+    isolatorOptions.usageSourceDir = m_directory;
+    isolator.reset(new CommandIsolator(
+        "test", None(), None(), None(), None(),
+        Command(g_resourcesPath + "usage.sh"), false, RunnerOptions(),
+        isolatorOptions));
+    CommandIsolatorTest::Prepare();
+  }
+
+  void TearDown() { os::rmdir(m_directory); }
+
+  std::string m_directory;
+};
+
+TEST_F(PublishedUsageCommandIsolatorTest,
+       should_serve_published_statistics_before_running_usage_command) {
+  ASSERT_SOME(os::write(path::join(m_directory, containerId.value() + ".json"),
+                        "{\"timestamp\": 12, \"mem_rss_bytes\": 1024}"));
+
+  auto resourceStatistics = isolator->usage(containerId);
+  AWAIT_READY(resourceStatistics);
+  EXPECT_EQ(1024u, resourceStatistics->mem_rss_bytes());
+  EXPECT_FALSE(resourceStatistics->has_net_snmp_statistics());
+}
+
+TEST_F(PublishedUsageCommandIsolatorTest,
+       should_run_usage_command_without_published_statistics) {
+  auto resourceStatistics = isolator->usage(containerId);
+  AWAIT_READY(resourceStatistics);
+  EXPECT_EQ(5, resourceStatistics->net_snmp_statistics().tcp_stats().currestab());
+}
+
+class ChannelUsageCommandIsolatorTest : public CommandIsolatorTest {
+ public:
+  void SetUp() {
+    CommandIsolatorTest::SetUp();
+    m_path = "/tmp/isolator_channel_" + stringify(getpid());
+
+    IsolatorOptions isolatorOptions;
+    isolatorOptions.usageChannel = m_path;
+    isolator.reset(new CommandIsolator(
+        "test", None(), None(), None(), None(),
+        Command(g_resourcesPath + "usage.sh"), false, RunnerOptions(),
+        isolatorOptions));
+    CommandIsolatorTest::Prepare();
+  }
+
+  void TearDown() { os::rm(m_path); }
+
+  std::string m_path;
+};
+
+TEST_F(ChannelUsageCommandIsolatorTest,
+       should_serve_statistics_published_in_channel) {
+  // Before the collector creates the channel, the usage command is run.
+  auto resourceStatistics = isolator->usage(containerId);
+  AWAIT_READY(resourceStatistics);
+  EXPECT_EQ(5, resourceStatistics->net_snmp_statistics().tcp_stats().currestab());
+
+  Try<std::shared_ptr<statistics::StatisticsChannelWriter>> writer =
+      statistics::StatisticsChannelWriter::create(m_path, 16);
+  ASSERT_SOME(writer);
+  ::mesos::ResourceStatistics published;
+  published.set_mem_rss_bytes(1024);
+  ASSERT_SOME(writer.get()->publish(containerId.value(),
+                                    published.SerializePartialAsString()));
+
+  resourceStatistics = isolator->usage(containerId);
+  AWAIT_READY(resourceStatistics);
+  EXPECT_EQ(1024u, resourceStatistics->mem_rss_bytes());
+  EXPECT_FALSE(resourceStatistics->has_net_snmp_statistics());
+}
+
 class TimeoutCommandIsolatorTest : public CommandIsolatorTest {
  public:
   void SetUp() {
@@ -0,0 +1,77 @@
+#include "CommandPlacement.hpp"
+
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+
+using namespace criteo::mesos;
+
+/*
+ * Fork into a placement and return the exit code of a check run in the
+ * child.
+ */
+template <typename Check>
+static int runPlaced(const CommandPlacement& placement, Check check) {
+  pid_t pid = placement.fork();
+  if (pid == 0) _exit(check() ? 0 : 1);
+  int status;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+TEST(CommandPlacementTest, should_reject_invalid_settings) {
+  PlacementOptions options;
+  options.cpuset = std::string("3-1");
+  EXPECT_ERROR(CommandPlacement::create(options));
+
+  options = PlacementOptions();
+  options.cpuset = std::string("0-x");
+  EXPECT_ERROR(CommandPlacement::create(options));
+
+  options = PlacementOptions();
+  options.nice = 20;
+  EXPECT_ERROR(CommandPlacement::create(options));
+
+  options = PlacementOptions();
+  options.ionice = std::string("best-effort:8");
+  EXPECT_ERROR(CommandPlacement::create(options));
+
+  options = PlacementOptions();
+  options.ionice = std::string("fastest");
+  EXPECT_ERROR(CommandPlacement::create(options));
+}
+
+TEST(CommandPlacementTest, should_reject_a_directory_which_is_not_a_cgroup) {
+  PlacementOptions options;
+  options.cgroup = std::string("/tmp");
+  EXPECT_ERROR(CommandPlacement::create(options));
+}
+
+TEST(CommandPlacementTest, should_apply_the_priorities_in_the_child) {
+  cpu_set_t allowed;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed)) ++cpu;
+
+  PlacementOptions options;
+  options.cpuset = std::to_string(cpu);
+  options.nice = 19;
+  options.ionice = std::string("idle");
+  Try<std::shared_ptr<CommandPlacement>> placement =
+      CommandPlacement::create(options);
+  ASSERT_SOME(placement);
+
+  EXPECT_EQ(0, runPlaced(*placement.get(), [cpu]() {
+              cpu_set_t cpus;
+              sched_getaffinity(0, sizeof(cpus), &cpus);
+              return CPU_COUNT(&cpus) == 1 && CPU_ISSET(cpu, &cpus) &&
+                     getpriority(PRIO_PROCESS, 0) == 19;
+            }));
+
+  // The agent keeps its own settings.
+  EXPECT_NE(19, getpriority(PRIO_PROCESS, 0));
+}
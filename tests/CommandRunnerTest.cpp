@@ -1,7 +1,11 @@
 #include "CommandRunner.hpp"
+#include "TestSocketServer.hpp"
 #include "gtest_helpers.hpp"
 
+#include <process/gtest.hpp>
 #include <stout/gtest.hpp>
+#include <stout/os.hpp>
+#include <chrono>
 #include <regex>
 #include <memory>
 
@@ -61,6 +65,182 @@ TEST_F(CommandRunnerTest, should_force_SIGKILL_infinite_loop_command) {
   EXPECT_PROCESS_EXITED("/tmp/force_kill.pid");
 }
 
+TEST_F(CommandRunnerTest, should_kill_infinite_loop_command_run_synchronously) {
+  Try<string> output = m_commandRunner->runSync(
+      Command(g_resourcesPath + "force_kill.sh", 1), "");
+  EXPECT_ERROR_MESSAGE(
+      output, std::regex("Command \".*force_kill.sh\" took too long to execute."));
+  EXPECT_PROCESS_EXITED("/tmp/force_kill.pid");
+}
+
+TEST_F(CommandRunnerTest, should_kill_the_whole_process_tree_on_timeout) {
+  Command command(g_resourcesPath + "spawn_tree.sh", 1);
+  Future<Try<string>> output = m_commandRunner->asyncRun(command, "");
+  AWAIT_ASSERT_FAILED_FOR(output, Seconds(4));
+  os::sleep(Milliseconds(100));
+  EXPECT_PROCESS_EXITED("/tmp/spawn_tree.pid");
+  EXPECT_PROCESS_EXITED("/tmp/spawn_tree_trap.pid");
+
+  EXPECT_ERROR(m_commandRunner->runSync(command, ""));
+  os::sleep(Milliseconds(100));
+  EXPECT_PROCESS_EXITED("/tmp/spawn_tree.pid");
+  EXPECT_PROCESS_EXITED("/tmp/spawn_tree_trap.pid");
+}
+
+TEST_F(CommandRunnerTest, should_not_wait_the_grace_period_after_SIGTERM) {
+  Command command(g_resourcesPath + "infinite_loop.sh", 1);
+  auto start = std::chrono::steady_clock::now();
+  Future<Try<string>> output = m_commandRunner->asyncRun(command, "");
+  AWAIT_ASSERT_FAILED_FOR(output, Seconds(4));
+  // The command exits on SIGTERM, SIGKILL would come one second later.
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(1800));
+
+  start = std::chrono::steady_clock::now();
+  EXPECT_ERROR(m_commandRunner->runSync(command, ""));
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(1800));
+}
+
+TEST_F(CommandRunnerTest, should_run_a_simple_sh_command_synchronously) {
+  Try<string> output = m_commandRunner->runSync(
+      Command(g_resourcesPath + "pipe_input.sh", 10), "HELLO");
+  EXPECT_SOME_EQ("HELLO > output", output);
+}
+
+TEST_F(CommandRunnerTest, should_reject_outputs_exceeding_max_size) {
+  RunnerOptions options;
+  options.maxOutputSize = 12;
+  CommandRunner runner(false, m_metadata, options);
+  Command command(g_resourcesPath + "pipe_input.sh", 10);
+
+  std::regex message("Output of 14 bytes exceeds the 12 bytes limit");
+  Try<string> output = runner.runSync(command, "HELLO");
+  EXPECT_ERROR_MESSAGE(output, message);
+  output = runner.run(command, "HELLO");
+  EXPECT_ERROR_MESSAGE(output, message);
+  EXPECT_SOME_EQ("HI > output", runner.runSync(command, "HI"));
+}
+
+TEST_F(CommandRunnerTest, should_stop_commands_exceeding_file_size_limit) {
+  RunnerOptions options;
+  options.fileSizeLimit = 12;
+  CommandRunner runner(false, m_metadata, options);
+  Command command(g_resourcesPath + "pipe_input.sh", 10);
+
+  std::regex message(
+      "Command \".*pipe_input.sh\" exceeded the file size limit.");
+  Try<string> output = runner.runSync(command, "HELLO");
+  EXPECT_ERROR_MESSAGE(output, message);
+  output = runner.run(command, "HELLO");
+  EXPECT_ERROR_MESSAGE(output, message);
+  EXPECT_SOME_EQ("HI > output", runner.runSync(command, "HI"));
+}
+
+TEST_F(CommandRunnerTest, should_not_run_commands_which_keep_failing) {
+  CircuitBreakerOptions circuitBreakerOptions;
+  circuitBreakerOptions.window = 2;
+  RunnerOptions options;
+  options.circuitBreakers =
+      std::make_shared<CircuitBreakers>(circuitBreakerOptions);
+  CommandRunner runner(false, m_metadata, options);
+  Command command(g_resourcesPath + "autokill.sh", 10);
+
+  Try<string> output = runner.runSync(command, "");
+  EXPECT_ERROR_MESSAGE(output, std::regex(".*exited via signal 15."));
+  output = runner.run(command, "");
+  EXPECT_ERROR_MESSAGE(
+      output, std::regex(".*autokill.sh\" is not run while it keeps.*"));
+  output = runner.runSync(command, "");
+  EXPECT_ERROR_MESSAGE(
+      output, std::regex(".*autokill.sh\" is not run while it keeps.*"));
+
+  // The other commands, and the same command on other events, are still run.
+  EXPECT_SOME(runner.runSync(Command(g_resourcesPath + "ok.sh", 10), ""));
+  logging::Metadata metadata{"ABC-DEF-GHI", "other_method"};
+  output = CommandRunner(false, metadata, options).runSync(command, "");
+  EXPECT_ERROR_MESSAGE(output, std::regex(".*exited via signal 15."));
+}
+
+TEST_F(CommandRunnerTest, should_keep_running_commands_exiting_with_errors) {
+  CircuitBreakerOptions circuitBreakerOptions;
+  circuitBreakerOptions.window = 2;
+  RunnerOptions options;
+  options.circuitBreakers =
+      std::make_shared<CircuitBreakers>(circuitBreakerOptions);
+  CommandRunner runner(false, m_metadata, options);
+  Command command(g_resourcesPath + "throw.sh", 10);
+
+  for (int i = 0; i < 4; ++i) {
+    Try<string> output = runner.runSync(command, "");
+    EXPECT_ERROR_MESSAGE(output, std::regex(".*exited with return code 1."));
+    output = runner.run(command, "");
+    EXPECT_ERROR_MESSAGE(output, std::regex(".*exited with return code 1."));
+  }
+}
+
+TEST_F(CommandRunnerTest, should_queue_commands_above_the_limit) {
+  RunnerOptions options;
+  options.executionQueue = std::make_shared<ExecutionQueue>(1);
+  CommandRunner runner(false, m_metadata, options);
+  Command command(g_resourcesPath + "pipe_input.sh", 10);
+
+  Future<Try<string>> first = runner.asyncRun(command, "FIRST");
+  Future<Try<string>> second = runner.asyncRun(command, "SECOND");
+  EXPECT_EQ(1u, options.executionQueue->waiting());
+  EXPECT_SOME_EQ("SECOND > output", runner.runSync(command, "SECOND"));
+
+  AWAIT_READY(first);
+  EXPECT_SOME_EQ("FIRST > output", first.get());
+  AWAIT_READY(second);
+  EXPECT_SOME_EQ("SECOND > output", second.get());
+  EXPECT_EQ(0u, options.executionQueue->running());
+}
+
+TEST_F(CommandRunnerTest, should_not_hold_the_trial_call_while_queued) {
+  CircuitBreakerOptions circuitBreakerOptions;
+  circuitBreakerOptions.window = 2;
+  circuitBreakerOptions.cooldown = Milliseconds(100);
+  RunnerOptions options;
+  options.circuitBreakers =
+      std::make_shared<CircuitBreakers>(circuitBreakerOptions);
+  options.executionQueue = std::make_shared<ExecutionQueue>(1);
+  CommandRunner runner(false, m_metadata, options);
+  Command command(g_resourcesPath + "kill_on_input.sh", 10);
+
+  Try<string> output = runner.runSync(command, "KILL");
+  EXPECT_ERROR_MESSAGE(output, std::regex(".*exited via signal 15."));
+  os::sleep(Milliseconds(200));
+
+  // The trial call waits behind a slow command, the next one then runs after
+  // the trial succeeded instead of being rejected while it is queued.
+  Future<Try<string>> slow =
+      runner.asyncRun(Command(g_resourcesPath + "sleep.sh", 10), "");
+  Future<Try<string>> trial = runner.asyncRun(command, "TRIAL");
+  Future<Try<string>> next = runner.asyncRun(command, "NEXT");
+  EXPECT_EQ(2u, options.executionQueue->waiting());
+
+  AWAIT_READY(trial);
+  EXPECT_SOME_EQ("TRIAL > output", trial.get());
+  AWAIT_READY(next);
+  EXPECT_SOME_EQ("NEXT > output", next.get());
+  AWAIT_READY(slow);
+}
+
+TEST_F(CommandRunnerTest, should_run_preloaded_executables) {
+  std::string executable = g_resourcesPath + "pipe_input.sh";
+  auto executables = std::make_shared<ExecutableCache>();
+  ASSERT_SOME(executables->preload(executable));
+  RunnerOptions options;
+  options.executables = executables;
+  CommandRunner runner(false, m_metadata, options);
+
+  EXPECT_SOME_EQ("HELLO > output",
+                 runner.runSync(Command(executable, 10), "HELLO"));
+  EXPECT_SOME_EQ("HELLO > output",
+                 runner.run(Command(executable, 10), "HELLO"));
+}
+
 TEST_F(CommandRunnerTest, should_not_crash_when_child_throws) {
   Try<string> output =
       m_commandRunner->run(Command(g_resourcesPath + "throw.sh", 10), "");
@@ -106,3 +286,58 @@ TEST_F(CommandRunnerTest,
   EXPECT_ERROR_MESSAGE(output,
                        std::regex("Command \".*stderr.sh\" exited with return code 1\\. Cause: This is the cause\\."));
 }
+
+TEST_F(CommandRunnerTest, should_send_unix_socket_command_to_daemon) {
+  TestSocketServer server(
+      "/tmp/command_runner_test.sock",
+      [](const string& method, const string& input) -> Try<string> {
+        return method + " " + input;
+      });
+  Command command("unix://" + server.path(), 10);
+
+  Try<string> output = m_commandRunner->run(command, "HELLO");
+  ASSERT_SOME(output);
+  EXPECT_EQ("method HELLO", output.get());
+
+  output = m_commandRunner->runSync(command, "WORLD");
+  ASSERT_SOME(output);
+  EXPECT_EQ("method WORLD", output.get());
+}
+
+TEST_F(CommandRunnerTest, should_fail_unix_socket_command_on_timeout) {
+  TestSocketServer server(
+      "/tmp/command_runner_timeout_test.sock",
+      [](const string&, const string&) -> Try<string> {
+        os::sleep(Seconds(2));
+        return string();
+      });
+
+  Future<Try<string>> output = m_commandRunner->asyncRun(
+      Command("unix://" + server.path(), 1), "HELLO");
+  AWAIT_READY_FOR(output, Seconds(3));
+  EXPECT_ERROR(output.get());
+}
+
+TEST_F(CommandRunnerTest, should_run_all_executables_concurrently) {
+  Command command(g_resourcesPath + "sleep.sh," + g_resourcesPath +
+                      "sleep.sh," + g_resourcesPath + "pipe_input.sh",
+                  10);
+  ASSERT_EQ(3u, command.executables().size());
+
+  auto start = std::chrono::steady_clock::now();
+  Try<std::vector<string>> outputs = m_commandRunner->runAll(command, "HELLO");
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  ASSERT_SOME(outputs);
+  ASSERT_EQ(3u, outputs->size());
+  EXPECT_EQ("slept", outputs->at(0));
+  EXPECT_EQ("slept", outputs->at(1));
+  EXPECT_EQ("HELLO > output", outputs->at(2));
+  EXPECT_LT(elapsed, std::chrono::milliseconds(1900));
+}
+
+TEST_F(CommandRunnerTest, should_fail_all_executables_when_one_fails) {
+  Command command(
+      g_resourcesPath + "pipe_input.sh," + g_resourcesPath + "throw.sh", 10);
+  EXPECT_ERROR(m_commandRunner->runAll(command, "HELLO"));
+}
@@ -1,4 +1,9 @@
 #include "ConfigurationParser.hpp"
+#include "AuditLog.hpp"
+#include "CircuitBreaker.hpp"
+#include "CommandHook.hpp"
+#include "IsolatorOptions.hpp"
+#include "RunningContext.hpp"
 
 #include <gtest/gtest.h>
 
@@ -181,3 +186,370 @@ TEST(ConfigurationParserTest, should_throw_on_module_name_missing) {
   }
 }
 
+TEST(ConfigurationParserTest, should_parse_debug_sampling) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  var = parameters.add_parameter();
+  var->set_key("debug_sample_rates");
+  var->set_value("usage:0.01, *:0.5");
+
+  var = parameters.add_parameter();
+  var->set_key("debug_container_filter");
+  var->set_value("^canary-");
+
+  var = parameters.add_parameter();
+  var->set_key("debug_framework_filter");
+  var->set_value("framework-1,framework-2");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+
+  EXPECT_EQ(2u, cfg.debugSampleRates.size());
+  EXPECT_DOUBLE_EQ(0.01, cfg.debugSampleRates["usage"]);
+  EXPECT_DOUBLE_EQ(0.5, cfg.debugSampleRates["*"]);
+  EXPECT_EQ(Option<std::string>("^canary-"), cfg.debugContainerFilter);
+  EXPECT_EQ(2u, cfg.debugFrameworkFilter.size());
+  EXPECT_EQ(1u, cfg.debugFrameworkFilter.count("framework-2"));
+}
+
+TEST(ConfigurationParserTest, should_parse_audit_log) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_TRUE(cfg.auditFile.isNone());
+  EXPECT_EQ(audit::DEFAULT_AUDIT_CAPACITY, cfg.auditCapacity);
+
+  var = parameters.add_parameter();
+  var->set_key("audit_file");
+  var->set_value("/var/lib/mesos/command_modules.audit");
+
+  var = parameters.add_parameter();
+  var->set_key("audit_capacity");
+  var->set_value("1024");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(Option<std::string>("/var/lib/mesos/command_modules.audit"),
+            cfg.auditFile);
+  EXPECT_EQ(1024u, cfg.auditCapacity);
+}
+
+TEST(ConfigurationParserTest, should_parse_adaptive_watch_frequence) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  var = parameters.add_parameter();
+  var->set_key("isolator_watch_command");
+  var->set_value("command_watch");
+  var = parameters.add_parameter();
+  var->set_key("isolator_watch_frequence");
+  var->set_value("10");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_FLOAT_EQ(10, cfg.watchCommand->minFrequence());
+  EXPECT_FLOAT_EQ(10, cfg.watchCommand->maxFrequence());
+
+  var = parameters.add_parameter();
+  var->set_key("isolator_watch_min_frequence");
+  var->set_value("0.5");
+  var = parameters.add_parameter();
+  var->set_key("isolator_watch_max_frequence");
+  var->set_value("120");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_FLOAT_EQ(0.5, cfg.watchCommand->minFrequence());
+  EXPECT_FLOAT_EQ(120, cfg.watchCommand->maxFrequence());
+
+  var = parameters.add_parameter();
+  var->set_key("isolator_watch_min_frequence");
+  var->set_value("20");
+  EXPECT_THROW(ConfigurationParser::parse(parameters), std::invalid_argument);
+}
+
+TEST(ConfigurationParserTest, should_parse_usage_refresh) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_TRUE(cfg.usageRefreshInterval.isNone());
+  EXPECT_EQ(DEFAULT_USAGE_REFRESH_CONCURRENCY, cfg.usageRefreshConcurrency);
+
+  var = parameters.add_parameter();
+  var->set_key("isolator_usage_refresh_interval");
+  var->set_value("2.5");
+  var = parameters.add_parameter();
+  var->set_key("isolator_usage_refresh_concurrency");
+  var->set_value("16");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(Option<float>(2.5), cfg.usageRefreshInterval);
+  EXPECT_EQ(16u, cfg.usageRefreshConcurrency);
+}
+
+TEST(ConfigurationParserTest, should_parse_usage_sources) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_TRUE(cfg.usageChannel.isNone());
+  EXPECT_TRUE(cfg.usageChannelMaxAge.isNone());
+  EXPECT_TRUE(cfg.usageSourceDir.isNone());
+
+  var = parameters.add_parameter();
+  var->set_key("isolator_usage_channel");
+  var->set_value("/dev/shm/statistics");
+  var = parameters.add_parameter();
+  var->set_key("isolator_usage_channel_max_age");
+  var->set_value("30");
+  var = parameters.add_parameter();
+  var->set_key("isolator_usage_source_dir");
+  var->set_value("/run/statistics");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(Option<std::string>("/dev/shm/statistics"), cfg.usageChannel);
+  EXPECT_EQ(Option<float>(30), cfg.usageChannelMaxAge);
+  EXPECT_EQ(Option<std::string>("/run/statistics"), cfg.usageSourceDir);
+}
+
+TEST(ConfigurationParserTest, should_parse_command_sets) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+  var = parameters.add_parameter();
+  var->set_key("isolator_prepare_command");
+  var->set_value("prepare.sh");
+  var = parameters.add_parameter();
+  var->set_key("command_sets");
+  var->set_value("gpu, network");
+  var = parameters.add_parameter();
+  var->set_key("gpu.isolator_prepare_command");
+  var->set_value("gpu_prepare.sh");
+  var = parameters.add_parameter();
+  var->set_key("gpu.isolator_prepare_timeout");
+  var->set_value("5");
+  var = parameters.add_parameter();
+  var->set_key("network.isolator_watch_command");
+  var->set_value("network_watch.sh");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(Command("prepare.sh", 30), cfg.prepareCommand.get());
+  ASSERT_EQ(2u, cfg.commandSets.size());
+
+  EXPECT_EQ("gpu", cfg.commandSets[0].name);
+  EXPECT_EQ(Command("gpu_prepare.sh", 5),
+            cfg.commandSets[0].prepareCommand.get());
+  EXPECT_TRUE(cfg.commandSets[0].watchCommand.isNone());
+
+  EXPECT_EQ("network", cfg.commandSets[1].name);
+  EXPECT_TRUE(cfg.commandSets[1].prepareCommand.isNone());
+  EXPECT_EQ(RecurrentCommand("network_watch.sh", 30, 30),
+            cfg.commandSets[1].watchCommand.get());
+}
+
+TEST(ConfigurationParserTest, should_reject_duplicate_command_sets) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+  var = parameters.add_parameter();
+  var->set_key("command_sets");
+  var->set_value("gpu,gpu");
+
+  EXPECT_THROW(ConfigurationParser::parse(parameters), std::invalid_argument);
+}
+
+TEST(ConfigurationParserTest, should_parse_recovery) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(DEFAULT_ISOLATOR_STATE_DIR, cfg.stateDir);
+  EXPECT_EQ(DEFAULT_RECOVERY_WORKERS, cfg.recoveryWorkers);
+  EXPECT_FALSE(cfg.lazyRecovery);
+
+  var = parameters.add_parameter();
+  var->set_key("isolator_state_dir");
+  var->set_value("/run/isolator");
+  var = parameters.add_parameter();
+  var->set_key("isolator_recovery_workers");
+  var->set_value("2");
+  var = parameters.add_parameter();
+  var->set_key("isolator_lazy_recovery");
+  var->set_value("true");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ("/run/isolator", cfg.stateDir);
+  EXPECT_EQ(2u, cfg.recoveryWorkers);
+  EXPECT_TRUE(cfg.lazyRecovery);
+}
+
+TEST(ConfigurationParserTest, should_parse_warm_up) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_FALSE(cfg.preloadExecutables);
+  EXPECT_FALSE(cfg.warmUp);
+
+  var = parameters.add_parameter();
+  var->set_key("preload_executables");
+  var->set_value("true");
+  var = parameters.add_parameter();
+  var->set_key("warm_up");
+  var->set_value("true");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_TRUE(cfg.preloadExecutables);
+  EXPECT_TRUE(cfg.warmUp);
+}
+
+TEST(ConfigurationParserTest, should_parse_max_output_size) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(DEFAULT_MAX_OUTPUT_SIZE, cfg.maxOutputSize);
+  EXPECT_TRUE(cfg.commandFileSizeLimit.isNone());
+
+  var = parameters.add_parameter();
+  var->set_key("max_output_size");
+  var->set_value("1024");
+  var = parameters.add_parameter();
+  var->set_key("command_file_size_limit");
+  var->set_value("4096");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(1024u, cfg.maxOutputSize);
+  EXPECT_EQ(Option<size_t>(4096), cfg.commandFileSizeLimit);
+}
+
+TEST(ConfigurationParserTest, should_parse_launch_decorator) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_TRUE(cfg.slaveLaunchDecoratorCommand.isNone());
+  EXPECT_EQ(DEFAULT_LAUNCH_DECORATION_TTL.secs(), cfg.launchDecorationTtl);
+
+  var = parameters.add_parameter();
+  var->set_key("hook_slave_launch_decorator_command");
+  var->set_value("decorate.sh");
+  var = parameters.add_parameter();
+  var->set_key("hook_slave_launch_decoration_ttl");
+  var->set_value("5");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(Command("decorate.sh"), cfg.slaveLaunchDecoratorCommand.get());
+  EXPECT_EQ(5, cfg.launchDecorationTtl);
+}
+
+TEST(ConfigurationParserTest, should_parse_circuit_breaker) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_FALSE(cfg.circuitBreaker);
+  EXPECT_EQ(DEFAULT_CIRCUIT_BREAKER_WINDOW, cfg.circuitBreakerWindow);
+  EXPECT_EQ(DEFAULT_CIRCUIT_BREAKER_FAILURE_RATE,
+            cfg.circuitBreakerFailureRate);
+  EXPECT_EQ(DEFAULT_CIRCUIT_BREAKER_SLOW_CALL_RATE,
+            cfg.circuitBreakerSlowCallRate);
+  EXPECT_EQ(30.0, cfg.circuitBreakerCooldown);
+
+  var = parameters.add_parameter();
+  var->set_key("circuit_breaker");
+  var->set_value("true");
+  var = parameters.add_parameter();
+  var->set_key("circuit_breaker_window");
+  var->set_value("10");
+  var = parameters.add_parameter();
+  var->set_key("circuit_breaker_failure_rate");
+  var->set_value("0.25");
+  var = parameters.add_parameter();
+  var->set_key("circuit_breaker_slow_call_rate");
+  var->set_value("0.5");
+  var = parameters.add_parameter();
+  var->set_key("circuit_breaker_cooldown");
+  var->set_value("5");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_TRUE(cfg.circuitBreaker);
+  EXPECT_EQ(10u, cfg.circuitBreakerWindow);
+  EXPECT_EQ(0.25, cfg.circuitBreakerFailureRate);
+  EXPECT_EQ(0.5, cfg.circuitBreakerSlowCallRate);
+  EXPECT_EQ(5.0, cfg.circuitBreakerCooldown);
+}
+
+TEST(ConfigurationParserTest, should_parse_max_concurrent_commands) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(0u, cfg.maxConcurrentCommands);
+
+  var = parameters.add_parameter();
+  var->set_key("max_concurrent_commands");
+  var->set_value("16");
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(16u, cfg.maxConcurrentCommands);
+}
+
+TEST(ConfigurationParserTest, should_parse_command_placement) {
+  ::mesos::Parameters parameters;
+  auto var = parameters.add_parameter();
+  var->set_key("module_name");
+  var->set_value("test");
+
+  Configuration cfg = ConfigurationParser::parse(parameters);
+  EXPECT_TRUE(cfg.commandCgroup.isNone());
+  EXPECT_TRUE(cfg.commandCpuset.isNone());
+  EXPECT_TRUE(cfg.commandCpuWeight.isNone());
+  EXPECT_TRUE(cfg.commandCpuQuota.isNone());
+  EXPECT_TRUE(cfg.commandNice.isNone());
+  EXPECT_TRUE(cfg.commandIonice.isNone());
+
+  std::map<std::string, std::string> values = {
+      {"command_cgroup", "/sys/fs/cgroup/helpers"},
+      {"command_cpuset", "0-1"},
+      {"command_cpu_weight", "50"},
+      {"command_cpu_quota", "1.5"},
+      {"command_nice", "10"},
+      {"command_ionice", "idle"}};
+  for (const auto& value : values) {
+    var = parameters.add_parameter();
+    var->set_key(value.first);
+    var->set_value(value.second);
+  }
+
+  cfg = ConfigurationParser::parse(parameters);
+  EXPECT_EQ(Option<std::string>("/sys/fs/cgroup/helpers"), cfg.commandCgroup);
+  EXPECT_EQ(Option<std::string>("0-1"), cfg.commandCpuset);
+  EXPECT_EQ(Option<size_t>(50), cfg.commandCpuWeight);
+  EXPECT_EQ(Option<float>(1.5), cfg.commandCpuQuota);
+  EXPECT_EQ(Option<int>(10), cfg.commandNice);
+  EXPECT_EQ(Option<std::string>("idle"), cfg.commandIonice);
+}
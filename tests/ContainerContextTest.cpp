@@ -0,0 +1,49 @@
+#include "ContainerContext.hpp"
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+#include <stout/json.hpp>
+#include <stout/protobuf.hpp>
+
+using namespace criteo::mesos;
+
+using ::mesos::slave::ContainerConfig;
+
+static ContainerConfig createContainerConfig(const std::string& directory) {
+  ContainerConfig containerConfig;
+  containerConfig.set_directory(directory);
+  containerConfig.set_user("app_user");
+  ::mesos::ExecutorInfo* executorInfo = containerConfig.mutable_executor_info();
+  executorInfo->mutable_executor_id()->set_value("executor");
+  executorInfo->mutable_framework_id()->set_value("framework");
+  return containerConfig;
+}
+
+TEST(ContainerContextTest, should_produce_the_json_of_the_config) {
+  ContainerContextInterner interner;
+  ContainerConfig containerConfig = createContainerConfig("/sandbox");
+  std::shared_ptr<const ContainerContext> context =
+      interner.intern(containerConfig);
+
+  EXPECT_EQ("framework", context->frameworkId());
+  Try<JSON::Value> json = JSON::parse(context->json());
+  ASSERT_SOME(json);
+  EXPECT_EQ(JSON::Value(JSON::protobuf(containerConfig)), json.get());
+}
+
+TEST(ContainerContextTest, should_share_repeated_members) {
+  ContainerContextInterner interner;
+  std::shared_ptr<const ContainerContext> first =
+      interner.intern(createContainerConfig("/sandbox/1"));
+  // The framework id, the directory, the executor and the user.
+  EXPECT_EQ(4u, interner.size());
+
+  std::shared_ptr<const ContainerContext> second =
+      interner.intern(createContainerConfig("/sandbox/2"));
+  EXPECT_EQ(5u, interner.size());
+
+  first.reset();
+  EXPECT_EQ(4u, interner.size());
+  second.reset();
+  EXPECT_EQ(0u, interner.size());
+}
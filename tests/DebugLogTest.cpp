@@ -0,0 +1,60 @@
+#include "DebugLog.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace criteo::mesos::logging;
+
+TEST(AsyncLogSinkTest, should_pop_messages_in_order) {
+  AsyncLogSink sink(4);
+  EXPECT_TRUE(sink.push("first"));
+  EXPECT_TRUE(sink.push("second"));
+
+  std::string message;
+  ASSERT_TRUE(sink.pop(message));
+  EXPECT_EQ("first", message);
+  ASSERT_TRUE(sink.pop(message));
+  EXPECT_EQ("second", message);
+  EXPECT_FALSE(sink.pop(message));
+}
+
+TEST(AsyncLogSinkTest, should_drop_messages_when_full) {
+  AsyncLogSink sink(2);
+  EXPECT_TRUE(sink.push("1"));
+  EXPECT_TRUE(sink.push("2"));
+  EXPECT_FALSE(sink.push("3"));
+  EXPECT_EQ(1u, sink.dropped());
+
+  std::string message;
+  ASSERT_TRUE(sink.pop(message));
+  EXPECT_TRUE(sink.push("4"));
+}
+
+TEST(DebugSamplerTest, should_sample_everything_by_default) {
+  DebugSampler sampler;
+  EXPECT_TRUE(sampler.sample(Metadata{"container", "usage"}));
+}
+
+TEST(DebugSamplerTest, should_apply_rate_per_method) {
+  DebugSampler sampler({{"usage", 0}, {"*", 1}}, None(), {});
+  EXPECT_FALSE(sampler.sample(Metadata{"container", "usage"}));
+  EXPECT_TRUE(sampler.sample(Metadata{"container", "prepare"}));
+}
+
+TEST(DebugSamplerTest, should_apply_default_rate) {
+  DebugSampler sampler({{"prepare", 1}, {"*", 0}}, None(), {});
+  EXPECT_TRUE(sampler.sample(Metadata{"container", "prepare"}));
+  EXPECT_FALSE(sampler.sample(Metadata{"container", "watch"}));
+}
+
+TEST(DebugSamplerTest, should_filter_containers) {
+  DebugSampler sampler({}, std::string("^canary-"), {});
+  EXPECT_TRUE(sampler.sample(Metadata{"canary-123", "usage"}));
+  EXPECT_FALSE(sampler.sample(Metadata{"prod-123", "usage"}));
+}
+
+TEST(DebugSamplerTest, should_filter_frameworks) {
+  DebugSampler sampler({}, None(), {"framework-1"});
+  EXPECT_TRUE(sampler.sample(Metadata{"container", "usage", "framework-1"}));
+  EXPECT_FALSE(sampler.sample(Metadata{"container", "usage", "framework-2"}));
+  EXPECT_FALSE(sampler.sample(Metadata{"container", "usage"}));
+}
@@ -0,0 +1,66 @@
+#include "ExecutableCache.hpp"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
+using namespace criteo::mesos;
+
+extern std::string g_resourcesPath;
+
+class ExecutableCacheTest : public ::testing::Test {
+ public:
+  void SetUp() {
+    Try<std::string> directory = os::mkdtemp("/tmp/executable_cache_XXXXXX");
+    ASSERT_SOME(directory);
+    m_directory = directory.get();
+  }
+
+  void TearDown() { os::rmdir(m_directory); }
+
+  std::string m_directory;
+};
+
+TEST_F(ExecutableCacheTest, should_resolve_executables) {
+  EXPECT_SOME(ExecutableCache::resolve(g_resourcesPath + "pipe_input.sh"));
+  EXPECT_SOME_EQ("/bin/sh", ExecutableCache::resolve("/bin/sh"));
+  EXPECT_SOME(ExecutableCache::resolve("sh"));
+}
+
+TEST_F(ExecutableCacheTest, should_reject_invalid_executables) {
+  std::string script = path::join(m_directory, "script.sh");
+  ASSERT_SOME(os::write(script, "#!/bin/sh\n"));
+
+  EXPECT_ERROR(ExecutableCache::resolve(script));
+  EXPECT_ERROR(ExecutableCache::resolve(m_directory));
+  EXPECT_ERROR(ExecutableCache::resolve(path::join(m_directory, "missing")));
+  EXPECT_ERROR(ExecutableCache::resolve("criteo_missing_executable"));
+}
+
+TEST_F(ExecutableCacheTest, should_execute_preloaded_copy) {
+  std::string script = path::join(m_directory, "script.sh");
+  ASSERT_SOME(os::write(script, "#!/bin/sh\nexit 3\n"));
+  ASSERT_SOME(os::chmod(script, 0755));
+
+  ExecutableCache cache;
+  EXPECT_EQ(script, cache.path(script));
+  ASSERT_SOME(cache.preload(script));
+  EXPECT_EQ(1u, cache.size());
+  std::string preloaded = cache.path(script);
+  EXPECT_EQ(0u, preloaded.find("/proc/"));
+
+  // The copy is not affected by the file being rewritten in place, which
+  // keeps its inode.
+  int fd = ::open(script.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+  ASSERT_NE(-1, fd);
+  ASSERT_SOME(os::write(fd, "#!/bin/sh\nexit 4\n"));
+  ::close(fd);
+  EXPECT_EQ(4, WEXITSTATUS(::system(script.c_str())));
+  EXPECT_EQ(3, WEXITSTATUS(::system(preloaded.c_str())));
+}
@@ -0,0 +1,112 @@
+#include "ExecutionQueue.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using std::string;
+using std::vector;
+
+using namespace criteo::mesos;
+
+class ExecutionQueueTest : public ::testing::Test {
+ protected:
+  ExecutionQueue::Grant record(const string& name) {
+    return [this, name]() { m_granted.push_back(name); };
+  }
+
+  // Complete the running command and the granted ones until none waits.
+  void drain(ExecutionQueue& queue) {
+    while (queue.waiting() > 0) queue.release();
+    queue.release();
+  }
+
+  vector<string> m_granted;
+};
+
+TEST_F(ExecutionQueueTest, should_run_commands_up_to_the_limit) {
+  ExecutionQueue queue(2);
+  queue.submit(ExecutionQueue::LIFECYCLE, "framework", record("first"));
+  queue.submit(ExecutionQueue::LIFECYCLE, "framework", record("second"));
+  queue.submit(ExecutionQueue::LIFECYCLE, "framework", record("third"));
+  EXPECT_EQ(vector<string>({"first", "second"}), m_granted);
+  EXPECT_EQ(2u, queue.running());
+  EXPECT_EQ(1u, queue.waiting());
+
+  queue.release();
+  EXPECT_EQ(vector<string>({"first", "second", "third"}), m_granted);
+  EXPECT_EQ(2u, queue.running());
+  queue.release();
+  queue.release();
+  EXPECT_EQ(0u, queue.running());
+}
+
+TEST_F(ExecutionQueueTest, should_run_lifecycle_commands_first) {
+  ExecutionQueue queue(1);
+  queue.submit(ExecutionQueue::TELEMETRY, "framework", record("running"));
+  queue.submit(ExecutionQueue::TELEMETRY, "framework", record("usage"));
+  queue.submit(ExecutionQueue::LIFECYCLE, "framework", record("prepare"));
+  drain(queue);
+
+  EXPECT_EQ(vector<string>({"running", "prepare", "usage"}), m_granted);
+  EXPECT_EQ(ExecutionQueue::TELEMETRY, ExecutionQueue::priorityOf("usage"));
+  EXPECT_EQ(ExecutionQueue::TELEMETRY, ExecutionQueue::priorityOf("watch"));
+  EXPECT_EQ(ExecutionQueue::LIFECYCLE, ExecutionQueue::priorityOf("prepare"));
+}
+
+TEST_F(ExecutionQueueTest, should_share_slots_between_frameworks) {
+  ExecutionQueue queue(1);
+  queue.submit(ExecutionQueue::LIFECYCLE, "a", record("running"));
+  for (int i = 0; i < 4; ++i) {
+    queue.submit(ExecutionQueue::LIFECYCLE, "a", record("a"));
+  }
+  for (int i = 0; i < 2; ++i) {
+    queue.submit(ExecutionQueue::LIFECYCLE, "b", record("b"));
+  }
+  drain(queue);
+
+  EXPECT_EQ(vector<string>({"running", "a", "b", "a", "b", "a", "a"}),
+            m_granted);
+}
+
+TEST_F(ExecutionQueueTest, should_share_slots_according_to_weights) {
+  ExecutionQueue::setFrameworkWeight("heavy", 2);
+  ExecutionQueue queue(1);
+  queue.submit(ExecutionQueue::LIFECYCLE, "other", record("running"));
+  for (int i = 0; i < 4; ++i) {
+    queue.submit(ExecutionQueue::LIFECYCLE, "heavy", record("heavy"));
+  }
+  for (int i = 0; i < 2; ++i) {
+    queue.submit(ExecutionQueue::LIFECYCLE, "light", record("light"));
+  }
+  drain(queue);
+  ExecutionQueue::setFrameworkWeight("heavy", 1);
+
+  EXPECT_EQ(vector<string>({"running", "heavy", "light", "heavy", "heavy",
+                            "light", "heavy"}),
+            m_granted);
+}
+
+TEST_F(ExecutionQueueTest, should_block_until_a_slot_is_released) {
+  ExecutionQueue queue(1);
+  EXPECT_TRUE(queue.acquire(ExecutionQueue::LIFECYCLE, "").isReady());
+  process::Future<Nothing> slot = queue.acquire(ExecutionQueue::LIFECYCLE, "");
+  EXPECT_FALSE(slot.isReady());
+
+  std::thread waiter([&queue]() {
+    queue.acquireSync(ExecutionQueue::TELEMETRY, "");
+    queue.release();
+  });
+
+  queue.release();
+  EXPECT_TRUE(slot.isReady());
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(1u, queue.waiting());
+
+  queue.release();
+  waiter.join();
+  EXPECT_EQ(0u, queue.running());
+}
@@ -0,0 +1,144 @@
+#include "StatisticsChannel.hpp"
+#include "StatisticsChannelWriter.hpp"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+#include <stout/os.hpp>
+
+using namespace criteo::mesos::statistics;
+
+class StatisticsChannelTest : public ::testing::Test {
+ public:
+  void SetUp() {
+    char path[] = "/tmp/statistics_channel_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    m_path = path;
+  }
+
+  void TearDown() { os::rm(m_path); }
+
+  static std::string serialize(uint64_t rssBytes) {
+    ::mesos::ResourceStatistics statistics;
+    statistics.set_mem_rss_bytes(rssBytes);
+    return statistics.SerializePartialAsString();
+  }
+
+  std::string m_path;
+};
+
+TEST_F(StatisticsChannelTest, should_read_published_statistics) {
+  StatisticsChannel reader(m_path);
+  Try<std::shared_ptr<StatisticsChannelWriter>> writer =
+      StatisticsChannelWriter::create(m_path, 16);
+  ASSERT_SOME(writer);
+
+  EXPECT_NONE(reader.read("container"));
+
+  ASSERT_SOME(writer.get()->publish("container", serialize(1024)));
+  Result<::mesos::ResourceStatistics> statistics = reader.read("container");
+  ASSERT_SOME(statistics);
+  EXPECT_EQ(1024u, statistics->mem_rss_bytes());
+  // The time of publication stands for the missing timestamp.
+  EXPECT_LT(0, statistics->timestamp());
+
+  ASSERT_SOME(writer.get()->publish("container", serialize(2048)));
+  statistics = reader.read("container");
+  ASSERT_SOME(statistics);
+  EXPECT_EQ(2048u, statistics->mem_rss_bytes());
+
+  writer.get()->remove("container");
+  EXPECT_NONE(reader.read("container"));
+}
+
+TEST_F(StatisticsChannelTest, should_probe_slots_of_a_full_channel) {
+  StatisticsChannel reader(m_path);
+  Try<std::shared_ptr<StatisticsChannelWriter>> writer =
+      StatisticsChannelWriter::create(m_path, 2);
+  ASSERT_SOME(writer);
+
+  ASSERT_SOME(writer.get()->publish("a", serialize(1)));
+  ASSERT_SOME(writer.get()->publish("b", serialize(2)));
+  EXPECT_ERROR(writer.get()->publish("c", serialize(3)));
+
+  // Removing the container of the first slot must not hide the other one.
+  writer.get()->remove("a");
+  Result<::mesos::ResourceStatistics> statistics = reader.read("b");
+  ASSERT_SOME(statistics);
+  EXPECT_EQ(2u, statistics->mem_rss_bytes());
+
+  ASSERT_SOME(writer.get()->publish("c", serialize(3)));
+  statistics = reader.read("c");
+  ASSERT_SOME(statistics);
+  EXPECT_EQ(3u, statistics->mem_rss_bytes());
+}
+
+TEST_F(StatisticsChannelTest, should_follow_replaced_channel) {
+  StatisticsChannel reader(m_path);
+  Try<std::shared_ptr<StatisticsChannelWriter>> writer =
+      StatisticsChannelWriter::create(m_path, 4);
+  ASSERT_SOME(writer);
+  ASSERT_SOME(writer.get()->publish("container", serialize(1)));
+  ASSERT_SOME(reader.read("container"));
+
+  // A writer with another capacity replaces the channel.
+  writer = StatisticsChannelWriter::create(m_path, 8);
+  ASSERT_SOME(writer);
+  EXPECT_NONE(reader.read("container"));
+
+  ASSERT_SOME(writer.get()->publish("container", serialize(2)));
+  Result<::mesos::ResourceStatistics> statistics = reader.read("container");
+  ASSERT_SOME(statistics);
+  EXPECT_EQ(2u, statistics->mem_rss_bytes());
+}
+
+TEST_F(StatisticsChannelTest, should_ignore_stale_statistics) {
+  StatisticsChannel reader(m_path, Milliseconds(100));
+  Try<std::shared_ptr<StatisticsChannelWriter>> writer =
+      StatisticsChannelWriter::create(m_path, 4);
+  ASSERT_SOME(writer);
+
+  ASSERT_SOME(writer.get()->publish("container", serialize(1)));
+  ASSERT_SOME(reader.read("container"));
+
+  // The writer stopped publishing.
+  os::sleep(Milliseconds(200));
+  EXPECT_NONE(reader.read("container"));
+
+  ASSERT_SOME(writer.get()->publish("container", serialize(2)));
+  ASSERT_SOME(reader.read("container"));
+}
+
+TEST_F(StatisticsChannelTest, should_follow_channel_replaced_without_notice) {
+  StatisticsChannel reader(m_path, None(), Duration::zero());
+  Try<std::shared_ptr<StatisticsChannelWriter>> writer =
+      StatisticsChannelWriter::create(m_path, 4);
+  ASSERT_SOME(writer);
+  ASSERT_SOME(writer.get()->publish("container", serialize(1)));
+  ASSERT_SOME(reader.read("container"));
+
+  // A restarted writer creates a channel aside and renames it over the path
+  // without closing the previous one.
+  std::string path = m_path + ".new";
+  Try<std::shared_ptr<StatisticsChannelWriter>> restarted =
+      StatisticsChannelWriter::create(path, 4);
+  ASSERT_SOME(restarted);
+  ASSERT_SOME(restarted.get()->publish("container", serialize(2)));
+  ASSERT_SOME(os::rename(path, m_path));
+
+  Result<::mesos::ResourceStatistics> statistics = reader.read("container");
+  ASSERT_SOME(statistics);
+  EXPECT_EQ(2u, statistics->mem_rss_bytes());
+}
+
+TEST_F(StatisticsChannelTest, should_reject_invalid_container_ids) {
+  Try<std::shared_ptr<StatisticsChannelWriter>> writer =
+      StatisticsChannelWriter::create(m_path, 4);
+  ASSERT_SOME(writer);
+  EXPECT_ERROR(writer.get()->publish("", serialize(1)));
+  EXPECT_ERROR(writer.get()->publish(std::string(128, 'a'), serialize(1)));
+}
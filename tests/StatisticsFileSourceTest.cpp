@@ -0,0 +1,83 @@
+#include "StatisticsFileSource.hpp"
+
+#include <stdio.h>
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
+using namespace criteo::mesos;
+
+class StatisticsFileSourceTest : public ::testing::Test {
+ public:
+  void SetUp() {
+    Try<std::string> directory = os::mkdtemp("/tmp/statistics_source_XXXXXX");
+    ASSERT_SOME(directory);
+    m_directory = directory.get();
+  }
+
+  void TearDown() { os::rmdir(m_directory); }
+
+  // Publish a file the way a collector would, with an atomic rename.
+  void publish(const std::string& name, const std::string& content) {
+    std::string temporary = path::join(m_directory, "." + name);
+    ASSERT_SOME(os::write(temporary, content));
+    ASSERT_EQ(0, ::rename(temporary.c_str(),
+                          path::join(m_directory, name).c_str()));
+  }
+
+  std::string m_directory;
+  logging::Metadata m_metadata{"container", "usage"};
+};
+
+TEST_F(StatisticsFileSourceTest, should_return_none_without_published_file) {
+  StatisticsFileSource source(m_directory);
+  EXPECT_NONE(source.read("container", m_metadata));
+}
+
+TEST_F(StatisticsFileSourceTest, should_read_published_json_statistics) {
+  StatisticsFileSource source(m_directory);
+  publish("container.json", "{\"timestamp\": 12, \"cpus_limit\": 2}");
+
+  Result<::mesos::ResourceStatistics> statistics =
+      source.read("container", m_metadata);
+  ASSERT_SOME(statistics);
+  EXPECT_EQ(12, statistics->timestamp());
+  EXPECT_EQ(2, statistics->cpus_limit());
+
+  publish("container.json", "{\"timestamp\": 13, \"cpus_limit\": 4}");
+  statistics = source.read("container", m_metadata);
+  ASSERT_SOME(statistics);
+  EXPECT_EQ(13, statistics->timestamp());
+  EXPECT_EQ(4, statistics->cpus_limit());
+}
+
+TEST_F(StatisticsFileSourceTest, should_read_published_binary_statistics) {
+  StatisticsFileSource source(m_directory);
+  ::mesos::ResourceStatistics published;
+  published.set_mem_rss_bytes(1024);
+  publish("container.pb", published.SerializePartialAsString());
+
+  Result<::mesos::ResourceStatistics> statistics =
+      source.read("container", m_metadata);
+  ASSERT_SOME(statistics);
+  EXPECT_EQ(1024u, statistics->mem_rss_bytes());
+  // The modification time of the file stands for the missing timestamp.
+  EXPECT_LT(0, statistics->timestamp());
+}
+
+TEST_F(StatisticsFileSourceTest, should_fail_on_malformed_statistics) {
+  StatisticsFileSource source(m_directory);
+  publish("container.json", "{\"timestamp\": ");
+  EXPECT_ERROR(source.read("container", m_metadata));
+}
+
+TEST_F(StatisticsFileSourceTest, should_forget_removed_statistics) {
+  StatisticsFileSource source(m_directory);
+  publish("container.json", "{\"timestamp\": 12}");
+  ASSERT_SOME(source.read("container", m_metadata));
+
+  ASSERT_SOME(os::rm(path::join(m_directory, "container.json")));
+  EXPECT_NONE(source.read("container", m_metadata));
+}
@@ -0,0 +1,109 @@
+#include "TemporaryFilePool.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
+using namespace criteo::mesos;
+
+class TemporaryFilePoolTest : public ::testing::Test {
+ public:
+  void SetUp() {
+    Try<std::string> directory = os::mkdtemp("/tmp/temp_file_pool_XXXXXX");
+    ASSERT_SOME(directory);
+    m_directory = directory.get();
+  }
+
+  void TearDown() { os::rmdir(m_directory); }
+
+  std::string m_directory;
+};
+
+TEST_F(TemporaryFilePoolTest, should_sweep_directory_and_populate_pool) {
+  std::string leftover = path::join(m_directory, "criteo-mesos-abcdef");
+  ASSERT_SOME(os::touch(leftover));
+
+  Try<std::shared_ptr<TemporaryFilePool>> pool =
+      TemporaryFilePool::open(m_directory, 2);
+  ASSERT_SOME(pool);
+
+  EXPECT_FALSE(os::exists(leftover));
+  EXPECT_EQ(2u, pool.get()->idle());
+  EXPECT_EQ(6u, os::ls(m_directory)->size());
+}
+
+TEST_F(TemporaryFilePoolTest, should_reuse_truncated_files) {
+  Try<std::shared_ptr<TemporaryFilePool>> pool =
+      TemporaryFilePool::open(m_directory, 1);
+  ASSERT_SOME(pool);
+
+  Try<TemporaryFiles> files = pool.get()->acquire();
+  ASSERT_SOME(files);
+  EXPECT_EQ(0u, pool.get()->idle());
+  ASSERT_SOME(os::write(files->output, "output"));
+  pool.get()->release(files.get(), true);
+
+  Try<TemporaryFiles> reused = pool.get()->acquire();
+  ASSERT_SOME(reused);
+  EXPECT_EQ(files->output, reused->output);
+  EXPECT_SOME_EQ("", os::read(reused->output));
+}
+
+TEST_F(TemporaryFilePoolTest, should_remove_files_not_reusable) {
+  Try<std::shared_ptr<TemporaryFilePool>> pool =
+      TemporaryFilePool::open(m_directory, 1);
+  ASSERT_SOME(pool);
+
+  Try<TemporaryFiles> files = pool.get()->acquire();
+  ASSERT_SOME(files);
+  pool.get()->release(files.get(), false);
+
+  EXPECT_EQ(0u, pool.get()->idle());
+  EXPECT_FALSE(os::exists(files->input));
+  EXPECT_FALSE(os::exists(files->output));
+  EXPECT_FALSE(os::exists(files->error));
+}
+
+TEST_F(TemporaryFilePoolTest, should_remove_files_when_pool_is_full) {
+  Try<std::shared_ptr<TemporaryFilePool>> pool =
+      TemporaryFilePool::open(m_directory, 1);
+  ASSERT_SOME(pool);
+
+  Try<TemporaryFiles> extra = pool.get()->acquire();
+  Try<TemporaryFiles> files = pool.get()->acquire();
+  ASSERT_SOME(extra);
+  ASSERT_SOME(files);
+  pool.get()->release(files.get(), true);
+  pool.get()->release(extra.get(), true);
+
+  EXPECT_EQ(1u, pool.get()->idle());
+  EXPECT_FALSE(os::exists(extra->input));
+}
+
+TEST_F(TemporaryFilePoolTest, should_refuse_directory_accessible_to_others) {
+  ASSERT_EQ(0, ::chmod(m_directory.c_str(), 0777));
+
+  EXPECT_ERROR(TemporaryFilePool::open(m_directory, 1));
+}
+
+TEST_F(TemporaryFilePoolTest, should_not_reuse_files_replaced_by_symlinks) {
+  Try<std::shared_ptr<TemporaryFilePool>> pool =
+      TemporaryFilePool::open(m_directory, 1);
+  ASSERT_SOME(pool);
+  std::string target = path::join(m_directory, "target");
+  ASSERT_SOME(os::write(target, "content"));
+
+  Try<TemporaryFiles> files = pool.get()->acquire();
+  ASSERT_SOME(files);
+  ASSERT_SOME(os::rm(files->output));
+  ASSERT_EQ(0, ::symlink(target.c_str(), files->output.c_str()));
+  pool.get()->release(files.get(), true);
+
+  EXPECT_EQ(0u, pool.get()->idle());
+  EXPECT_SOME_EQ("content", os::read(target));
+  os::rm(target);
+}
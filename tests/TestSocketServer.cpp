@@ -0,0 +1,117 @@
+#include "TestSocketServer.hpp"
+
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <memory>
+
+static bool readFully(int fd, char* buffer, size_t size) {
+  while (size > 0) {
+    ssize_t result = ::read(fd, buffer, size);
+    if (result <= 0) return false;
+    buffer += result;
+    size -= result;
+  }
+  return true;
+}
+
+static uint64_t decode(const char* data, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value = (value << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return value;
+}
+
+static void encode(std::string& buffer, uint64_t value, size_t size) {
+  for (size_t i = size; i > 0; --i) {
+    buffer.push_back(static_cast<char>((value >> ((i - 1) * 8)) & 0xff));
+  }
+}
+
+TestSocketServer::TestSocketServer(const std::string& path,
+                                   const Handler& handler)
+    : m_path(path),
+      m_handler(handler),
+      m_stopped(false),
+      m_connections(0),
+      m_requests(0) {
+  ::unlink(path.c_str());
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+  m_listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  ::bind(m_listener, reinterpret_cast<struct sockaddr*>(&address),
+         sizeof(address));
+  ::listen(m_listener, 16);
+  m_acceptor = std::thread(&TestSocketServer::accept, this);
+}
+
+TestSocketServer::~TestSocketServer() {
+  m_stopped = true;
+  ::shutdown(m_listener, SHUT_RDWR);
+  m_acceptor.join();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (int fd : m_clients) ::shutdown(fd, SHUT_RDWR);
+  }
+  // Handlers may spawn more threads while the first ones are joined.
+  while (true) {
+    std::vector<std::thread> threads;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      threads.swap(m_threads);
+    }
+    if (threads.empty()) break;
+    for (std::thread& thread : threads) thread.join();
+  }
+  for (int fd : m_clients) ::close(fd);
+  ::close(m_listener);
+  ::unlink(m_path.c_str());
+}
+
+void TestSocketServer::accept() {
+  while (!m_stopped) {
+    int fd = ::accept4(m_listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd == -1) continue;
+    ++m_connections;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_clients.push_back(fd);
+    m_threads.push_back(std::thread(&TestSocketServer::serve, this, fd));
+  }
+}
+
+void TestSocketServer::serve(int fd) {
+  auto writeMutex = std::make_shared<std::mutex>();
+  while (!m_stopped) {
+    char header[12];
+    if (!readFully(fd, header, sizeof(header))) return;
+    uint32_t length = decode(header, 4);
+    uint64_t id = decode(header + 4, 8);
+    std::string body(length - 8, '\0');
+    if (!readFully(fd, &body[0], body.size())) return;
+    ++m_requests;
+
+    size_t methodLength = static_cast<unsigned char>(body[0]);
+    std::string method = body.substr(1, methodLength);
+    std::string input = body.substr(1 + methodLength);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threads.push_back(std::thread([=]() {
+      Try<std::string> output = m_handler(method, input);
+      std::string payload = output.isSome() ? output.get() : output.error();
+      std::string response;
+      encode(response, 8 + 1 + payload.size(), 4);
+      encode(response, id, 8);
+      response.push_back(output.isSome() ? 0 : 1);
+      response.append(payload);
+
+      std::lock_guard<std::mutex> lock(*writeMutex);
+      ::send(fd, response.data(), response.size(), MSG_NOSIGNAL);
+    }));
+  }
+}
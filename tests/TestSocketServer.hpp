@@ -0,0 +1,47 @@
+#ifndef __TEST_SOCKET_SERVER_HPP__
+#define __TEST_SOCKET_SERVER_HPP__
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stout/try.hpp>
+
+/**
+ * Stand-in for a handler daemon serving `unix://` commands. Every request is
+ * handled on its own thread so that responses can come back out of order.
+ */
+class TestSocketServer {
+ public:
+  typedef std::function<Try<std::string>(const std::string& method,
+                                         const std::string& input)>
+      Handler;
+
+  TestSocketServer(const std::string& path, const Handler& handler);
+  ~TestSocketServer();
+
+  inline const std::string& path() const { return m_path; }
+  inline size_t connections() const { return m_connections.load(); }
+  inline size_t requests() const { return m_requests.load(); }
+
+ private:
+  void accept();
+  void serve(int fd);
+
+  std::string m_path;
+  Handler m_handler;
+  int m_listener;
+  std::atomic<bool> m_stopped;
+  std::atomic<size_t> m_connections;
+  std::atomic<size_t> m_requests;
+
+  std::mutex m_mutex;
+  std::vector<int> m_clients;
+  std::vector<std::thread> m_threads;
+  std::thread m_acceptor;
+};
+
+#endif  // __TEST_SOCKET_SERVER_HPP__
@@ -0,0 +1,100 @@
+#include "Tracer.hpp"
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+#include <stout/json.hpp>
+
+using namespace criteo::mesos;
+using namespace criteo::mesos::tracing;
+
+class TracerTest : public ::testing::Test {
+ public:
+  void SetUp() {
+    Tracer::instance().setCapacity(3);
+  }
+
+  void TearDown() {
+    Tracer::instance().setCapacity(DEFAULT_TRACE_BUFFER_SIZE);
+  }
+
+  logging::Metadata m_metadata{"ABC-DEF-GHI", "usage"};
+};
+
+TEST_F(TracerTest, should_record_spans_in_order) {
+  Tracer::instance().record("spawn", m_metadata, 1, 10, 15);
+  Tracer::instance().record("run", m_metadata, 1, 15, 100);
+
+  std::vector<Span> spans = Tracer::instance().spans();
+  ASSERT_EQ(2u, spans.size());
+  EXPECT_STREQ("spawn", spans[0].name);
+  EXPECT_EQ("ABC-DEF-GHI", spans[0].taskId);
+  EXPECT_EQ("usage", spans[0].method);
+  EXPECT_EQ(5u, spans[0].duration);
+  EXPECT_STREQ("run", spans[1].name);
+  EXPECT_EQ(85u, spans[1].duration);
+}
+
+TEST_F(TracerTest, should_keep_only_the_latest_spans) {
+  Tracer::instance().record("a", m_metadata, 1, 0, 1);
+  Tracer::instance().record("b", m_metadata, 1, 1, 2);
+  Tracer::instance().record("c", m_metadata, 1, 2, 3);
+  Tracer::instance().record("d", m_metadata, 1, 3, 4);
+
+  std::vector<Span> spans = Tracer::instance().spans();
+  ASSERT_EQ(3u, spans.size());
+  EXPECT_STREQ("b", spans[0].name);
+  EXPECT_STREQ("c", spans[1].name);
+  EXPECT_STREQ("d", spans[2].name);
+}
+
+TEST_F(TracerTest, should_not_record_when_disabled) {
+  Tracer::instance().setCapacity(0);
+  {
+    ScopedSpan span("spawn", m_metadata);
+  }
+  Tracer::instance().record("run", m_metadata, 1, 0, 1);
+  EXPECT_FALSE(Tracer::instance().enabled());
+  EXPECT_TRUE(Tracer::instance().spans().empty());
+}
+
+TEST_F(TracerTest, should_keep_the_largest_requested_capacity) {
+  Tracer::instance().requestCapacity(2);
+  Tracer::instance().requestCapacity(5);
+  Tracer::instance().requestCapacity(0);
+  EXPECT_TRUE(Tracer::instance().enabled());
+
+  for (uint64_t i = 0; i < 6; ++i) {
+    Tracer::instance().record("run", m_metadata, i, i, i + 1);
+  }
+  EXPECT_EQ(5u, Tracer::instance().spans().size());
+}
+
+TEST_F(TracerTest, should_record_scoped_span_once) {
+  {
+    ScopedSpan span("parse_json", m_metadata, 42);
+    span.finish();
+  }
+  std::vector<Span> spans = Tracer::instance().spans();
+  ASSERT_EQ(1u, spans.size());
+  EXPECT_EQ(42u, spans[0].invocation);
+}
+
+TEST_F(TracerTest, should_export_chrome_trace) {
+  Tracer::instance().record("spawn", m_metadata, 7, 10, 15);
+
+  Try<JSON::Object> trace =
+      JSON::parse<JSON::Object>(Tracer::instance().chromeTrace());
+  ASSERT_SOME(trace);
+
+  Result<JSON::Array> events = trace->at<JSON::Array>("traceEvents");
+  ASSERT_SOME(events);
+  // One event naming the track of the task and one for the span.
+  ASSERT_EQ(2u, events.get().values.size());
+
+  JSON::Object span = events.get().values[1].as<JSON::Object>();
+  EXPECT_EQ("spawn", span.values["name"].as<JSON::String>().value);
+  EXPECT_EQ("usage", span.values["cat"].as<JSON::String>().value);
+  EXPECT_EQ("X", span.values["ph"].as<JSON::String>().value);
+  EXPECT_EQ(10u, span.values["ts"].as<JSON::Number>().as<uint64_t>());
+  EXPECT_EQ(5u, span.values["dur"].as<JSON::Number>().as<uint64_t>());
+}
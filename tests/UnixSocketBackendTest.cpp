@@ -0,0 +1,136 @@
+#include "UnixSocketBackend.hpp"
+#include "TestSocketServer.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+#include <gtest/gtest.h>
+#include <stout/gtest.hpp>
+#include <stout/os.hpp>
+
+using namespace criteo::mesos;
+
+const std::string SOCKET_PATH = "/tmp/unix_socket_backend_test.sock";
+
+TEST(UnixSocketBackendTest, should_recognize_unix_socket_commands) {
+  EXPECT_TRUE(UnixSocketBackend::handles("unix:///run/handler.sock"));
+  EXPECT_FALSE(UnixSocketBackend::handles("/usr/bin/handler"));
+}
+
+TEST(UnixSocketBackendTest, should_send_method_and_input) {
+  TestSocketServer server(
+      SOCKET_PATH,
+      [](const std::string& method,
+         const std::string& input) -> Try<std::string> {
+        return method + ":" + input;
+      });
+  UnixSocketBackend backend(SOCKET_PATH, 2);
+
+  Try<std::string> output =
+      backend.call("prepare", "{\"container_id\":{}}", Seconds(5));
+  ASSERT_SOME(output);
+  EXPECT_EQ("prepare:{\"container_id\":{}}", output.get());
+}
+
+TEST(UnixSocketBackendTest, should_return_daemon_errors) {
+  TestSocketServer server(
+      SOCKET_PATH,
+      [](const std::string&, const std::string&) -> Try<std::string> {
+        return Error("no such container");
+      });
+  UnixSocketBackend backend(SOCKET_PATH, 2);
+
+  Try<std::string> output = backend.call("usage", "{}", Seconds(5));
+  ASSERT_ERROR(output);
+  EXPECT_NE(std::string::npos, output.error().find("no such container"));
+}
+
+TEST(UnixSocketBackendTest, should_fail_without_daemon) {
+  UnixSocketBackend backend("/tmp/unix_socket_backend_missing.sock", 2);
+  EXPECT_ERROR(backend.call("usage", "{}", Seconds(5)));
+}
+
+TEST(UnixSocketBackendTest, should_not_block_on_a_full_backlog) {
+  // A daemon which does not accept its connections and whose backlog is full.
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, SOCKET_PATH.c_str(), sizeof(address.sun_path) - 1);
+  unlink(SOCKET_PATH.c_str());
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_EQ(0, bind(listener, reinterpret_cast<struct sockaddr*>(&address),
+                    sizeof(address)));
+  ASSERT_EQ(0, listen(listener, 0));
+  std::vector<int> clients;
+  while (true) {
+    int client = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (connect(client, reinterpret_cast<struct sockaddr*>(&address),
+                sizeof(address)) == -1) {
+      close(client);
+      break;
+    }
+    clients.push_back(client);
+  }
+
+  // The request times out instead of blocking the I/O thread in connect().
+  UnixSocketBackend backend(SOCKET_PATH, 1);
+  Try<std::string> output = backend.call("usage", "{}", Milliseconds(200));
+  ASSERT_ERROR(output);
+  EXPECT_NE(std::string::npos, output.error().find("took too long"));
+
+  for (int client : clients) close(client);
+  close(listener);
+  unlink(SOCKET_PATH.c_str());
+}
+
+TEST(UnixSocketBackendTest, should_time_out_and_keep_the_connection) {
+  TestSocketServer server(
+      SOCKET_PATH,
+      [](const std::string& method, const std::string&) -> Try<std::string> {
+        if (method == "slow") os::sleep(Milliseconds(500));
+        return method;
+      });
+  UnixSocketBackend backend(SOCKET_PATH, 1);
+
+  EXPECT_ERROR(backend.call("slow", "{}", Milliseconds(100)));
+  Try<std::string> output = backend.call("fast", "{}", Seconds(5));
+  ASSERT_SOME(output);
+  EXPECT_EQ("fast", output.get());
+  EXPECT_EQ(1u, server.connections());
+}
+
+TEST(UnixSocketBackendTest, should_pipeline_requests_on_pooled_connections) {
+  TestSocketServer server(
+      SOCKET_PATH,
+      [](const std::string&, const std::string& input) -> Try<std::string> {
+        return input;
+      });
+  UnixSocketBackend backend(SOCKET_PATH, 4);
+
+  const int requests = 500;
+  std::mutex mutex;
+  std::condition_variable done;
+  int completed = 0;
+  std::atomic<int> matched(0);
+  for (int i = 0; i < requests; ++i) {
+    std::string input = std::to_string(i);
+    backend.send("usage", input, Seconds(10),
+                 [&, input](const Try<std::string>& output) {
+                   if (output.isSome() && output.get() == input) ++matched;
+                   std::lock_guard<std::mutex> lock(mutex);
+                   ++completed;
+                   done.notify_one();
+                 });
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&]() { return completed == requests; });
+  EXPECT_EQ(requests, matched.load());
+  EXPECT_GE(4u, server.connections());
+}
@@ -0,0 +1,97 @@
+#include "WatchScheduler.hpp"
+
+#include <atomic>
+
+#include <gtest/gtest.h>
+#include <stout/os.hpp>
+
+using namespace criteo::mesos;
+
+TEST(WatchSchedulerTest, should_run_checks_until_they_stop) {
+  WatchScheduler scheduler(2);
+  std::atomic<int> recurrent(0);
+  std::atomic<int> once(0);
+
+  scheduler.schedule("recurrent", Milliseconds(10), [&]() -> Option<Duration> {
+    ++recurrent;
+    return Milliseconds(10);
+  });
+  scheduler.schedule("once", Milliseconds(10), [&]() -> Option<Duration> {
+    ++once;
+    return None();
+  });
+
+  os::sleep(Milliseconds(300));
+  EXPECT_LT(3, recurrent.load());
+  EXPECT_EQ(1, once.load());
+  EXPECT_EQ(1u, scheduler.size());
+}
+
+TEST(WatchSchedulerTest, should_not_run_unscheduled_checks) {
+  WatchScheduler scheduler(1);
+  std::atomic<int> runs(0);
+
+  scheduler.schedule("container", Milliseconds(10), [&]() -> Option<Duration> {
+    ++runs;
+    return Milliseconds(10);
+  });
+  os::sleep(Milliseconds(100));
+  scheduler.unschedule("container");
+  int runsWhenUnscheduled = runs.load();
+
+  os::sleep(Milliseconds(100));
+  EXPECT_EQ(runsWhenUnscheduled, runs.load());
+  EXPECT_EQ(0u, scheduler.size());
+}
+
+TEST(WatchSchedulerTest, should_spread_first_runs_within_interval) {
+  WatchScheduler scheduler(1);
+  std::atomic<int> runs(0);
+
+  scheduler.schedule("container", Seconds(1), [&]() -> Option<Duration> {
+    ++runs;
+    return Seconds(10);
+  });
+
+  os::sleep(Milliseconds(1100));
+  EXPECT_EQ(1, runs.load());
+}
+
+TEST(WatchSchedulerTest, should_keep_running_other_checks_with_hung_one) {
+  WatchScheduler scheduler(2);
+  std::atomic<int> runs(0);
+
+  scheduler.schedule("hung", Milliseconds(1), []() -> Option<Duration> {
+    os::sleep(Seconds(1));
+    return None();
+  });
+  scheduler.schedule("healthy", Milliseconds(10), [&]() -> Option<Duration> {
+    ++runs;
+    return Milliseconds(10);
+  });
+
+  os::sleep(Milliseconds(300));
+  EXPECT_LT(3, runs.load());
+}
+
+TEST(AdaptiveIntervalTest, should_back_off_while_there_is_no_pressure) {
+  AdaptiveInterval interval(Seconds(10), Seconds(1), Seconds(60));
+  EXPECT_EQ(Seconds(20), interval.next(None()));
+  EXPECT_EQ(Seconds(40), interval.next(0.0));
+  EXPECT_EQ(Seconds(60), interval.next(None()));
+  EXPECT_EQ(Seconds(60), interval.next(None()));
+}
+
+TEST(AdaptiveIntervalTest, should_tighten_when_pressure_rises) {
+  AdaptiveInterval interval(Seconds(60), Seconds(1), Seconds(61));
+  EXPECT_EQ(Seconds(31), interval.next(0.5));
+  EXPECT_EQ(Seconds(1), interval.next(1.0));
+  EXPECT_EQ(Seconds(1), interval.next(2.0));
+  EXPECT_EQ(Seconds(2), interval.next(0.0));
+}
+
+TEST(AdaptiveIntervalTest, should_not_adapt_with_equal_bounds) {
+  AdaptiveInterval interval(Seconds(10), Seconds(10), Seconds(10));
+  EXPECT_EQ(Seconds(10), interval.next(None()));
+  EXPECT_EQ(Seconds(10), interval.next(1.0));
+}
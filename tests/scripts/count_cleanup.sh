@@ -0,0 +1,4 @@
+#!/bin/sh
+
+sleep 1
+echo called >> "$TEST_CALLS_FILE"
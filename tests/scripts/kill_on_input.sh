@@ -0,0 +1,9 @@
+#!/bin/sh
+
+INPUT=`cat $1`
+
+if [ "$INPUT" = "KILL" ]; then
+  kill $$
+fi
+
+echo -n "$INPUT > output" > $2
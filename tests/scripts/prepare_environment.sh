@@ -0,0 +1,3 @@
+#!/bin/bash
+
+echo '{"environment": {"variables": [{"name": "PREPARED", "value": "true"}]}}' >$2
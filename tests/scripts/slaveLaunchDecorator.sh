@@ -0,0 +1,24 @@
+#!/bin/bash
+
+INPUT_FILE=$1
+OUTPUT_FILE=$2
+
+# Count the invocations so that the tests can check the cache.
+echo "called" >> "$TEST_CALLS_FILE"
+
+read -r -d '' OUTPUT << EOM
+{
+  "labels": {
+    "labels":[
+      {"key": "LABEL_1", "value": "test1"}
+    ]
+  },
+  "environment": {
+    "variables":[
+      {"name": "ENV_1", "value": "test1", "type": "VALUE"}
+    ]
+  }
+}
+EOM
+
+echo $OUTPUT > $OUTPUT_FILE
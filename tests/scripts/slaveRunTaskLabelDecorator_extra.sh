@@ -0,0 +1,3 @@
+#!/bin/bash
+
+echo '{"labels": [{"key": "LABEL_3", "value": "test3"}]}' >$2
@@ -0,0 +1,10 @@
+#!/bin/sh
+
+sleep 1000 &
+echo $! > /tmp/spawn_tree.pid
+
+# A child ignoring SIGTERM, only the SIGKILL of the group stops it.
+sh -c 'trap "" TERM; sleep 1000' &
+echo $! > /tmp/spawn_tree_trap.pid
+
+wait
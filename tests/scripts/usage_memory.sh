@@ -0,0 +1,3 @@
+#!/bin/bash
+
+echo '{"timestamp": 12346, "mem_rss_bytes": 1024}' >$2
@@ -0,0 +1,5 @@
+#!/bin/bash
+
+# report that the container is at its limits and count the checks
+echo called >> "$TEST_CALLS_FILE"
+echo '{"pressure":1}' >$2
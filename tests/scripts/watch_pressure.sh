@@ -0,0 +1,4 @@
+#!/bin/bash
+
+# report that the container is getting close to its limits
+echo '{"pressure":0.8}' >$2
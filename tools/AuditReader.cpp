@@ -0,0 +1,101 @@
+/*
+ * Print the records of an audit ring file written by the modules, oldest
+ * first, as tab-separated values.
+ *
+ * Usage: mesos_command_modules_audit_reader <audit file>
+ */
+#include "AuditLog.hpp"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace criteo::mesos::audit;
+
+static void printRecord(const Record& record) {
+  time_t seconds = record.timestamp / 1000000;
+  struct tm date;
+  gmtime_r(&seconds, &date);
+  char time[32];
+  strftime(time, sizeof(time), "%Y-%m-%dT%H:%M:%S", &date);
+
+  bool hasRusage = record.flags & AUDIT_FLAG_HAS_RUSAGE;
+  printf("%" PRIu64 "\t%s.%06" PRIu64 "Z\t%s\t%s\t%016" PRIx64 "\t%" PRIu64
+         "\t%d\t%d\t%s\t%s\t%" PRIu64 "\t%" PRIu64,
+         record.sequence, time, record.timestamp % 1000000, record.module,
+         record.event, record.containerHash, record.durationMicros,
+         record.exitCode, record.signal,
+         record.flags & AUDIT_FLAG_TIMED_OUT ? "yes" : "no",
+         record.flags & AUDIT_FLAG_FAILED ? "yes" : "no", record.inputSize,
+         record.outputSize);
+  if (hasRusage) {
+    printf("\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64
+           "\n",
+           record.userTimeMicros, record.systemTimeMicros,
+           record.maxRssKilobytes, record.minorFaults, record.majorFaults);
+  } else {
+    printf("\t-\t-\t-\t-\t-\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s <audit file>\n", argv[0]);
+    return 1;
+  }
+
+  // The shared lock prevents the modules from resizing the file while it is
+  // mapped, they only do it when nobody holds the lock.
+  int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+  struct flock lock = {};
+  lock.l_type = F_RDLCK;
+  lock.l_whence = SEEK_SET;
+  struct stat status;
+  if (fd == -1 || fcntl(fd, F_OFD_SETLKW, &lock) == -1 ||
+      fstat(fd, &status) == -1) {
+    perror(argv[1]);
+    return 1;
+  }
+  size_t length = status.st_size;
+  if (length < sizeof(Header)) {
+    fprintf(stderr, "%s: not an audit file\n", argv[1]);
+    return 1;
+  }
+
+  void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  const Header* header = static_cast<const Header*>(mapping);
+  if (header->magic != AUDIT_MAGIC || header->version != AUDIT_VERSION ||
+      header->recordSize != sizeof(Record) || header->capacity == 0 ||
+      length != sizeof(Header) + header->capacity * sizeof(Record)) {
+    fprintf(stderr, "%s: unsupported audit file\n", argv[1]);
+    return 1;
+  }
+  const Record* records = reinterpret_cast<const Record*>(
+      static_cast<const char*>(mapping) + sizeof(Header));
+
+  printf(
+      "sequence\ttime\tmodule\tevent\tcontainer_hash\tduration_us\texit_code"
+      "\tsignal\ttimed_out\tfailed\tinput_size\toutput_size\tuser_us\t"
+      "system_us\tmax_rss_kb\tminor_faults\tmajor_faults\n");
+
+  // Records being written or overwritten while reading are skipped.
+  uint64_t next = header->next.load();
+  uint64_t first = next > header->capacity ? next - header->capacity : 0;
+  for (uint64_t index = first; index < next; ++index) {
+    Record record;
+    if (readRecord(*header, records, index, record)) printRecord(record);
+  }
+
+  munmap(mapping, length);
+  close(fd);
+  return 0;
+}
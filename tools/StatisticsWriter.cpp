@@ -0,0 +1,60 @@
+/*
+ * Publish the statistics of a container in a statistics channel, or remove
+ * them, the way a collector would. It is meant for tests.
+ *
+ * Usage: mesos_command_modules_statistics_writer_tool <channel> <container id>
+ *          [<ResourceStatistics as JSON>]
+ *
+ * The statistics of the container are removed if no JSON is given.
+ */
+#include "StatisticsChannelWriter.hpp"
+
+#include <stdio.h>
+
+#include <mesos/mesos.pb.h>
+
+#include <stout/json.hpp>
+#include <stout/protobuf.hpp>
+
+using namespace criteo::mesos::statistics;
+
+int main(int argc, char** argv) {
+  if (argc != 3 && argc != 4) {
+    fprintf(stderr,
+            "Usage: %s <channel> <container id> [<statistics as JSON>]\n",
+            argv[0]);
+    return 1;
+  }
+
+  Try<std::shared_ptr<StatisticsChannelWriter>> writer =
+      StatisticsChannelWriter::create(argv[1]);
+  if (writer.isError()) {
+    fprintf(stderr, "%s\n", writer.error().c_str());
+    return 1;
+  }
+
+  if (argc == 3) {
+    writer.get()->remove(argv[2]);
+    return 0;
+  }
+
+  Try<JSON::Object> json = JSON::parse<JSON::Object>(argv[3]);
+  if (json.isError()) {
+    fprintf(stderr, "Malformed JSON: %s\n", json.error().c_str());
+    return 1;
+  }
+  Try<::mesos::ResourceStatistics> statistics =
+      ::protobuf::parse<::mesos::ResourceStatistics>(json.get());
+  if (statistics.isError()) {
+    fprintf(stderr, "Invalid statistics: %s\n", statistics.error().c_str());
+    return 1;
+  }
+
+  Try<Nothing> published =
+      writer.get()->publish(argv[2], statistics->SerializeAsString());
+  if (published.isError()) {
+    fprintf(stderr, "%s\n", published.error().c_str());
+    return 1;
+  }
+  return 0;
+}